@@ -23,6 +23,8 @@
 	#include <netinet/in.h>
 	#include <fcntl.h>
 	#include <pthread.h>
+	#include <sys/mman.h>
+	#include <signal.h>
 	#include <arpa/inet.h>
 
 	#include <dirent.h>
@@ -360,6 +362,8 @@ IOHANDLE io_open(const char *filename, int flags)
 	}
 	if(flags == IOFLAG_WRITE)
 		return (IOHANDLE)fopen(filename, "wb");
+	if(flags == IOFLAG_APPEND)
+		return (IOHANDLE)fopen(filename, "ab");
 	return 0x0;
 }
 
@@ -627,6 +631,86 @@ void lock_unlock(LOCK lock)
 	#endif
 #endif
 
+/* -----  shared memory ----- */
+void *shm_map(const char *name, unsigned size, int *created)
+{
+	char full_name[128];
+	void *block;
+#if defined(CONF_FAMILY_UNIX)
+	struct stat st;
+	int is_new = 1;
+	int fd;
+
+	str_format(full_name, sizeof(full_name), "/teeworlds-%s", name);
+	fd = shm_open(full_name, O_RDWR|O_CREAT|O_EXCL, 0600);
+	if(fd < 0 && errno == EEXIST)
+	{
+		is_new = 0;
+		fd = shm_open(full_name, O_RDWR, 0600);
+	}
+	if(fd < 0)
+		return 0;
+
+	/* a fresh object has size 0, truncating it zero-fills it */
+	if((is_new && ftruncate(fd, size) != 0) || fstat(fd, &st) != 0 || st.st_size < (off_t)size)
+	{
+		if(is_new)
+			shm_unlink(full_name);
+		close(fd);
+		return 0;
+	}
+
+	block = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(block == MAP_FAILED)
+		return 0;
+	if(created)
+		*created = is_new;
+	return block;
+#elif defined(CONF_FAMILY_WINDOWS)
+	HANDLE mapping;
+
+	str_format(full_name, sizeof(full_name), "Local\\teeworlds-%s", name);
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, size, full_name);
+	if(!mapping)
+		return 0;
+	if(created)
+		*created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+	/* the view keeps the mapping alive */
+	block = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	CloseHandle(mapping);
+	return block;
+#else
+	#error not implemented on this platform
+#endif
+}
+
+void shm_unmap(void *block, unsigned size)
+{
+#if defined(CONF_FAMILY_UNIX)
+	munmap(block, size);
+#elif defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(block);
+#else
+	#error not implemented on this platform
+#endif
+}
+
+void shm_remove(const char *name)
+{
+#if defined(CONF_FAMILY_UNIX)
+	char full_name[128];
+	str_format(full_name, sizeof(full_name), "/teeworlds-%s", name);
+	shm_unlink(full_name);
+#elif defined(CONF_FAMILY_WINDOWS)
+	/* the block goes away with the last view */
+	(void)name;
+#else
+	#error not implemented on this platform
+#endif
+}
+
 
 /* -----  time ----- */
 int64 time_get()
@@ -2547,6 +2631,22 @@ int pid()
 #endif
 }
 
+int process_alive(int id)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, id);
+	int alive;
+	if(!process)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+	alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+	return alive;
+#else
+	/* a process owned by someone else still exists */
+	return kill(id, 0) == 0 || errno == EPERM;
+#endif
+}
+
 unsigned bytes_be_to_uint(const unsigned char *bytes)
 {
 	return (bytes[0]<<24) | (bytes[1]<<16) | (bytes[2]<<8) | bytes[3];
@@ -183,6 +183,7 @@ enum {
 	IOFLAG_READ = 1,
 	IOFLAG_WRITE = 2,
 	IOFLAG_RANDOM = 4,
+	IOFLAG_APPEND = 8,
 
 	IOSEEK_START = 0,
 	IOSEEK_CUR = 1,
@@ -197,7 +198,7 @@ typedef struct IOINTERNAL *IOHANDLE;
 
 	Parameters:
 		filename - File to open.
-		flags - A set of flags. IOFLAG_READ, IOFLAG_WRITE, IOFLAG_RANDOM.
+		flags - A set of flags. IOFLAG_READ, IOFLAG_WRITE, IOFLAG_RANDOM, IOFLAG_APPEND.
 
 	Returns:
 		Returns a handle to the file on success and 0 on failure.
@@ -433,6 +434,49 @@ void lock_unlock(LOCK lock);
 	void semaphore_destroy(SEMAPHORE *sem);
 #endif
 
+/* Group: Shared memory */
+/*
+	Function: shm_map
+		Maps a named block of memory that is shared between processes,
+		creating it if it doesn't exist yet.
+
+	Parameters:
+		name - Name of the block, all processes using the same name
+			share the block.
+		size - Size of the block in bytes.
+		created - Set to 1 if the block got created, 0 if it existed
+			already. Can be null.
+
+	Returns:
+		Returns a pointer to the block or null on failure. A newly
+		created block is filled with zeros.
+
+	See Also:
+		<shm_unmap>
+*/
+void *shm_map(const char *name, unsigned size, int *created);
+
+/*
+	Function: shm_unmap
+		Unmaps a block mapped with <shm_map>. The block itself stays
+		available for other processes.
+
+	Parameters:
+		block - Pointer returned by <shm_map>.
+		size - Size passed to <shm_map>.
+*/
+void shm_unmap(void *block, unsigned size);
+
+/*
+	Function: shm_remove
+		Removes the name of a shared memory block, processes that have
+		it mapped keep using it.
+
+	Parameters:
+		name - Name passed to <shm_map>.
+*/
+void shm_remove(const char *name);
+
 /* Group: Timer */
 #ifdef __GNUC__
 /* if compiled with -pedantic-errors it will complain about long
@@ -1561,6 +1605,18 @@ void secure_random_fill(void *bytes, unsigned length);
 */
 int pid();
 
+/*
+	Function: process_alive
+		Checks whether a process is still running.
+
+	Parameters:
+		id - Process ID as returned by <pid>.
+
+	Returns:
+		1 if the process exists, 0 if it doesn't.
+*/
+int process_alive(int id);
+
 /*
 	Function: bytes_be_to_uint
 		Packs 4 big endian bytes into an unsigned
@@ -32,9 +32,17 @@ public:
 	virtual bool ClientIngame(int ClientID) const = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) const = 0;
 	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) const = 0;
+	// address without the port, zero while the client isn't ingame
+	virtual void GetClientAddr(int ClientID, NETADDR *pAddr) const = 0;
 	virtual int GetClientVersion(int ClientID) const = 0;
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) = 0;
+	// sends the message packed once to all ingame clients in the mask
+	virtual int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask) = 0;
+	// sends a message that was packed before to one client
+	virtual int SendMsgRaw(const void *pData, int Size, int Flags, int ClientID) = 0;
+	// bytes of vital list data (votes, commands, maps) a client can get right now
+	virtual int ListSyncBudget(int ClientID) const = 0;
 
 	template<class T>
 	int SendPackMsg(T *pMsg, int Flags, int ClientID)
@@ -45,6 +53,15 @@ public:
 		return SendMsg(&Packer, Flags, ClientID);
 	}
 
+	template<class T>
+	int SendPackMsgMask(T *pMsg, int Flags, int64 ClientMask)
+	{
+		CMsgPacker Packer(pMsg->MsgID(), false);
+		if(pMsg->Pack(&Packer))
+			return -1;
+		return SendMsgMask(&Packer, Flags, ClientMask);
+	}
+
 	virtual void SetClientName(int ClientID, char const *pName) = 0;
 	virtual void SetClientClan(int ClientID, char const *pClan) = 0;
 	virtual void SetClientCountry(int ClientID, int Country) = 0;
@@ -100,6 +117,9 @@ public:
 	virtual bool IsClientPlayer(int ClientID) const = 0;
 	virtual bool IsClientSpectator(int ClientID) const = 0;
 
+	// hash of the simulated state, input recordings are verified with it
+	virtual unsigned GameStateChecksum() = 0;
+
 	virtual const char *GameType() const = 0;
 	virtual const char *Version() const = 0;
 	virtual const char *NetVersion() const = 0;
@@ -18,6 +18,7 @@
 #include <engine/shared/demo.h>
 #include <engine/shared/econ.h>
 #include <engine/shared/filecollection.h>
+#include <engine/shared/inputrecord.h>
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
@@ -207,9 +208,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 		if(NetMatch(&Data, Server()->m_NetServer.ClientAddr(i)))
 		{
-			CNetHash NetHash(&Data);
 			char aBuf[256];
-			MakeBanInfo(pBanPool->Find(&Data, &NetHash), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
+			MakePlayerBanInfo(pBanPool, &Data, aBuf, sizeof(aBuf));
 			Server()->m_NetServer.Drop(i, aBuf, true);
 		}
 	}
@@ -292,6 +292,9 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 
 	m_MapReload = 0;
 
+	m_aInputRecordFile[0] = 0;
+	m_Replaying = false;
+
 	m_RconClientID = IServer::RCON_CID_SERV;
 	m_RconAuthLevel = AUTHED_ADMIN;
 
@@ -367,7 +370,7 @@ void CServer::Kick(int ClientID, const char *pReason)
  		return;
 	}
 
-	m_NetServer.Drop(ClientID, pReason, true);
+	DropClient(ClientID, pReason);
 }
 
 void CServer::KickForce(int ClientID, const char *pReason)
@@ -378,7 +381,16 @@ void CServer::KickForce(int ClientID, const char *pReason)
 		return;
 	}
 
-	m_NetServer.Drop(ClientID, pReason, true);
+	DropClient(ClientID, pReason);
+}
+
+void CServer::DropClient(int ClientID, const char *pReason)
+{
+	// replayed clients have no connection
+	if(m_Replaying)
+		DelClientCallback(ClientID, pReason, this, true);
+	else
+		m_NetServer.Drop(ClientID, pReason, true);
 }
 
 /*int CServer::Tick()
@@ -447,6 +459,17 @@ void CServer::GetClientAddr(int ClientID, char *pAddrStr, int Size) const
 		net_addr_str(m_NetServer.ClientAddr(ClientID), pAddrStr, Size, false);
 }
 
+void CServer::GetClientAddr(int ClientID, NETADDR *pAddr) const
+{
+	mem_zero(pAddr, sizeof(NETADDR));
+	if(ClientID >= 0 && ClientID < MAX_CLIENTS && m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+	{
+		const NETADDR *pClientAddr = m_NetServer.ClientAddr(ClientID);
+		pAddr->type = pClientAddr->type;
+		mem_copy(pAddr->ip, pClientAddr->ip, sizeof(pAddr->ip));
+	}
+}
+
 int CServer::GetClientVersion(int ClientID) const
 {
 	if(ClientID >= 0 && ClientID < MAX_CLIENTS && m_aClients[ClientID].m_State == CClient::STATE_INGAME)
@@ -492,6 +515,9 @@ bool CServer::ClientIngame(int ClientID) const
 
 int CServer::MaxClients() const
 {
+	// replays run without a network server
+	if(m_Replaying)
+		return g_Config.m_SvMaxClients;
 	return m_NetServer.MaxClients();
 }
 
@@ -527,12 +553,55 @@ void CServer::InitRconPasswordIfUnset()
 
 int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 {
-	CNetChunk Packet;
 	if(!pMsg)
 		return -1;
+	if(ClientID == -1)
+		return SendMsgMask(pMsg, Flags, -1);
+	return SendMsgRaw(pMsg->Data(), pMsg->Size(), Flags, ClientID);
+}
+
+int CServer::SendMsgRaw(const void *pData, int Size, int Flags, int ClientID)
+{
+	CNetChunk Packet;
+	if(m_Replaying)
+		return 0;
 
 	mem_zero(&Packet, sizeof(CNetChunk));
 	Packet.m_ClientID = ClientID;
+	Packet.m_pData = pData;
+	Packet.m_DataSize = Size;
+
+	if(Flags&MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags&MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+
+	// write message to demo recorder
+	if(!(Flags&MSGFLAG_NORECORD))
+		m_DemoRecorder.RecordMessage(pData, Size);
+
+	if(!(Flags&MSGFLAG_NOSEND))
+		m_NetServer.Send(&Packet);
+	return 0;
+}
+
+int CServer::ListSyncBudget(int ClientID) const
+{
+	// lists are sent vital, leave half of the free resend buffer to everything else
+	// so a slow connection can't run out of it and lose chunks it never resends
+	return min(g_Config.m_SvListSyncBudget, m_NetServer.ResendBufferFree(ClientID)/2);
+}
+
+int CServer::SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask)
+{
+	CNetChunk Packet;
+	if(!pMsg)
+		return -1;
+
+	if(m_Replaying)
+		return 0;
+
+	mem_zero(&Packet, sizeof(CNetChunk));
 	Packet.m_pData = pMsg->Data();
 	Packet.m_DataSize = pMsg->Size();
 
@@ -547,30 +616,29 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 
 	if(!(Flags&MSGFLAG_NOSEND))
 	{
-		if(ClientID == -1)
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			// broadcast
-			int i;
-			for(i = 0; i < MAX_CLIENTS; i++)
-				if(m_aClients[i].m_State == CClient::STATE_INGAME && !m_aClients[i].m_Quitting)
-				{
-					Packet.m_ClientID = i;
-					m_NetServer.Send(&Packet);
-				}
-		}
-		else
+			if(!(ClientMask&((int64)1<<i)) || m_aClients[i].m_State != CClient::STATE_INGAME || m_aClients[i].m_Quitting)
+				continue;
+			Packet.m_ClientID = i;
 			m_NetServer.Send(&Packet);
+		}
 	}
 	return 0;
 }
 
 void CServer::DoSnapshot()
 {
+	// which snapshots the game made, for input recordings
+	int aSnapped[1+MAX_CLIENTS/32];
+	mem_zero(aSnapped, sizeof(aSnapped));
+
 	GameServer()->OnPreSnap();
 
 	// create snapshot for demo recording
 	if(m_DemoRecorder.IsRecording())
 	{
+		aSnapped[0] = 1;
 		char aData[CSnapshot::MAX_SIZE];
 		int SnapshotSize;
 
@@ -614,6 +682,7 @@ void CServer::DoSnapshot()
 			m_SnapshotBuilder.Init();
 
 			GameServer()->OnSnap(i);
+			aSnapped[1+i/32] |= 1<<(i%32);
 
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
@@ -693,6 +762,7 @@ void CServer::DoSnapshot()
 		}
 	}
 
+	m_InputRecorder.RecordSnap(aSnapped, 1+MAX_CLIENTS/32);
 	GameServer()->OnPostSnap();
 }
 
@@ -731,6 +801,7 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser, b
 
 	// notify the mod about the drop, if the mod says, that the connection can't be free'd, we don't drop the connection
 	if(pThis->m_aClients[ClientID].m_State >= CClient::STATE_READY) { 
+		pThis->m_InputRecorder.RecordDrop(ClientID, pReason, ForceDisconnect);
 		CanDrop = pThis->GameServer()->OnClientDrop(ClientID, pReason, ForceDisconnect);
 	}
 
@@ -802,13 +873,14 @@ void CServer::SendRconLineAuthed(const char *pLine, void *pUser, bool Highlighte
 	ReentryGuard--;
 }
 
-void CServer::SendRconCmdAdd(const IConsole::CCommandInfo *pCommandInfo, int ClientID)
+int CServer::SendRconCmdAdd(const IConsole::CCommandInfo *pCommandInfo, int ClientID)
 {
 	CMsgPacker Msg(NETMSG_RCON_CMD_ADD, true);
 	Msg.AddString(pCommandInfo->m_pName, IConsole::TEMPCMD_NAME_LENGTH);
 	Msg.AddString(pCommandInfo->m_pHelp, IConsole::TEMPCMD_HELP_LENGTH);
 	Msg.AddString(pCommandInfo->m_pParams, IConsole::TEMPCMD_PARAMS_LENGTH);
 	SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+	return Msg.Size();
 }
 
 void CServer::SendRconCmdRem(const IConsole::CCommandInfo *pCommandInfo, int ClientID)
@@ -818,27 +890,12 @@ void CServer::SendRconCmdRem(const IConsole::CCommandInfo *pCommandInfo, int Cli
 	SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
-void CServer::UpdateClientRconCommands()
-{
-	for(int ClientID = Tick() % MAX_RCONCMD_RATIO; ClientID < MaxClients(); ClientID += MAX_RCONCMD_RATIO)
-	{
-		if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY && m_aClients[ClientID].m_Authed)
-		{
-			int ConsoleAccessLevel = m_aClients[ClientID].m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : IConsole::ACCESS_LEVEL_MOD;
-			for(int i = 0; i < MAX_RCONCMD_SEND && m_aClients[ClientID].m_pRconCmdToSend; ++i)
-			{
-				SendRconCmdAdd(m_aClients[ClientID].m_pRconCmdToSend, ClientID);
-				m_aClients[ClientID].m_pRconCmdToSend = m_aClients[ClientID].m_pRconCmdToSend->NextCommandInfo(ConsoleAccessLevel, CFGFLAG_SERVER);
-			}
-		}
-	}
-}
-
-void CServer::SendMapListEntryAdd(const CMapListEntry *pMapListEntry, int ClientID)
+int CServer::SendMapListEntryAdd(const CMapListEntry *pMapListEntry, int ClientID)
 {
 	CMsgPacker Msg(NETMSG_MAPLIST_ENTRY_ADD, true);
 	Msg.AddString(pMapListEntry->m_aName, 256);
 	SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+	return Msg.Size();
 }
 
 void CServer::SendMapListEntryRem(const CMapListEntry *pMapListEntry, int ClientID)
@@ -848,18 +905,26 @@ void CServer::SendMapListEntryRem(const CMapListEntry *pMapListEntry, int Client
 	SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
-
-void CServer::UpdateClientMapListEntries()
+void CServer::UpdateClientRconLists()
 {
-	for(int ClientID = Tick() % MAX_RCONCMD_RATIO; ClientID < MaxClients(); ClientID += MAX_RCONCMD_RATIO)
+	// every authed client gets its lists at a limited amount of bytes per tick
+	for(int ClientID = 0; ClientID < MaxClients(); ClientID++)
 	{
-		if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY && m_aClients[ClientID].m_Authed)
+		CClient *pClient = &m_aClients[ClientID];
+		if(pClient->m_State == CClient::STATE_EMPTY || !pClient->m_Authed)
+			continue;
+
+		int Budget = ListSyncBudget(ClientID);
+		int ConsoleAccessLevel = pClient->m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : IConsole::ACCESS_LEVEL_MOD;
+		while(Budget > 0 && pClient->m_pRconCmdToSend)
 		{
-			for(int i = 0; i < MAX_MAPLISTENTRY_SEND && m_aClients[ClientID].m_pMapListEntryToSend; ++i)
-			{
-				SendMapListEntryAdd(m_aClients[ClientID].m_pMapListEntryToSend, ClientID);
-				m_aClients[ClientID].m_pMapListEntryToSend = m_aClients[ClientID].m_pMapListEntryToSend->m_pNext;
-			}
+			Budget -= SendRconCmdAdd(pClient->m_pRconCmdToSend, ClientID);
+			pClient->m_pRconCmdToSend = pClient->m_pRconCmdToSend->NextCommandInfo(ConsoleAccessLevel, CFGFLAG_SERVER);
+		}
+		while(Budget > 0 && pClient->m_pMapListEntryToSend)
+		{
+			Budget -= SendMapListEntryAdd(pClient->m_pMapListEntryToSend, ClientID);
+			pClient->m_pMapListEntryToSend = pClient->m_pMapListEntryToSend->m_pNext;
 		}
 	}
 }
@@ -956,6 +1021,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 				bool ConnectAsSpec = m_aClients[ClientID].m_State == CClient::STATE_CONNECTING_AS_SPEC;
 				m_aClients[ClientID].m_State = CClient::STATE_READY;
+				m_InputRecorder.RecordConnect(ClientID, ConnectAsSpec);
 				GameServer()->OnClientConnected(ClientID, ConnectAsSpec);
 				SendConnectionReady(ClientID);
 			}
@@ -972,6 +1038,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
 				SendServerInfo(ClientID);
+				m_InputRecorder.RecordEnter(ClientID);
 				GameServer()->OnClientEnter(ClientID);
 			}
 		}
@@ -1030,7 +1097,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			// call the mod with the fresh input data
 			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+			{
+				m_InputRecorder.RecordInput(CInputRecord::DIRECT_INPUT, ClientID, m_aClients[ClientID].m_LatestInput.m_aData, MAX_INPUT_SIZE);
 				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			}
 		}
 		else if(Msg == NETMSG_RCON_CMD)
 		{
@@ -1144,7 +1214,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	{
 		// game message
 		if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && m_aClients[ClientID].m_State >= CClient::STATE_READY)
+		{
+			m_InputRecorder.RecordMessage(ClientID, pPacket->m_pData, pPacket->m_DataSize);
 			GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
 	}
 }
 
@@ -1375,6 +1448,8 @@ int CServer::Run()
 	}
 
 	m_NetServer.SetCallbacks(NewClientCallback, DelClientCallback, this);
+	m_NetServer.SetCoalesceFlush(g_Config.m_SvCoalesceFlush != 0);
+	m_NetServer.SetConnlessRates(g_Config.m_SvConnlessRate, g_Config.m_SvConnlessGlobalRate);
 
 	m_Econ.Init(Console(), &m_ServerBan);
 
@@ -1382,6 +1457,7 @@ int CServer::Run()
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", g_Config.m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
+	InputRecorder_HandleStart();
 	GameServer()->OnInit();
 	str_format(aBuf, sizeof(aBuf), "version %s", GameServer()->NetVersion());
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -1404,6 +1480,9 @@ int CServer::Run()
 	{
 		int64 ReportTime = time_get();
 		int ReportInterval = 3;
+		NETSTATS PrevStats;
+		m_NetServer.Stats(&PrevStats);
+		int PrevConnlessDropped = 0;
 
 		m_Lastheartbeat = 0;
 		m_GameStartTime = time_get();
@@ -1426,6 +1505,8 @@ int CServer::Run()
 					for(int c = 0; c < MAX_CLIENTS; c++)
 						aSpecs[c] = GameServer()->IsClientSpectator(c);
 
+					// recordings cover one map
+					m_InputRecorder.Stop();
 					GameServer()->OnShutdown();
 
 					for(int c = 0; c < MAX_CLIENTS; c++)
@@ -1441,6 +1522,7 @@ int CServer::Run()
 					m_GameStartTime = time_get();
 					m_CurrentGameTick = 0;
 					Kernel()->ReregisterInterface(GameServer());
+					InputRecorder_HandleStart();
 					GameServer()->OnInit();
 				}
 				else
@@ -1458,6 +1540,8 @@ int CServer::Run()
 				
 				if(m_PlayerCount)
 				{
+					m_InputRecorder.RecordTick(Tick());
+
 					// apply new input
 					for(int c = 0; c < MAX_CLIENTS; c++)
 					{
@@ -1468,13 +1552,19 @@ int CServer::Run()
 							if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
 							{
 								if(m_aClients[c].m_State == CClient::STATE_INGAME)
+								{
+									m_InputRecorder.RecordInput(CInputRecord::PREDICTED_INPUT, c, m_aClients[c].m_aInputs[i].m_aData, MAX_INPUT_SIZE);
 									GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
+								}
 								break;
 							}
 						}
 					}
 
+					m_InputRecorder.RecordGameTick();
 					GameServer()->OnTick();
+					if(m_InputRecorder.IsRecording())
+						m_InputRecorder.RecordChecksum(GameServer()->GameStateChecksum());
 				}
 				else
 				{
@@ -1489,8 +1579,10 @@ int CServer::Run()
 				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
 					DoSnapshot();
 
-				UpdateClientRconCommands();
-				UpdateClientMapListEntries();
+				UpdateClientRconLists();
+
+				// end of tick, send everything that got queued for flushing
+				m_NetServer.Flush();
 			}
 
 			// master server stuff
@@ -1498,26 +1590,35 @@ int CServer::Run()
 
 			PumpNetwork();
 
+			// replies to the received packets
+			m_NetServer.Flush();
+
 			if(ReportTime < time_get())
 			{
-				if(g_Config.m_Debug)
+				if(g_Config.m_DbgPref)
 				{
-					/*
-					static NETSTATS prev_stats;
-					NETSTATS stats;
-					netserver_stats(net, &stats);
-
-					perf_next();
+					NETSTATS Stats;
+					m_NetServer.Stats(&Stats);
 
-					if(config.dbg_pref)
-						perf_dump(&rootscope);
+					int NumPackets = Stats.sent_packets - PrevStats.sent_packets;
+					int NumBytes = Stats.sent_bytes - PrevStats.sent_bytes;
+					str_format(aBuf, sizeof(aBuf), "sent packets=%d/s payload=%d/s fill=%.1f%%",
+						NumPackets/ReportInterval, NumBytes/ReportInterval,
+						NumPackets ? NumBytes*100.0f/(NumPackets*(float)NET_MAX_PAYLOAD) : 0.0f);
+					Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
 
-					dbg_msg("server", "send=%8d recv=%8d",
-						(stats.send_bytes - prev_stats.send_bytes)/reportinterval,
-						(stats.recv_bytes - prev_stats.recv_bytes)/reportinterval);
+					PrevStats = Stats;
+				}
 
-					prev_stats = stats;
-					*/
+				// report floods of connless packets, this also reaches the econ
+				const CNetConnlessLimiter *pLimiter = m_NetServer.ConnlessLimiter();
+				int ConnlessDropped = pLimiter->NumDroppedPrefix()+pLimiter->NumDroppedGlobal();
+				if(ConnlessDropped != PrevConnlessDropped)
+				{
+					str_format(aBuf, sizeof(aBuf), "connless packets dropped=%d/s (total admitted=%d prefix=%d global=%d)",
+						(ConnlessDropped-PrevConnlessDropped)/ReportInterval, pLimiter->NumAdmitted(), pLimiter->NumDroppedPrefix(), pLimiter->NumDroppedGlobal());
+					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net", aBuf);
+					PrevConnlessDropped = ConnlessDropped;
 				}
 
 				ReportTime += time_freq()*ReportInterval;
@@ -1536,6 +1637,7 @@ int CServer::Run()
 		m_Econ.Shutdown();
 	}
 
+	m_InputRecorder.Stop();
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
 
@@ -1544,6 +1646,245 @@ int CServer::Run()
 	return 0;
 }
 
+int CServer::StartReplay(CInputRecordPlayer *pPlayer, const char *pFilename)
+{
+	if(pPlayer->Load(Storage(), pFilename) != 0)
+	{
+		dbg_msg("replay", "failed to load input recording '%s'", pFilename);
+		return -1;
+	}
+
+	str_copy(g_Config.m_SvMap, pPlayer->MapName(), sizeof(g_Config.m_SvMap));
+	if(!LoadMap(g_Config.m_SvMap))
+	{
+		dbg_msg("replay", "failed to load map. mapname='%s'", g_Config.m_SvMap);
+		return -1;
+	}
+	if(m_CurrentMapCrc != pPlayer->MapCrc())
+	{
+		dbg_msg("replay", "map '%s' differs from the recorded one", g_Config.m_SvMap);
+		return -1;
+	}
+
+	m_Replaying = true;
+	srand(pPlayer->Seed());
+	GameServer()->OnInit();
+	m_pConsole->StoreCommands(false);
+	return 0;
+}
+
+void CServer::StopReplay()
+{
+	GameServer()->OnShutdown();
+	m_pMap->Unload();
+	if(m_pCurrentMapData)
+		mem_free(m_pCurrentMapData);
+}
+
+// everything but the ticks and the snapshots
+void CServer::ReplayRecord(CInputRecord *pRecord)
+{
+	int ClientID = pRecord->m_ClientID;
+	if(ClientID >= MAX_CLIENTS)
+		return;
+
+	switch(pRecord->m_Type)
+	{
+	case CInputRecord::CONNECT:
+		NewClientCallbackImpl(ClientID, this);
+		m_aClients[ClientID].m_State = CClient::STATE_READY;
+		GameServer()->OnClientConnected(ClientID, pRecord->GetInt(0) != 0);
+		break;
+	case CInputRecord::ENTER:
+		m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+		GameServer()->OnClientEnter(ClientID);
+		break;
+	case CInputRecord::DROP:
+		// kicks by the game already happened in the replay
+		if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY)
+			DelClientCallback(ClientID, pRecord->GetString(4), this, pRecord->GetInt(0) != 0);
+		break;
+	case CInputRecord::DIRECT_INPUT:
+	case CInputRecord::PREDICTED_INPUT:
+		{
+			int aInput[MAX_INPUT_SIZE];
+			mem_zero(aInput, sizeof(aInput));
+			for(int i = 0; i < pRecord->NumInts() && i < MAX_INPUT_SIZE; i++)
+				aInput[i] = pRecord->GetInt(i);
+			if(pRecord->m_Type == CInputRecord::DIRECT_INPUT)
+				GameServer()->OnClientDirectInput(ClientID, aInput);
+			else
+				GameServer()->OnClientPredictedInput(ClientID, aInput);
+		}
+		break;
+	case CInputRecord::MESSAGE:
+		{
+			CUnpacker Unpacker;
+			Unpacker.Reset(pRecord->m_aData, pRecord->m_Size);
+			int Msg = Unpacker.GetInt()>>1;
+			if(!Unpacker.Error())
+				GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
+		break;
+	}
+}
+
+void CServer::OnReplayTick(int Tick)
+{
+	m_CurrentGameTick = Tick;
+}
+
+void CServer::OnReplayGameTick()
+{
+	GameServer()->OnTick();
+}
+
+unsigned CServer::ReplayChecksum()
+{
+	return GameServer()->GameStateChecksum();
+}
+
+void CServer::OnReplayRecord(CInputRecord *pRecord)
+{
+	if(pRecord->m_Type == CInputRecord::SNAP)
+		ReplaySnapshot(pRecord);
+	else
+		ReplayRecord(pRecord);
+}
+
+int CServer::RunReplay(const char *pFilename)
+{
+	CInputRecordPlayer Player;
+	if(StartReplay(&Player, pFilename) != 0)
+		return -1;
+
+	int64 StartTime = time_get();
+	CInputRecordPlayer::CReplayResult Result;
+	bool Matched = Player.Replay(this, &Result);
+	if(Matched)
+		dbg_msg("replay", "%d ticks replayed without differences in %.2fs", Result.m_NumTicks, (time_get()-StartTime)/(float)time_freq());
+	else
+		dbg_msg("replay", "diverged at tick %d, recorded=%08x replayed=%08x", Result.m_DivergedTick, Result.m_RecordedChecksum, Result.m_ReplayedChecksum);
+
+	StopReplay();
+	return Matched ? 0 : 1;
+}
+
+/*
+	Plays the inputs of a recording as fast as possible and times the game.
+	Unlike a replay the snapshots are really built, deltaed and compressed
+	for every client, as if each one acked the previous snapshot. After the
+	end of the recording the game keeps ticking with the last inputs until
+	NumTicks are done, 0 runs the recording once.
+*/
+int CServer::RunSimulation(const char *pFilename, int NumTicks)
+{
+	enum
+	{
+		PHASE_INPUT=0,
+		PHASE_TICK,
+		PHASE_SNAP,
+		NUM_PHASES
+	};
+	static const char *s_apPhaseNames[NUM_PHASES] = {"input", "tick", "snap"};
+
+	CInputRecordPlayer Player;
+	if(StartReplay(&Player, pFilename) != 0)
+		return -1;
+
+	int64 aPhaseTime[NUM_PHASES] = {0};
+	int NumSimulated = 0;
+	int NumSnaps = 0;
+	bool Ended = false;
+	CInputRecord Record;
+	int64 StartTime = time_get();
+	while(NumTicks ? NumSimulated < NumTicks : !Ended)
+	{
+		// apply everything the clients did up to the next tick
+		int64 Time = time_get();
+		bool Ticked = false;
+		while(!Ticked && !Ended)
+		{
+			if(!Player.NextRecord(&Record))
+			{
+				Ended = true;
+				break;
+			}
+
+			if(Record.m_Type == CInputRecord::TICK)
+				m_CurrentGameTick = Record.GetInt(0);
+			else if(Record.m_Type == CInputRecord::GAMETICK)
+				Ticked = true;
+			else if(Record.m_Type != CInputRecord::SNAP && Record.m_Type != CInputRecord::CHECKSUM)
+				ReplayRecord(&Record);
+		}
+		if(!Ticked)
+		{
+			if(!NumTicks)
+				break;
+			m_CurrentGameTick++;
+		}
+		aPhaseTime[PHASE_INPUT] += time_get()-Time;
+
+		Time = time_get();
+		GameServer()->OnTick();
+		aPhaseTime[PHASE_TICK] += time_get()-Time;
+
+		if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+		{
+			Time = time_get();
+			DoSnapshot();
+			aPhaseTime[PHASE_SNAP] += time_get()-Time;
+			NumSnaps++;
+
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				if(m_aClients[i].m_State != CClient::STATE_INGAME)
+					continue;
+				m_aClients[i].m_LastAckedSnapshot = m_CurrentGameTick;
+				m_aClients[i].m_SnapRate = CClient::SNAPRATE_FULL;
+			}
+		}
+
+		NumSimulated++;
+	}
+
+	int64 TotalTime = time_get()-StartTime;
+	double Seconds = TotalTime/(double)time_freq();
+	dbg_msg("simulate", "%d ticks, %d snapshots, %d players in %.3fs, %.0f ticks/s (%.1fx realtime)",
+		NumSimulated, NumSnaps, m_PlayerCount, Seconds, Seconds > 0 ? NumSimulated/Seconds : 0.0,
+		Seconds > 0 ? NumSimulated/Seconds/SERVER_TICK_SPEED : 0.0);
+	for(int i = 0; i < NUM_PHASES; i++)
+	{
+		double PhaseSeconds = aPhaseTime[i]/(double)time_freq();
+		dbg_msg("simulate", "  %-6s %9.3fms %8.2fus/tick %5.1f%%", s_apPhaseNames[i], PhaseSeconds*1000.0,
+			NumSimulated ? PhaseSeconds*1000000.0/NumSimulated : 0.0, TotalTime ? aPhaseTime[i]*100.0/TotalTime : 0.0);
+	}
+
+	StopReplay();
+	return 0;
+}
+
+// the game state can depend on which snapshots were made
+void CServer::ReplaySnapshot(const CInputRecord *pRecord)
+{
+	GameServer()->OnPreSnap();
+	if(pRecord->GetInt(0))
+	{
+		m_SnapshotBuilder.Init();
+		GameServer()->OnSnap(-1);
+	}
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pRecord->GetInt(1+i/32)&(1<<(i%32)))
+		{
+			m_SnapshotBuilder.Init();
+			GameServer()->OnSnap(i);
+		}
+	}
+	GameServer()->OnPostSnap();
+}
+
 int CServer::MapListEntryCallback(const char *pFilename, int IsDir, int DirType, void *pUser)
 {
 	CSubdirCallbackUserdata *pUserdata = (CSubdirCallbackUserdata *)pUser;
@@ -1664,6 +2005,25 @@ bool CServer::DemoRecorder_IsRecording()
 	return m_DemoRecorder.IsRecording();
 }
 
+void CServer::InputRecorder_HandleStart()
+{
+	if(!m_aInputRecordFile[0])
+		return;
+
+	// the game has to start from the same random state in the replay
+	unsigned Seed;
+	secure_random_fill(&Seed, sizeof(Seed));
+	srand(Seed);
+
+	char aBuf[256];
+	if(m_InputRecorder.Start(Storage(), m_aInputRecordFile, m_aCurrentMap, m_CurrentMapCrc, Seed) == 0)
+		str_format(aBuf, sizeof(aBuf), "recording inputs to '%s'", m_aInputRecordFile);
+	else
+		str_format(aBuf, sizeof(aBuf), "unable to open '%s' for recording", m_aInputRecordFile);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_record", aBuf);
+	m_aInputRecordFile[0] = 0;
+}
+
 void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 {
 	CServer* pServer = (CServer *)pUser;
@@ -1684,6 +2044,31 @@ void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
 	((CServer *)pUser)->m_DemoRecorder.Stop();
 }
 
+void CServer::ConInputRecord(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+	if(pResult->NumArguments())
+		str_format(pServer->m_aInputRecordFile, sizeof(pServer->m_aInputRecordFile), "inputs/%s.inputs", pResult->GetString(0));
+	else
+	{
+		char aDate[20];
+		str_timestamp(aDate, sizeof(aDate));
+		str_format(pServer->m_aInputRecordFile, sizeof(pServer->m_aInputRecordFile), "inputs/inputs_%s.inputs", aDate);
+	}
+
+	// a recording has to start with the map, reload it when it is running already
+	pServer->m_InputRecorder.Stop();
+	if(pServer->m_pCurrentMapData)
+		pServer->m_MapReload = 1;
+}
+
+void CServer::ConInputRecordStop(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+	pServer->m_aInputRecordFile[0] = 0;
+	pServer->m_InputRecorder.Stop();
+}
+
 void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_MapReload = 1;
@@ -1727,6 +2112,20 @@ void CServer::ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pU
 		((CServer *)pUserData)->m_NetServer.SetMaxClientsPerIP(pResult->GetInteger(0));
 }
 
+void CServer::ConchainCoalesceFlushUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+		((CServer *)pUserData)->m_NetServer.SetCoalesceFlush(pResult->GetInteger(0) != 0);
+}
+
+void CServer::ConchainConnlessRateUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+		((CServer *)pUserData)->m_NetServer.SetConnlessRates(g_Config.m_SvConnlessRate, g_Config.m_SvConnlessGlobalRate);
+}
+
 void CServer::ConchainModCommandUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	if(pResult->NumArguments() == 2)
@@ -1797,6 +2196,8 @@ void CServer::RegisterCommands()
 
 	Console()->Register("record", "?s", CFGFLAG_SERVER|CFGFLAG_STORE, ConRecord, this, "Record to a file");
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
+	Console()->Register("input_record", "?s", CFGFLAG_SERVER, ConInputRecord, this, "Reload the map and record all client inputs to a file");
+	Console()->Register("input_record_stop", "", CFGFLAG_SERVER, ConInputRecordStop, this, "Stop recording client inputs");
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 
@@ -1806,6 +2207,9 @@ void CServer::RegisterCommands()
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
 
 	Console()->Chain("sv_max_clients_per_ip", ConchainMaxclientsperipUpdate, this);
+	Console()->Chain("sv_coalesce_flush", ConchainCoalesceFlushUpdate, this);
+	Console()->Chain("sv_connless_rate", ConchainConnlessRateUpdate, this);
+	Console()->Chain("sv_connless_global_rate", ConchainConnlessRateUpdate, this);
 	Console()->Chain("mod_command", ConchainModCommandUpdate, this);
 	Console()->Chain("console_output_level", ConchainConsoleOutputLevelUpdate, this);
 	Console()->Chain("sv_rcon_password", ConchainRconPasswordSet, this);
@@ -1854,13 +2258,19 @@ int main(int argc, const char **argv) // ignore_convention
 #endif
 
 	bool UseDefaultConfig = false;
+	const char *pReplayFile = 0;
+	const char *pSimulateFile = 0;
+	int SimulateTicks = 0;
 	for(int i = 1; i < argc; i++) // ignore_convention
 	{
 		if(str_comp("-d", argv[i]) == 0 || str_comp("--default", argv[i]) == 0) // ignore_convention
-		{
 			UseDefaultConfig = true;
-			break;
-		}
+		else if(str_comp("--replay", argv[i]) == 0 && i+1 < argc) // ignore_convention
+			pReplayFile = argv[++i]; // ignore_convention
+		else if(str_comp("--simulate", argv[i]) == 0 && i+1 < argc) // ignore_convention
+			pSimulateFile = argv[++i]; // ignore_convention
+		else if(str_comp("--ticks", argv[i]) == 0 && i+1 < argc) // ignore_convention
+			SimulateTicks = max(str_toint(argv[++i]), 0); // ignore_convention
 	}
 
 	if(secure_random_init() != 0)
@@ -1931,8 +2341,22 @@ int main(int argc, const char **argv) // ignore_convention
 	pServer->InitRconPasswordIfUnset();
 
 	// run the server
-	dbg_msg("server", "starting...");
-	int Ret = pServer->Run();
+	int Ret;
+	if(pReplayFile)
+	{
+		dbg_msg("server", "replaying '%s'...", pReplayFile);
+		Ret = pServer->RunReplay(pReplayFile);
+	}
+	else if(pSimulateFile)
+	{
+		dbg_msg("server", "simulating '%s'...", pSimulateFile);
+		Ret = pServer->RunSimulation(pSimulateFile, SimulateTicks);
+	}
+	else
+	{
+		dbg_msg("server", "starting...");
+		Ret = pServer->Run();
+	}
 
 	// free
 	delete pServer;
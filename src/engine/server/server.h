@@ -4,6 +4,7 @@
 #define ENGINE_SERVER_SERVER_H
 
 #include <engine/server.h>
+#include <engine/shared/inputrecord.h>
 #include <engine/shared/memheap.h>
 
 class CSnapIDPool
@@ -59,7 +60,7 @@ public:
 };
 
 
-class CServer : public IServer
+class CServer : public IServer, public IInputReplayHandler
 {
 	class IGameServer *m_pGameServer;
 	class IConsole *m_pConsole;
@@ -77,10 +78,7 @@ public:
 		AUTHED_MOD,
 		AUTHED_ADMIN,
 
-		MAX_RCONCMD_SEND=16,
-		MAX_MAPLISTENTRY_SEND = 32,
 		MIN_MAPLIST_CLIENTVERSION=0x0703,	// todo 0.8: remove me
-		MAX_RCONCMD_RATIO=8,
 	};
 
 	struct CMapListEntry;
@@ -202,6 +200,9 @@ public:
 	int m_GeneratedRconPassword;
 
 	CDemoRecorder m_DemoRecorder;
+	CInputRecorder m_InputRecorder;
+	char m_aInputRecordFile[128]; // recording that starts with the next map
+	bool m_Replaying; // clients are played back from an input recording
 	CRegister m_Register;
 	CMapChecker m_MapChecker;
 
@@ -221,6 +222,8 @@ public:
 
 	void DemoRecorder_HandleAutoStart();
 	bool DemoRecorder_IsRecording();
+	void InputRecorder_HandleStart();
+	void DropClient(int ClientID, const char *pReason);
 
 	int64 TickStartTime(int Tick);
 
@@ -233,6 +236,7 @@ public:
 	bool IsBanned(int ClientID);
 	int GetClientInfo(int ClientID, CClientInfo *pInfo) const;
 	void GetClientAddr(int ClientID, char *pAddrStr, int Size) const;
+	void GetClientAddr(int ClientID, NETADDR *pAddr) const;
 	int GetClientVersion(int ClientID) const;
 	const char *ClientName(int ClientID) const;
 	const char *ClientClan(int ClientID) const;
@@ -241,6 +245,9 @@ public:
 	int MaxClients() const;
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
+	virtual int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask);
+	virtual int SendMsgRaw(const void *pData, int Size, int Flags, int ClientID);
+	virtual int ListSyncBudget(int ClientID) const;
 
 	void DoSnapshot();
 
@@ -253,12 +260,11 @@ public:
 	void SendRconLine(int ClientID, const char *pLine);
 	static void SendRconLineAuthed(const char *pLine, void *pUser, bool Highlighted);
 
-	void SendRconCmdAdd(const IConsole::CCommandInfo *pCommandInfo, int ClientID);
+	int SendRconCmdAdd(const IConsole::CCommandInfo *pCommandInfo, int ClientID);
 	void SendRconCmdRem(const IConsole::CCommandInfo *pCommandInfo, int ClientID);
-	void UpdateClientRconCommands();
-	void SendMapListEntryAdd(const CMapListEntry *pMapListEntry, int ClientID);
+	int SendMapListEntryAdd(const CMapListEntry *pMapListEntry, int ClientID);
 	void SendMapListEntryRem(const CMapListEntry *pMapListEntry, int ClientID);
-	void UpdateClientMapListEntries();
+	void UpdateClientRconLists();
 
 	void ProcessClientPacket(CNetChunk *pPacket);
 
@@ -272,6 +278,17 @@ public:
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
 	int Run();
+	int RunReplay(const char *pFilename);
+	int RunSimulation(const char *pFilename, int NumTicks);
+	int StartReplay(class CInputRecordPlayer *pPlayer, const char *pFilename);
+	void StopReplay();
+	void ReplayRecord(CInputRecord *pRecord);
+	void ReplaySnapshot(const CInputRecord *pRecord);
+
+	virtual void OnReplayTick(int Tick);
+	virtual void OnReplayGameTick();
+	virtual unsigned ReplayChecksum();
+	virtual void OnReplayRecord(CInputRecord *pRecord);
 
 	static int MapListEntryCallback(const char *pFilename, int IsDir, int DirType, void *pUser);
 
@@ -280,11 +297,15 @@ public:
 	static void ConShutdown(IConsole::IResult *pResult, void *pUser);
 	static void ConRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConStopRecord(IConsole::IResult *pResult, void *pUser);
+	static void ConInputRecord(IConsole::IResult *pResult, void *pUser);
+	static void ConInputRecordStop(IConsole::IResult *pResult, void *pUser);
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static void ConSaveConfig(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConchainCoalesceFlushUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConchainConnlessRateUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainModCommandUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainConsoleOutputLevelUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainRconPasswordSet(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
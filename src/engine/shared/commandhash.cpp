@@ -0,0 +1,120 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include "commandhash.h"
+
+CCommandHash::CCommandHash()
+{
+	m_pEntries = 0;
+	m_Capacity = 0;
+	Clear();
+}
+
+CCommandHash::~CCommandHash()
+{
+	if(m_pEntries)
+		mem_free(m_pEntries);
+}
+
+unsigned CCommandHash::Hash(const char *pName, int *pLength)
+{
+	// fnv-1a of the lower case name
+	unsigned Hash = 2166136261u;
+	int Length = 0;
+	for(; pName[Length] && !is_whitespace(pName[Length]); Length++)
+	{
+		unsigned char c = pName[Length];
+		if(c >= 'A' && c <= 'Z')
+			c += 'a'-'A';
+		Hash = (Hash^c)*16777619u;
+	}
+	if(pLength)
+		*pLength = Length;
+	return Hash;
+}
+
+void CCommandHash::Add(const char *pName, void *pCommand)
+{
+	if(m_FirstFree < 0)
+	{
+		int NewCapacity = m_Capacity ? m_Capacity*2 : (int)MIN_ENTRIES;
+		CEntry *pNewEntries = (CEntry *)mem_alloc(NewCapacity*sizeof(CEntry), sizeof(void*));
+		if(m_pEntries)
+		{
+			mem_copy(pNewEntries, m_pEntries, m_Capacity*sizeof(CEntry));
+			mem_free(m_pEntries);
+		}
+		for(int i = m_Capacity; i < NewCapacity; i++)
+			pNewEntries[i].m_Next = i+1 < NewCapacity ? i+1 : -1;
+		m_FirstFree = m_Capacity;
+		m_pEntries = pNewEntries;
+		m_Capacity = NewCapacity;
+	}
+
+	int Index = m_FirstFree;
+	CEntry *pEntry = &m_pEntries[Index];
+	m_FirstFree = pEntry->m_Next;
+
+	pEntry->m_Hash = Hash(pName, &pEntry->m_Length);
+	pEntry->m_pName = pName;
+	pEntry->m_pCommand = pCommand;
+
+	// the latest command with a name is found first
+	pEntry->m_Next = m_aBuckets[pEntry->m_Hash%NUM_BUCKETS];
+	m_aBuckets[pEntry->m_Hash%NUM_BUCKETS] = Index;
+	m_NumEntries++;
+}
+
+void CCommandHash::Remove(const char *pName, void *pCommand)
+{
+	int Length;
+	unsigned NameHash = Hash(pName, &Length);
+	for(int *pLink = &m_aBuckets[NameHash%NUM_BUCKETS]; *pLink >= 0; pLink = &m_pEntries[*pLink].m_Next)
+	{
+		int Index = *pLink;
+		if(m_pEntries[Index].m_pCommand != pCommand)
+			continue;
+
+		*pLink = m_pEntries[Index].m_Next;
+		m_pEntries[Index].m_Next = m_FirstFree;
+		m_FirstFree = Index;
+		m_NumEntries--;
+		return;
+	}
+}
+
+void CCommandHash::Clear()
+{
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] = -1;
+	for(int i = 0; i < m_Capacity; i++)
+		m_pEntries[i].m_Next = i+1 < m_Capacity ? i+1 : -1;
+	m_FirstFree = m_Capacity ? 0 : -1;
+	m_NumEntries = 0;
+}
+
+int CCommandHash::FindFrom(int Index, unsigned Hash, const char *pName, int Length) const
+{
+	for(; Index >= 0; Index = m_pEntries[Index].m_Next)
+	{
+		const CEntry *pEntry = &m_pEntries[Index];
+		if(pEntry->m_Hash == Hash && pEntry->m_Length == Length && str_comp_nocase_num(pEntry->m_pName, pName, Length) == 0)
+			return Index;
+	}
+	return -1;
+}
+
+int CCommandHash::First(const char *pName) const
+{
+	if(!pName)
+		return -1;
+	int Length;
+	unsigned NameHash = Hash(pName, &Length);
+	return FindFrom(m_aBuckets[NameHash%NUM_BUCKETS], NameHash, pName, Length);
+}
+
+int CCommandHash::Next(int Index) const
+{
+	const CEntry *pEntry = &m_pEntries[Index];
+	return FindFrom(pEntry->m_Next, pEntry->m_Hash, pEntry->m_pName, pEntry->m_Length);
+}
@@ -0,0 +1,56 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_COMMANDHASH_H
+#define ENGINE_SHARED_COMMANDHASH_H
+
+// case insensitive index from command names to commands. the commands stay where
+// their owner keeps them, their names have to stay valid while they are added.
+// names end at the first whitespace, so a whole command line can be looked up.
+// several commands can share a name, they are visited latest first with Next().
+class CCommandHash
+{
+	struct CEntry
+	{
+		unsigned m_Hash;
+		int m_Length;
+		const char *m_pName;
+		void *m_pCommand;
+		// next entry in the bucket or the next free entry
+		int m_Next;
+	};
+
+	enum
+	{
+		NUM_BUCKETS=512,
+		MIN_ENTRIES=64,
+	};
+
+	int m_aBuckets[NUM_BUCKETS];
+	CEntry *m_pEntries;
+	int m_Capacity;
+	int m_NumEntries;
+	int m_FirstFree;
+
+	int FindFrom(int Index, unsigned Hash, const char *pName, int Length) const;
+
+public:
+	CCommandHash();
+	~CCommandHash();
+
+	static unsigned Hash(const char *pName, int *pLength);
+
+	void Add(const char *pName, void *pCommand);
+	void Remove(const char *pName, void *pCommand);
+	void Clear();
+
+	// index of the first command with the name, -1 if there is none
+	int First(const char *pName) const;
+	// index of the next command with the same name
+	int Next(int Index) const;
+	void *Get(int Index) const { return m_pEntries[Index].m_pCommand; }
+	void *Find(const char *pName) const { int Index = First(pName); return Index < 0 ? 0 : Get(Index); }
+
+	int Num() const { return m_NumEntries; }
+};
+
+#endif
@@ -83,8 +83,12 @@ MACRO_CONFIG_INT(SvExternalPort, sv_external_port, 0, 0, 0, CFGFLAG_SAVE|CFGFLAG
 MACRO_CONFIG_STR(SvMap, sv_map, 128, "dm1", CFGFLAG_SAVE|CFGFLAG_SERVER, "Map to use on the server")
 MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 8, 1, MAX_CLIENTS, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of clients that are allowed on a server")
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 4, 1, MAX_CLIENTS, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
+MACRO_CONFIG_INT(SvListSyncBudget, sv_list_sync_budget, 1024, 256, 8192, CFGFLAG_SAVE|CFGFLAG_SERVER, "Bytes of vote options, commands and map names a client gets per tick while its lists are sent")
 MACRO_CONFIG_INT(SvMapDownloadSpeed, sv_map_download_speed, 2, 1, 16, CFGFLAG_SAVE|CFGFLAG_SERVER, "Number of map data packages a client gets on each request")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
+MACRO_CONFIG_INT(SvCoalesceFlush, sv_coalesce_flush, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Send all messages of a tick in as few packets as possible instead of flushing each message")
+MACRO_CONFIG_INT(SvConnlessRate, sv_connless_rate, 20, 0, 10000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Packets per second answered for one /24 (or /48) network without a connection (0 for no limit)")
+MACRO_CONFIG_INT(SvConnlessGlobalRate, sv_connless_global_rate, 1000, 0, 100000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Packets per second answered for all addresses without a connection (0 for no limit)")
 MACRO_CONFIG_INT(SvRegister, sv_register, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Register server with master server for public listing")
 MACRO_CONFIG_STR(SvRconPassword, sv_rcon_password, 32, "", CFGFLAG_SAVE|CFGFLAG_SERVER, "Remote console password (full access)")
 MACRO_CONFIG_STR(SvRconModPassword, sv_rcon_mod_password, 32, "", CFGFLAG_SAVE|CFGFLAG_SERVER, "Remote console password for moderators (limited access)")
@@ -93,6 +97,9 @@ MACRO_CONFIG_INT(SvRconBantime, sv_rcon_bantime, 5, 0, 1440, CFGFLAG_SAVE|CFGFLA
 MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
 
+MACRO_CONFIG_STR(BanJournal, ban_journal, 128, "", CFGFLAG_SAVE|CFGFLAG_SERVER|CFGFLAG_MASTER, "Binary banlist file every ban and unban gets appended to")
+MACRO_CONFIG_STR(BanSharedMemory, ban_shared_memory, 64, "", CFGFLAG_SAVE|CFGFLAG_SERVER|CFGFLAG_MASTER, "Name of a banlist in shared memory used by all servers on this host (empty for a local banlist)")
+
 MACRO_CONFIG_STR(EcBindaddr, ec_bindaddr, 128, "localhost", CFGFLAG_SAVE|CFGFLAG_ECON, "Address to bind the external console to. Anything but 'localhost' is dangerous")
 MACRO_CONFIG_INT(EcPort, ec_port, 0, 0, 0, CFGFLAG_SAVE|CFGFLAG_ECON, "Port to use for the external console")
 MACRO_CONFIG_STR(EcPassword, ec_password, 32, "", CFGFLAG_SAVE|CFGFLAG_ECON, "External console password")
@@ -373,13 +373,11 @@ void CConsole::PossibleMaps(const char *pStr, FPossibleCallback pfnCallback, voi
 
 CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(int i = m_CommandHash.First(pName); i >= 0; i = m_CommandHash.Next(i))
 	{
+		CCommand *pCommand = static_cast<CCommand *>(m_CommandHash.Get(i));
 		if(pCommand->m_Flags&FlagMask)
-		{
-			if(str_comp_nocase(pCommand->m_pName, pName) == 0)
-				return pCommand;
-		}
+			return pCommand;
 	}
 
 	return 0x0;
@@ -742,6 +740,12 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 			// skip silent, default param
 			continue;
 		}
+		else if(!str_comp("--replay", ppArguments[i]) || !str_comp("--simulate", ppArguments[i]) ||
+				!str_comp("--ticks", ppArguments[i]))
+		{
+			// skip the input recording and its tick count, the server plays it
+			i++;
+		}
 		else
 		{
 			// search arguments for overrides
@@ -752,6 +756,8 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 
 void CConsole::AddCommandSorted(CCommand *pCommand)
 {
+	m_CommandHash.Add(pCommand->m_pName, pCommand);
+
 	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
 	{
 		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
@@ -859,6 +865,7 @@ void CConsole::DeregisterTemp(const char *pName)
 	// add to recycle list
 	if(pRemoved)
 	{
+		m_CommandHash.Remove(pRemoved->m_pName, pRemoved);
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
 	}
@@ -866,6 +873,12 @@ void CConsole::DeregisterTemp(const char *pName)
 
 void CConsole::DeregisterTempAll()
 {
+	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	{
+		if(pCommand->m_Temp)
+			m_CommandHash.Remove(pCommand->m_pName, pCommand);
+	}
+
 	// set non temp as first one
 	for(; m_pFirstCommand && m_pFirstCommand->m_Temp; m_pFirstCommand = m_pFirstCommand->m_pNext);
 
@@ -995,13 +1008,11 @@ void CConsole::StoreCommands(bool Store)
 
 const IConsole::CCommandInfo *CConsole::GetCommandInfo(const char *pName, int FlagMask, bool Temp)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(int i = m_CommandHash.First(pName); i >= 0; i = m_CommandHash.Next(i))
 	{
+		CCommand *pCommand = static_cast<CCommand *>(m_CommandHash.Get(i));
 		if(pCommand->m_Flags&FlagMask && pCommand->m_Temp == Temp)
-		{
-			if(str_comp_nocase(pCommand->m_pName, pName) == 0)
-				return pCommand;
-		}
+			return pCommand;
 	}
 
 	return 0;
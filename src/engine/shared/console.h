@@ -5,6 +5,7 @@
 
 #include <new>
 #include <engine/console.h>
+#include "commandhash.h"
 #include "memheap.h"
 
 class CConsole : public IConsole
@@ -37,7 +38,9 @@ class CConsole : public IConsole
 	int m_FlagMask;
 	bool m_StoreCommands;
 	const char *m_paStrokeStr[2];
+	// sorted for listing and completion, the hash is for looking them up
 	CCommand *m_pFirstCommand;
+	CCommandHash m_CommandHash;
 
 	class CExecFile
 	{
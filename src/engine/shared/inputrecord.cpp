@@ -0,0 +1,266 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <engine/storage.h>
+
+#include "inputrecord.h"
+
+static const char gs_aHeaderMarker[8] = {'T', 'W', 'I', 'N', 'P', 'U', 'T', 0};
+static const unsigned char gs_ActVersion = 1;
+
+// everything is stored big endian
+static void PutInt(unsigned char *pBuf, unsigned Value)
+{
+	pBuf[0] = (Value>>24)&0xff;
+	pBuf[1] = (Value>>16)&0xff;
+	pBuf[2] = (Value>>8)&0xff;
+	pBuf[3] = Value&0xff;
+}
+
+static unsigned ReadInt(const unsigned char *pBuf)
+{
+	return (pBuf[0]<<24) | (pBuf[1]<<16) | (pBuf[2]<<8) | pBuf[3];
+}
+
+int CInputRecord::GetInt(int Index) const
+{
+	if(Index < 0 || Index >= NumInts())
+		return 0;
+	return ReadInt(&m_aData[Index*4]);
+}
+
+const char *CInputRecord::GetString(int Offset)
+{
+	if(Offset >= m_Size)
+		return "";
+	m_aData[m_Size-1] = 0;
+	return (const char *)&m_aData[Offset];
+}
+
+CInputRecorder::CInputRecorder()
+{
+	m_File = 0;
+}
+
+CInputRecorder::~CInputRecorder()
+{
+	Stop();
+}
+
+int CInputRecorder::Start(IStorage *pStorage, const char *pFilename, const char *pMap, unsigned MapCrc, unsigned Seed)
+{
+	if(m_File)
+		return -1;
+
+	m_File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!m_File)
+		return -1;
+
+	CInputRecordHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aMarker, gs_aHeaderMarker, sizeof(Header.m_aMarker));
+	Header.m_Version = gs_ActVersion;
+	str_copy(Header.m_aMap, pMap, sizeof(Header.m_aMap));
+	PutInt(Header.m_aMapCrc, MapCrc);
+	PutInt(Header.m_aSeed, Seed);
+	io_write(m_File, &Header, sizeof(Header));
+	io_flush(m_File);
+	return 0;
+}
+
+int CInputRecorder::Stop()
+{
+	if(!m_File)
+		return -1;
+
+	io_close(m_File);
+	m_File = 0;
+	return 0;
+}
+
+void CInputRecorder::Write(int Type, int ClientID, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	if(Size > CInputRecord::MAX_DATA_SIZE)
+		Size = CInputRecord::MAX_DATA_SIZE;
+
+	unsigned char aChunk[4];
+	aChunk[0] = Type;
+	aChunk[1] = ClientID;
+	aChunk[2] = (Size>>8)&0xff;
+	aChunk[3] = Size&0xff;
+	io_write(m_File, aChunk, sizeof(aChunk));
+	if(Size)
+		io_write(m_File, pData, Size);
+}
+
+void CInputRecorder::WriteInts(int Type, int ClientID, const int *pData, int Num)
+{
+	unsigned char aData[CInputRecord::MAX_DATA_SIZE];
+	if(Num > CInputRecord::MAX_DATA_SIZE/4)
+		Num = CInputRecord::MAX_DATA_SIZE/4;
+	for(int i = 0; i < Num; i++)
+		PutInt(&aData[i*4], pData[i]);
+	Write(Type, ClientID, aData, Num*4);
+}
+
+void CInputRecorder::RecordTick(int Tick)
+{
+	WriteInts(CInputRecord::TICK, 0, &Tick, 1);
+}
+
+void CInputRecorder::RecordGameTick()
+{
+	Write(CInputRecord::GAMETICK, 0, 0, 0);
+}
+
+void CInputRecorder::RecordChecksum(unsigned Checksum)
+{
+	int Value = Checksum;
+	WriteInts(CInputRecord::CHECKSUM, 0, &Value, 1);
+
+	// the checksum ends a tick, keep complete ticks on disk in case the server crashes
+	if(m_File)
+		io_flush(m_File);
+}
+
+void CInputRecorder::RecordSnap(const int *pClientMask, int Num)
+{
+	WriteInts(CInputRecord::SNAP, 0, pClientMask, Num);
+}
+
+void CInputRecorder::RecordConnect(int ClientID, bool AsSpec)
+{
+	int Value = AsSpec;
+	WriteInts(CInputRecord::CONNECT, ClientID, &Value, 1);
+}
+
+void CInputRecorder::RecordEnter(int ClientID)
+{
+	Write(CInputRecord::ENTER, ClientID, 0, 0);
+}
+
+void CInputRecorder::RecordDrop(int ClientID, const char *pReason, bool Force)
+{
+	unsigned char aData[256];
+	PutInt(aData, Force);
+	str_copy((char *)&aData[4], pReason, sizeof(aData)-4);
+	Write(CInputRecord::DROP, ClientID, aData, 4+str_length((char *)&aData[4])+1);
+}
+
+void CInputRecorder::RecordInput(int Type, int ClientID, const int *pData, int Num)
+{
+	// the input buffers are much larger than the inputs in them
+	while(Num > 0 && pData[Num-1] == 0)
+		Num--;
+	WriteInts(Type, ClientID, pData, Num);
+}
+
+void CInputRecorder::RecordMessage(int ClientID, const void *pData, int Size)
+{
+	Write(CInputRecord::MESSAGE, ClientID, pData, Size);
+}
+
+CInputRecordPlayer::CInputRecordPlayer()
+{
+	m_File = 0;
+	mem_zero(&m_Header, sizeof(m_Header));
+}
+
+CInputRecordPlayer::~CInputRecordPlayer()
+{
+	Stop();
+}
+
+int CInputRecordPlayer::Load(IStorage *pStorage, const char *pFilename)
+{
+	Stop();
+
+	m_File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!m_File)
+		return -1;
+
+	if(io_read(m_File, &m_Header, sizeof(m_Header)) != sizeof(m_Header) ||
+		mem_comp(m_Header.m_aMarker, gs_aHeaderMarker, sizeof(gs_aHeaderMarker)) != 0 ||
+		m_Header.m_Version != gs_ActVersion)
+	{
+		Stop();
+		return -1;
+	}
+	m_Header.m_aMap[sizeof(m_Header.m_aMap)-1] = 0;
+	return 0;
+}
+
+void CInputRecordPlayer::Stop()
+{
+	if(m_File)
+		io_close(m_File);
+	m_File = 0;
+}
+
+unsigned CInputRecordPlayer::MapCrc() const
+{
+	return ReadInt(m_Header.m_aMapCrc);
+}
+
+unsigned CInputRecordPlayer::Seed() const
+{
+	return ReadInt(m_Header.m_aSeed);
+}
+
+bool CInputRecordPlayer::NextRecord(CInputRecord *pRecord)
+{
+	if(!m_File)
+		return false;
+
+	unsigned char aChunk[4];
+	if(io_read(m_File, aChunk, sizeof(aChunk)) != sizeof(aChunk))
+		return false;
+
+	pRecord->m_Type = aChunk[0];
+	pRecord->m_ClientID = aChunk[1];
+	pRecord->m_Size = (aChunk[2]<<8) | aChunk[3];
+	if(pRecord->m_Size > CInputRecord::MAX_DATA_SIZE)
+		return false;
+	if(pRecord->m_Size && io_read(m_File, pRecord->m_aData, pRecord->m_Size) != (unsigned)pRecord->m_Size)
+		return false;
+	return true;
+}
+
+bool CInputRecordPlayer::Replay(IInputReplayHandler *pHandler, CReplayResult *pResult)
+{
+	pResult->m_NumTicks = 0;
+	pResult->m_DivergedTick = -1;
+	pResult->m_RecordedChecksum = 0;
+	pResult->m_ReplayedChecksum = 0;
+
+	int Tick = 0;
+	CInputRecord Record;
+	while(NextRecord(&Record))
+	{
+		switch(Record.m_Type)
+		{
+		case CInputRecord::TICK:
+			Tick = Record.GetInt(0);
+			pHandler->OnReplayTick(Tick);
+			break;
+		case CInputRecord::GAMETICK:
+			pHandler->OnReplayGameTick();
+			break;
+		case CInputRecord::CHECKSUM:
+			pResult->m_RecordedChecksum = Record.GetInt(0);
+			pResult->m_ReplayedChecksum = pHandler->ReplayChecksum();
+			if(pResult->m_RecordedChecksum != pResult->m_ReplayedChecksum)
+			{
+				pResult->m_DivergedTick = Tick;
+				return false;
+			}
+			pResult->m_NumTicks++;
+			break;
+		default:
+			pHandler->OnReplayRecord(&Record);
+		}
+	}
+	return true;
+}
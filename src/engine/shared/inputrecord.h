@@ -0,0 +1,122 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_INPUTRECORD_H
+#define ENGINE_SHARED_INPUTRECORD_H
+
+#include <base/system.h>
+
+/*
+	Input recordings hold everything the clients made the game server do on
+	one map, in the order it happened, together with a checksum of the game
+	state after every tick. Playing one back with the same config has to
+	produce the same checksums as long as the simulation didn't change.
+*/
+struct CInputRecord
+{
+	enum
+	{
+		TICK=1, // the server advanced to the tick in the data
+		GAMETICK, // the game ticked
+		CHECKSUM, // game state after the tick
+		SNAP, // data is whether the demo got a snapshot and the mask of the snapped clients
+		CONNECT, // data is whether the client connects as spectator
+		ENTER,
+		DROP, // data is whether the drop was forced and the reason
+		DIRECT_INPUT,
+		PREDICTED_INPUT,
+		MESSAGE, // data is the whole game message chunk
+
+		MAX_DATA_SIZE=2048,
+	};
+
+	int m_Type;
+	int m_ClientID;
+	int m_Size;
+	unsigned char m_aData[MAX_DATA_SIZE];
+
+	int NumInts() const { return m_Size/4; }
+	int GetInt(int Index) const;
+	// string behind the first ints
+	const char *GetString(int Offset);
+};
+
+struct CInputRecordHeader
+{
+	char m_aMarker[8];
+	unsigned char m_Version;
+	char m_aMap[64];
+	unsigned char m_aMapCrc[4];
+	unsigned char m_aSeed[4];
+};
+
+class CInputRecorder
+{
+	IOHANDLE m_File;
+
+	void Write(int Type, int ClientID, const void *pData, int Size);
+	void WriteInts(int Type, int ClientID, const int *pData, int Num);
+
+public:
+	CInputRecorder();
+	~CInputRecorder();
+
+	int Start(class IStorage *pStorage, const char *pFilename, const char *pMap, unsigned MapCrc, unsigned Seed);
+	int Stop();
+	bool IsRecording() const { return m_File != 0; }
+
+	void RecordTick(int Tick);
+	void RecordGameTick();
+	void RecordChecksum(unsigned Checksum);
+	void RecordSnap(const int *pClientMask, int Num);
+	void RecordConnect(int ClientID, bool AsSpec);
+	void RecordEnter(int ClientID);
+	void RecordDrop(int ClientID, const char *pReason, bool Force);
+	void RecordInput(int Type, int ClientID, const int *pData, int Num);
+	void RecordMessage(int ClientID, const void *pData, int Size);
+};
+
+// what a replay is played into
+class IInputReplayHandler
+{
+public:
+	virtual ~IInputReplayHandler() {}
+
+	virtual void OnReplayTick(int Tick) = 0;
+	virtual void OnReplayGameTick() = 0;
+	virtual unsigned ReplayChecksum() = 0;
+	// everything else: snapshots, clients and their inputs and messages
+	virtual void OnReplayRecord(CInputRecord *pRecord) = 0;
+};
+
+class CInputRecordPlayer
+{
+	IOHANDLE m_File;
+	CInputRecordHeader m_Header;
+
+public:
+	struct CReplayResult
+	{
+		int m_NumTicks; // ticks whose checksum matched
+		int m_DivergedTick; // -1 if all checksums matched
+		unsigned m_RecordedChecksum;
+		unsigned m_ReplayedChecksum;
+	};
+
+	CInputRecordPlayer();
+	~CInputRecordPlayer();
+
+	int Load(class IStorage *pStorage, const char *pFilename);
+	void Stop();
+
+	const char *MapName() const { return m_Header.m_aMap; }
+	unsigned MapCrc() const;
+	unsigned Seed() const;
+
+	// false at the end of the recording or when it is broken
+	bool NextRecord(CInputRecord *pRecord);
+	// plays the rest of the recording and stops at the first checksum that differs,
+	// false if the replay diverged
+	bool Replay(IInputReplayHandler *pHandler, CReplayResult *pResult);
+};
+
+#endif
@@ -19,45 +19,189 @@ bool CNetBan::StrAllnum(const char *pStr)
 }
 
 
-CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
+static inline int GetBit(const unsigned char *pIp, int Bit)
 {
-	if(pAddr->type==NETTYPE_IPV4)
-		m_Hash = (pAddr->ip[0]+pAddr->ip[1]+pAddr->ip[2]+pAddr->ip[3])&0xFF;
-	else
-		m_Hash = (pAddr->ip[0]+pAddr->ip[1]+pAddr->ip[2]+pAddr->ip[3]+pAddr->ip[4]+pAddr->ip[5]+pAddr->ip[6]+pAddr->ip[7]+
-			pAddr->ip[8]+pAddr->ip[9]+pAddr->ip[10]+pAddr->ip[11]+pAddr->ip[12]+pAddr->ip[13]+pAddr->ip[14]+pAddr->ip[15])&0xFF;
-	m_HashIndex = 0;
+	return (pIp[Bit>>3]>>(7-(Bit&7)))&1;
+}
+
+// number of leading bits both buffers have in common, at most MaxLength
+static int CommonPrefixLength(const unsigned char *pIp1, const unsigned char *pIp2, int MaxLength)
+{
+	int Length = 0;
+	while(Length+8 <= MaxLength && pIp1[Length>>3] == pIp2[Length>>3])
+		Length += 8;
+	while(Length < MaxLength && GetBit(pIp1, Length) == GetBit(pIp2, Length))
+		Length++;
+	return Length;
+}
+
+CNetBan::CNetPrefix::CNetPrefix(const NETADDR *pAddr)
+{
+	m_Family = Family(pAddr);
+	m_Length = MaxLength(pAddr);
+	m_pIp = pAddr->ip;
+}
+
+CNetBan::CNetPrefix::CNetPrefix(const CNetRange *pRange)
+{
+	m_Family = Family(&pRange->m_LB);
+	m_Length = CommonPrefixLength(pRange->m_LB.ip, pRange->m_UB.ip, MaxLength(&pRange->m_LB));
+	m_pIp = pRange->m_LB.ip;
+}
+
+
+static const unsigned char s_aBanlistMagic[4] = {'T', 'W', 'B', 'L'};
+
+static unsigned char *PackNet(unsigned char *pBuf, const NETADDR *pAddr)
+{
+	int Length = pAddr->type==NETTYPE_IPV4 ? 4 : 16;
+	*pBuf++ = Length;
+	mem_copy(pBuf, pAddr->ip, Length);
+	return pBuf+Length;
+}
+
+static unsigned char *PackNet(unsigned char *pBuf, const CNetRange *pRange)
+{
+	return PackNet(PackNet(pBuf, &pRange->m_LB), &pRange->m_UB);
+}
+
+static const unsigned char *UnpackNet(const unsigned char *pBuf, const unsigned char *pEnd, NETADDR *pAddr)
+{
+	if(!pBuf || pBuf >= pEnd || (pBuf[0] != 4 && pBuf[0] != 16) || pEnd-pBuf < 1+pBuf[0])
+		return 0;
+
+	mem_zero(pAddr, sizeof(*pAddr));
+	pAddr->type = pBuf[0] == 4 ? NETTYPE_IPV4 : NETTYPE_IPV6;
+	mem_copy(pAddr->ip, pBuf+1, pBuf[0]);
+	return pBuf+1+pBuf[0];
+}
+
+static const unsigned char *UnpackNet(const unsigned char *pBuf, const unsigned char *pEnd, CNetRange *pRange)
+{
+	return UnpackNet(UnpackNet(pBuf, pEnd, &pRange->m_LB), pEnd, &pRange->m_UB);
+}
+
+static int RecordNetFlag(const NETADDR *pAddr) { return 0; }
+static int RecordNetFlag(const CNetRange *pRange) { return 0x80; }
+
+
+template<class T, int MaxBans>
+typename CNetBan::CBanNode<T> *CNetBan::CBanPool<T, MaxBans>::NewNode(const unsigned char *pPrefix, int Length, CBanNode<T> *pParent)
+{
+	CBanNode<T> *pNode = m_pFirstFreeNode;
+	dbg_assert(pNode != 0, "ban trie out of nodes");
+	m_pFirstFreeNode = pNode->m_pParent;
+
+	mem_zero(pNode, sizeof(*pNode));
+	mem_copy(pNode->m_aPrefix, pPrefix, (Length+7)/8);
+	if(Length&7)
+		pNode->m_aPrefix[Length>>3] &= 0xff<<(8-(Length&7));
+	pNode->m_Length = Length;
+	pNode->m_pParent = pParent;
+	return pNode;
 }
 
-CNetBan::CNetHash::CNetHash(const CNetRange *pRange)
+template<class T, int MaxBans>
+typename CNetBan::CBanNode<T> *CNetBan::CBanPool<T, MaxBans>::FindNode(const CNetPrefix *pPrefix) const
 {
-	m_Hash = 0;
-	m_HashIndex = 0;
-	for(int i = 0; pRange->m_LB.ip[i] == pRange->m_UB.ip[i]; ++i)
+	CBanNode<T> *pNode = m_apRoot[pPrefix->m_Family];
+	while(pNode && pNode->m_Length <= pPrefix->m_Length)
 	{
-		m_Hash += pRange->m_LB.ip[i];
-		++m_HashIndex;
+		if(CommonPrefixLength(pNode->m_aPrefix, pPrefix->m_pIp, pNode->m_Length) < pNode->m_Length)
+			return 0;
+		if(pNode->m_Length == pPrefix->m_Length)
+			return pNode;
+		pNode = pNode->m_apChild[GetBit(pPrefix->m_pIp, pNode->m_Length)];
 	}
-	m_Hash &= 0xFF;
+	return 0;
 }
 
-int CNetBan::CNetHash::MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17])
+template<class T, int MaxBans>
+typename CNetBan::CBanNode<T> *CNetBan::CBanPool<T, MaxBans>::InsertNode(const CNetPrefix *pPrefix)
 {
-	int Length = pAddr->type==NETTYPE_IPV4 ? 4 : 16;
-	aHash[0].m_Hash = 0;
-	aHash[0].m_HashIndex = 0;
-	for(int i = 1, Sum = 0; i <= Length; ++i)
+	CBanNode<T> **ppLink = &m_apRoot[pPrefix->m_Family];
+	CBanNode<T> *pParent = 0;
+	while(1)
 	{
-		Sum += pAddr->ip[i-1];
-		aHash[i].m_Hash = Sum&0xFF;
-		aHash[i].m_HashIndex = i%Length;
+		CBanNode<T> *pNode = *ppLink;
+		if(!pNode)
+		{
+			*ppLink = NewNode(pPrefix->m_pIp, pPrefix->m_Length, pParent);
+			return *ppLink;
+		}
+
+		int Common = CommonPrefixLength(pNode->m_aPrefix, pPrefix->m_pIp, min(pNode->m_Length, pPrefix->m_Length));
+		if(Common == pNode->m_Length)
+		{
+			if(Common == pPrefix->m_Length)
+				return pNode;
+
+			// descend
+			pParent = pNode;
+			ppLink = &pNode->m_apChild[GetBit(pPrefix->m_pIp, Common)];
+			continue;
+		}
+
+		// the prefixes diverge inside this edge, split it
+		CBanNode<T> *pSplit = NewNode(pPrefix->m_pIp, Common, pParent);
+		pSplit->m_apChild[GetBit(pNode->m_aPrefix, Common)] = pNode;
+		pNode->m_pParent = pSplit;
+		*ppLink = pSplit;
+		if(Common == pPrefix->m_Length)
+			return pSplit;
+
+		CBanNode<T> *pLeaf = NewNode(pPrefix->m_pIp, pPrefix->m_Length, pSplit);
+		pSplit->m_apChild[GetBit(pPrefix->m_pIp, Common)] = pLeaf;
+		return pLeaf;
 	}
-	return Length;
 }
 
+template<class T, int MaxBans>
+void CNetBan::CBanPool<T, MaxBans>::CollapseNode(CBanNode<T> *pNode)
+{
+	// drop nodes that neither hold bans nor branch
+	while(pNode && !pNode->m_pFirstBan && !(pNode->m_apChild[0] && pNode->m_apChild[1]))
+	{
+		CBanNode<T> *pChild = pNode->m_apChild[0] ? pNode->m_apChild[0] : pNode->m_apChild[1];
+		CBanNode<T> *pParent = pNode->m_pParent;
+		if(pParent)
+			pParent->m_apChild[GetBit(pNode->m_aPrefix, pParent->m_Length)] = pChild;
+		else
+			m_apRoot[m_apRoot[0] == pNode ? 0 : 1] = pChild;
+		if(pChild)
+			pChild->m_pParent = pParent;
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData, const CBanInfo *pInfo,  const CNetHash *pNetHash)
+		pNode->m_pParent = m_pFirstFreeNode;
+		m_pFirstFreeNode = pNode;
+
+		// the parent only lost a branch if there was nothing to move up
+		pNode = pChild ? 0 : pParent;
+	}
+}
+
+template<class T, int MaxBans>
+void CNetBan::CBanPool<T, MaxBans>::InsertUsed(CBan<T> *pBan)
+{
+	// the list is sorted by expiry, search from the back as new bans tend to expire last
+	CBan<T> *p = m_pLastUsed;
+	while(p && (p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pBan->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && pBan->m_Info.m_Expires <= p->m_Info.m_Expires)))
+		p = p->m_pPrev;
+
+	// insert after p
+	pBan->m_pPrev = p;
+	pBan->m_pNext = p ? p->m_pNext : m_pFirstUsed;
+	if(pBan->m_pNext)
+		pBan->m_pNext->m_pPrev = pBan;
+	else
+		m_pLastUsed = pBan;
+	if(p)
+		p->m_pNext = pBan;
+	else
+		m_pFirstUsed = pBan;
+}
+
+template<class T, int MaxBans>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, MaxBans>::Add(const T *pData, const CBanInfo *pInfo)
 {
 	if(!m_pFirstFree)
 		return 0;
@@ -66,7 +210,6 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	CBan<T> *pBan = m_pFirstFree;
 	pBan->m_Data = *pData;
 	pBan->m_Info = *pInfo;
-	pBan->m_NetHash = *pNetHash;
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
 	if(pBan->m_pPrev)
@@ -74,71 +217,48 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	else
 		m_pFirstFree = pBan->m_pNext;
 
-	// add it to the hash list
-	if(m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash])
-		m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]->m_pHashPrev = pBan;
-	pBan->m_pHashPrev = 0;
-	pBan->m_pHashNext = m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash];
-	m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash] = pBan;
+	// add it to the trie
+	CNetPrefix Prefix(&pBan->m_Data);
+	CBanNode<T> *pNode = InsertNode(&Prefix);
+	if(pNode->m_pFirstBan)
+		pNode->m_pFirstBan->m_pNodePrev = pBan;
+	pBan->m_pNode = pNode;
+	pBan->m_pNodePrev = 0;
+	pBan->m_pNodeNext = pNode->m_pFirstBan;
+	pNode->m_pFirstBan = pBan;
 
 	// insert it into the used list
-	if(m_pFirstUsed)
-	{
-		for(CBan<T> *p = m_pFirstUsed; ; p = p->m_pNext)
-		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
-
-			if(!p->m_pNext)
-			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
-			}
-		}
-	}
-	else
-	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
-	}
+	InsertUsed(pBan);
 
 	// update ban count
 	++m_CountUsed;
+	++m_Generation;
 
 	return pBan;
 }
 
-template<class T, int HashCount>
-int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
+template<class T, int MaxBans>
+int CNetBan::CBanPool<T, MaxBans>::Remove(CBan<T> *pBan)
 {
 	if(pBan == 0)
 		return -1;
 
-	// remove from hash list
-	if(pBan->m_pHashNext)
-		pBan->m_pHashNext->m_pHashPrev = pBan->m_pHashPrev;
-	if(pBan->m_pHashPrev)
-		pBan->m_pHashPrev->m_pHashNext = pBan->m_pHashNext;
+	// remove from the trie
+	if(pBan->m_pNodeNext)
+		pBan->m_pNodeNext->m_pNodePrev = pBan->m_pNodePrev;
+	if(pBan->m_pNodePrev)
+		pBan->m_pNodePrev->m_pNodeNext = pBan->m_pNodeNext;
 	else
-		m_paaHashList[pBan->m_NetHash.m_HashIndex][pBan->m_NetHash.m_Hash] = pBan->m_pHashNext;
-	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
+		pBan->m_pNode->m_pFirstBan = pBan->m_pNodeNext;
+	CollapseNode(pBan->m_pNode);
+	pBan->m_pNode = 0;
+	pBan->m_pNodeNext = pBan->m_pNodePrev = 0;
 
 	// remove from used list
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
+	else
+		m_pLastUsed = pBan->m_pPrev;
 	if(pBan->m_pPrev)
 		pBan->m_pPrev->m_pNext = pBan->m_pNext;
 	else
@@ -157,61 +277,39 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	return 0;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
+template<class T, int MaxBans>
+void CNetBan::CBanPool<T, MaxBans>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
 {
 	pBan->m_Info = *pInfo;
 
 	// remove from used list
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
+	else
+		m_pLastUsed = pBan->m_pPrev;
 	if(pBan->m_pPrev)
 		pBan->m_pPrev->m_pNext = pBan->m_pNext;
 	else
 		m_pFirstUsed = pBan->m_pNext;
 
 	// insert it into the used list
-	if(m_pFirstUsed)
-	{
-		for(CBan<T> *p = m_pFirstUsed; ; p = p->m_pNext)
-		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
-
-			if(!p->m_pNext)
-			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
-			}
-		}
-	}
-	else
-	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
-	}
+	InsertUsed(pBan);
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Reset()
+template<class T, int MaxBans>
+void CNetBan::CBanPool<T, MaxBans>::Reset()
 {
-	mem_zero(m_paaHashList, sizeof(m_paaHashList));
+	mem_zero(m_apRoot, sizeof(m_apRoot));
+	mem_zero(m_aNodes, sizeof(m_aNodes));
 	mem_zero(m_aBans, sizeof(m_aBans));
 	m_pFirstUsed = 0;
+	m_pLastUsed = 0;
 	m_CountUsed = 0;
+	++m_Generation;
+
+	for(int i = 0; i < MAX_NODES-1; ++i)
+		m_aNodes[i].m_pParent = &m_aNodes[i+1];
+	m_pFirstFreeNode = &m_aNodes[0];
 
 	for(int i = 1; i < MAX_BANS-1; ++i)
 	{
@@ -224,8 +322,58 @@ void CNetBan::CBanPool<T, HashCount>::Reset()
 	m_pFirstFree = &m_aBans[0];
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
+template<class T, int MaxBans>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, MaxBans>::Find(const T *pData) const
+{
+	CNetPrefix Prefix(pData);
+	CBanNode<T> *pNode = FindNode(&Prefix);
+	if(!pNode)
+		return 0;
+
+	for(CBan<T> *pBan = pNode->m_pFirstBan; pBan; pBan = pBan->m_pNodeNext)
+	{
+		if(NetComp(&pBan->m_Data, pData) == 0)
+			return pBan;
+	}
+
+	return 0;
+}
+
+template<class T, int MaxBans>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, MaxBans>::Match(const NETADDR *pAddr) const
+{
+	const int MaxLength = CNetPrefix::MaxLength(pAddr);
+	CBan<T> *pMatch = 0;
+	int Checked = 0;
+
+	// walk down the path of the address, deeper nodes hold more specific bans
+	for(CBanNode<T> *pNode = m_apRoot[CNetPrefix::Family(pAddr)]; pNode; pNode = pNode->m_apChild[GetBit(pAddr->ip, pNode->m_Length)])
+	{
+		// compare the bits of the edge leading to this node
+		for(; Checked < pNode->m_Length; ++Checked)
+		{
+			if(GetBit(pNode->m_aPrefix, Checked) != GetBit(pAddr->ip, Checked))
+				return pMatch;
+		}
+
+		for(CBan<T> *pBan = pNode->m_pFirstBan; pBan; pBan = pBan->m_pNodeNext)
+		{
+			if(NetMatch(&pBan->m_Data, pAddr))
+			{
+				pMatch = pBan;
+				break;
+			}
+		}
+
+		if(pNode->m_Length == MaxLength)
+			break;
+	}
+
+	return pMatch;
+}
+
+template<class T, int MaxBans>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, MaxBans>::Get(int Index) const
 {
 	if(Index < 0 || Index >= Num())
 		return 0;
@@ -309,13 +457,16 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	Info.m_LastInfoQuery = Time;
 	str_copy(Info.m_aReason, pReason, sizeof(Info.m_aReason));
 
+	if(m_SharedBans.IsAttached())
+		return BanShared(pData, &Info);
+
 	// check if it already exists
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		// adjust the ban
 		pBanPool->Update(pBan, &Info);
+		JournalBan(pBan);
 		char aBuf[128];
 		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
@@ -323,9 +474,10 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	}
 
 	// add ban and print result
-	pBan = pBanPool->Add(pData, &Info, &NetHash);
+	pBan = pBanPool->Add(pData, &Info);
 	if(pBan)
 	{
+		JournalBan(pBan);
 		char aBuf[128];
 		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
@@ -339,12 +491,15 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 template<class T>
 int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 {
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	if(m_SharedBans.IsAttached())
+		return UnbanShared(pData);
+
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		char aBuf[256];
 		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANREM);
+		JournalUnban(pData);
 		pBanPool->Remove(pBan);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 		return 0;
@@ -354,12 +509,170 @@ int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 	return -1;
 }
 
+template<class T>
+int CNetBan::BanShared(const T *pData, const CBanInfo *pInfo)
+{
+	int Result = m_SharedBans.Ban(pData, pInfo->m_Expires, pInfo->m_aReason);
+	if(Result < 0)
+	{
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
+		return -1;
+	}
+
+	CBan<T> Ban;
+	Ban.m_Data = *pData;
+	Ban.m_Info = *pInfo;
+	JournalBan(&Ban);
+	char aBuf[128];
+	MakeBanInfo(&Ban, aBuf, sizeof(aBuf), Result == 0 ? MSGTYPE_BANADD : MSGTYPE_LIST);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	return Result;
+}
+
+template<class T>
+int CNetBan::UnbanShared(const T *pData)
+{
+	CNetBanShared::CEntry Entry;
+	if(!m_SharedBans.Find(pData, &Entry))
+	{
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "unban failed (invalid entry)");
+		return -1;
+	}
+
+	CBan<T> Ban;
+	Ban.m_Data = *pData;
+	SharedBanInfo(&Entry, &Ban.m_Info);
+	char aBuf[256];
+	MakeBanInfo(&Ban, aBuf, sizeof(aBuf), MSGTYPE_BANREM);
+	JournalUnban(pData);
+	m_SharedBans.Unban(pData);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	return 0;
+}
+
+void CNetBan::SharedBanInfo(const CNetBanShared::CEntry *pEntry, CBanInfo *pInfo)
+{
+	pInfo->m_Expires = pEntry->m_Expires;
+	pInfo->m_LastInfoQuery = pEntry->m_LastInfoQuery;
+	str_copy(pInfo->m_aReason, pEntry->m_aReason, sizeof(pInfo->m_aReason));
+}
+
+void CNetBan::AttachShared(const char *pName)
+{
+	char aBuf[256];
+	str_copy(m_aSharedBansName, pName, sizeof(m_aSharedBansName));
+
+	// take the shared bans back into the local banlist
+	if(m_SharedBans.IsAttached())
+	{
+		int Lost = 0;
+		CNetBanShared::CEntry Entry;
+		CBanInfo Info;
+		for(int i = 0; m_SharedBans.Get(i, &Entry); ++i)
+		{
+			SharedBanInfo(&Entry, &Info);
+			if(Entry.IsRange())
+			{
+				CNetRange Range;
+				Range.m_LB = Entry.m_LB;
+				Range.m_UB = Entry.m_UB;
+				Lost += !m_BanRangePool.Find(&Range) && !m_BanRangePool.Add(&Range, &Info);
+			}
+			else
+				Lost += !m_BanAddrPool.Find(&Entry.m_LB) && !m_BanAddrPool.Add(&Entry.m_LB, &Info);
+		}
+		m_SharedBans.Detach();
+
+		if(Lost)
+		{
+			str_format(aBuf, sizeof(aBuf), "detached from shared banlist, %d bans didn't fit into the local banlist", Lost);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		}
+	}
+
+	if(!pName[0])
+		return;
+
+	if(!m_SharedBans.Attach(pName))
+	{
+		str_format(aBuf, sizeof(aBuf), "failed to attach to shared banlist '%s'", pName);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		return;
+	}
+
+	// hand the local bans over, the shared table is the only banlist from now on.
+	// either all of them move or the local banlist stays in use
+	int NumLocal = m_BanAddrPool.Num()+m_BanRangePool.Num();
+	CNetBanShared::CEntry *pEntries = (CNetBanShared::CEntry *)mem_alloc(max(NumLocal, 1)*sizeof(CNetBanShared::CEntry), 1);
+	int Num = 0;
+	for(CBanAddr *pBan = m_BanAddrPool.First(); pBan; pBan = pBan->m_pNext, ++Num)
+	{
+		mem_zero(&pEntries[Num], sizeof(pEntries[Num]));
+		pEntries[Num].m_LB = pBan->m_Data;
+		pEntries[Num].m_UB.type = NETTYPE_INVALID;
+		pEntries[Num].m_Expires = pBan->m_Info.m_Expires;
+		str_copy(pEntries[Num].m_aReason, pBan->m_Info.m_aReason, sizeof(pEntries[Num].m_aReason));
+	}
+	for(CBanRange *pBan = m_BanRangePool.First(); pBan; pBan = pBan->m_pNext, ++Num)
+	{
+		mem_zero(&pEntries[Num], sizeof(pEntries[Num]));
+		pEntries[Num].m_LB = pBan->m_Data.m_LB;
+		pEntries[Num].m_UB = pBan->m_Data.m_UB;
+		pEntries[Num].m_Expires = pBan->m_Info.m_Expires;
+		str_copy(pEntries[Num].m_aReason, pBan->m_Info.m_aReason, sizeof(pEntries[Num].m_aReason));
+	}
+	int Added = m_SharedBans.Merge(pEntries, Num);
+	mem_free(pEntries);
+
+	if(Added < 0)
+	{
+		m_SharedBans.Detach();
+		str_format(aBuf, sizeof(aBuf), "failed to attach to shared banlist '%s' (%d local bans don't fit), keeping the local banlist", pName, NumLocal);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		return;
+	}
+	m_BanAddrPool.Reset();
+	m_BanRangePool.Reset();
+
+	str_format(aBuf, sizeof(aBuf), "attached to shared banlist '%s' (%d bans, %d added)", pName, m_SharedBans.Num(), Added);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
+
+template<class T>
+void CNetBan::MakePlayerBanInfo(T *pBanPool, const typename T::CDataType *pData, char *pBuf, unsigned BufferSize)
+{
+	CNetBanShared::CEntry Entry;
+	if(m_SharedBans.IsAttached() && m_SharedBans.Find(pData, &Entry))
+	{
+		CBan<typename T::CDataType> Ban;
+		Ban.m_Data = *pData;
+		SharedBanInfo(&Entry, &Ban.m_Info);
+		MakeBanInfo(&Ban, pBuf, BufferSize, MSGTYPE_PLAYER);
+	}
+	else
+		MakeBanInfo(pBanPool->Find(pData), pBuf, BufferSize, MSGTYPE_PLAYER);
+}
+
+CNetBan::CNetBan()
+{
+	m_JournalFile = 0;
+}
+
+CNetBan::~CNetBan()
+{
+	if(m_JournalFile)
+		io_close(m_JournalFile);
+}
+
 void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 {
 	m_pConsole = pConsole;
 	m_pStorage = pStorage;
 	m_BanAddrPool.Reset();
 	m_BanRangePool.Reset();
+	mem_zero(m_aNegativeCache, sizeof(m_aNegativeCache));
+	m_aSharedBansName[0] = 0;
+	m_SharedExpireTime = 0;
 
 	net_host_lookup("localhost", &m_LocalhostIPV4, NETTYPE_IPV4);
 	net_host_lookup("localhost", &m_LocalhostIPV6, NETTYPE_IPV6);
@@ -369,6 +682,11 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 	Console()->Register("unban_all", "", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConUnbanAll, this, "Unban all entries");
 	Console()->Register("bans", "", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBans, this, "Show banlist");
 	Console()->Register("bans_save", "s", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBansSave, this, "Save banlist in a file");
+	Console()->Register("bans_save_binary", "s", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBansSaveBinary, this, "Save banlist in a binary file");
+	Console()->Register("bans_load", "s", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBansLoad, this, "Load banlist from a binary file");
+
+	Console()->Chain("ban_journal", ConchainJournalUpdate, this);
+	Console()->Chain("ban_shared_memory", ConchainSharedMemoryUpdate, this);
 }
 
 void CNetBan::Update()
@@ -389,6 +707,28 @@ void CNetBan::Update()
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 		m_BanRangePool.Remove(m_BanRangePool.First());
 	}
+
+	// whichever server gets here first removes expired shared bans
+	if(m_SharedBans.IsAttached() && m_SharedExpireTime != Now)
+	{
+		m_SharedExpireTime = Now;
+		CNetBanShared::CEntry aExpired[16];
+		int Num = m_SharedBans.Expire(Now, aExpired, sizeof(aExpired)/sizeof(aExpired[0]));
+		for(int i = 0; i < Num; ++i)
+		{
+			if(aExpired[i].IsRange())
+			{
+				CNetRange Range;
+				Range.m_LB = aExpired[i].m_LB;
+				Range.m_UB = aExpired[i].m_UB;
+				NetToString(&Range, aNetStr, sizeof(aNetStr));
+			}
+			else
+				NetToString(&aExpired[i].m_LB, aNetStr, sizeof(aNetStr));
+			str_format(aBuf, sizeof(aBuf), "ban %s expired", aNetStr);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		}
+	}
 }
 
 int CNetBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
@@ -423,10 +763,36 @@ int CNetBan::UnbanByIndex(int Index)
 {
 	int Result;
 	char aBuf[256];
+	CNetBanShared::CEntry Entry;
+	if(m_SharedBans.IsAttached() && m_SharedBans.Get(Index, &Entry))
+	{
+		if(Entry.IsRange())
+		{
+			CNetRange Range;
+			Range.m_LB = Entry.m_LB;
+			Range.m_UB = Entry.m_UB;
+			NetToString(&Range, aBuf, sizeof(aBuf));
+			JournalUnban(&Range);
+			Result = m_SharedBans.Unban(&Range);
+		}
+		else
+		{
+			NetToString(&Entry.m_LB, aBuf, sizeof(aBuf));
+			JournalUnban(&Entry.m_LB);
+			Result = m_SharedBans.Unban(&Entry.m_LB);
+		}
+
+		char aMsg[256];
+		str_format(aMsg, sizeof(aMsg), "unbanned index %i (%s)", Index, aBuf);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
+		return Result;
+	}
+
 	CBanAddr *pBan = m_BanAddrPool.Get(Index);
 	if(pBan)
 	{
 		NetToString(&pBan->m_Data, aBuf, sizeof(aBuf));
+		JournalUnban(&pBan->m_Data);
 		Result = m_BanAddrPool.Remove(pBan);
 	}
 	else
@@ -435,6 +801,7 @@ int CNetBan::UnbanByIndex(int Index)
 		if(pBan)
 		{
 			NetToString(&pBan->m_Data, aBuf, sizeof(aBuf));
+			JournalUnban(&pBan->m_Data);
 			Result = m_BanRangePool.Remove(pBan);
 		}
 		else
@@ -452,8 +819,13 @@ int CNetBan::UnbanByIndex(int Index)
 
 void CNetBan::UnbanAll()
 {
+	const unsigned char Record = BANLIST_RECORD_UNBANALL;
+	JournalWrite(&Record, sizeof(Record));
+
 	m_BanAddrPool.Reset();
 	m_BanRangePool.Reset();
+	if(m_SharedBans.IsAttached())
+		m_SharedBans.Reset();
 }
 
 template<class T>
@@ -469,11 +841,17 @@ bool CNetBan::IsBannable(const T *pData)
 
 bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, int *pLastInfoQuery)
 {
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
+	// bans only get lifted since the last negative lookup, if the generation didn't change
+	unsigned Hash = 0;
+	for(int i = 0; i < (pAddr->type==NETTYPE_IPV4 ? 4 : 16); ++i)
+		Hash = Hash*31 + pAddr->ip[i];
+	CNegativeCacheEntry *pCacheEntry = &m_aNegativeCache[Hash%NEGATIVE_CACHE_SIZE];
+	const unsigned Generation = BanGeneration();
+	if(pCacheEntry->m_Generation == Generation && NetComp(&pCacheEntry->m_Addr, pAddr) == 0)
+		return false;
 
 	// check ban adresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
+	CBanAddr *pBan = m_BanAddrPool.Match(pAddr);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
@@ -481,21 +859,289 @@ bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, in
 	}
 
 	// check ban ranges
-	for(int i = Length-1; i >= 0; --i)
+	CBanRange *pBanRange = m_BanRangePool.Match(pAddr);
+	if(pBanRange)
 	{
-		for(CBanRange *pBan = m_BanRangePool.First(&aHash[i]); pBan; pBan = pBan->m_pHashNext)
+		MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
+		return true;
+	}
+
+	// check the bans shared with the other servers on this host
+	if(m_SharedBans.IsAttached())
+	{
+		CNetBanShared::CEntry Entry;
+		int Slot = m_SharedBans.Match(pAddr, time_timestamp(), &Entry);
+		if(Slot >= 0)
 		{
-			if(NetMatch(&pBan->m_Data, pAddr, i, Length))
-			{
-				MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
-				return true;
-			}
+			CBanAddr Ban;
+			Ban.m_Data = Entry.m_LB;
+			SharedBanInfo(&Entry, &Ban.m_Info);
+			MakeBanInfo(&Ban, pBuf, BufferSize, MSGTYPE_PLAYER, pLastInfoQuery);
+			if(pLastInfoQuery)
+				m_SharedBans.SetLastInfoQuery(Slot, Ban.m_Info.m_LastInfoQuery);
+			return true;
 		}
 	}
-	
+
+	pCacheEntry->m_Addr = *pAddr;
+	pCacheEntry->m_Generation = Generation;
 	return false;
 }
 
+template<class T>
+int CNetBan::PackBanRecord(unsigned char *pBuf, int Record, const T *pData, const CBanInfo *pInfo)
+{
+	unsigned char *pStart = pBuf;
+	*pBuf++ = Record|RecordNetFlag(pData);
+	if(Record == BANLIST_RECORD_BAN)
+	{
+		*pBuf++ = (pInfo->m_Expires>>24)&0xff;
+		*pBuf++ = (pInfo->m_Expires>>16)&0xff;
+		*pBuf++ = (pInfo->m_Expires>>8)&0xff;
+		*pBuf++ = pInfo->m_Expires&0xff;
+	}
+	pBuf = PackNet(pBuf, pData);
+	if(Record == BANLIST_RECORD_BAN)
+	{
+		int Length = str_length(pInfo->m_aReason);
+		*pBuf++ = Length;
+		mem_copy(pBuf, pInfo->m_aReason, Length);
+		pBuf += Length;
+	}
+	return (int)(pBuf-pStart);
+}
+
+template<class T>
+int CNetBan::BulkBan(T *pBanPool, const typename T::CDataType *pData, const CBanInfo *pInfo)
+{
+	if(!IsBannable(pData))
+		return -1;
+	if(m_SharedBans.IsAttached())
+		return m_SharedBans.Ban(pData, pInfo->m_Expires, pInfo->m_aReason);
+
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
+	if(pBan)
+	{
+		pBanPool->Update(pBan, pInfo);
+		return 1;
+	}
+	return pBanPool->Add(pData, pInfo) ? 0 : -1;
+}
+
+template<class T>
+int CNetBan::BulkUnban(T *pBanPool, const typename T::CDataType *pData)
+{
+	if(m_SharedBans.IsAttached())
+		return m_SharedBans.Unban(pData);
+	return pBanPool->Remove(pBanPool->Find(pData));
+}
+
+void CNetBan::OpenJournal()
+{
+	if(m_JournalFile)
+	{
+		io_close(m_JournalFile);
+		m_JournalFile = 0;
+	}
+	if(!g_Config.m_BanJournal[0])
+		return;
+
+	m_JournalFile = Storage()->OpenFile(g_Config.m_BanJournal, IOFLAG_APPEND, IStorage::TYPE_SAVE);
+	if(!m_JournalFile)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "failed to open ban journal '%s'", g_Config.m_BanJournal);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		return;
+	}
+
+	// new file, start with the header
+	if(io_length(m_JournalFile) == 0)
+	{
+		unsigned char aHeader[BANLIST_HEADER_SIZE] = {0};
+		mem_copy(aHeader, s_aBanlistMagic, sizeof(s_aBanlistMagic));
+		aHeader[4] = BANLIST_VERSION;
+		io_write(m_JournalFile, aHeader, sizeof(aHeader));
+		io_flush(m_JournalFile);
+	}
+}
+
+void CNetBan::JournalWrite(const unsigned char *pRecord, int Size)
+{
+	if(!m_JournalFile)
+		return;
+
+	// flushed right away so the journal survives a crash
+	io_write(m_JournalFile, pRecord, Size);
+	io_flush(m_JournalFile);
+}
+
+template<class T>
+void CNetBan::JournalBan(const CBan<T> *pBan)
+{
+	unsigned char aRecord[BANLIST_MAX_RECORD_SIZE];
+	JournalWrite(aRecord, PackBanRecord(aRecord, BANLIST_RECORD_BAN, &pBan->m_Data, &pBan->m_Info));
+}
+
+template<class T>
+void CNetBan::JournalUnban(const T *pData)
+{
+	unsigned char aRecord[BANLIST_MAX_RECORD_SIZE];
+	JournalWrite(aRecord, PackBanRecord(aRecord, BANLIST_RECORD_UNBAN, pData, (const CBanInfo *)0));
+}
+
+int CNetBan::SaveBinary(const char *pFilename)
+{
+	// the journal itself can get compacted
+	const bool Journal = m_JournalFile && str_comp(pFilename, g_Config.m_BanJournal) == 0;
+	if(Journal)
+	{
+		io_close(m_JournalFile);
+		m_JournalFile = 0;
+	}
+
+	IOHANDLE File = Storage()->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		if(Journal)
+			OpenJournal();
+		return -1;
+	}
+
+	unsigned char aHeader[BANLIST_HEADER_SIZE] = {0};
+	mem_copy(aHeader, s_aBanlistMagic, sizeof(s_aBanlistMagic));
+	aHeader[4] = BANLIST_VERSION;
+	io_write(File, aHeader, sizeof(aHeader));
+
+	// records are written sorted by expiry which keeps loading them linear
+	int Count = 0;
+	unsigned char aRecord[BANLIST_MAX_RECORD_SIZE];
+	for(CBanAddr *pBan = m_BanAddrPool.First(); pBan; pBan = pBan->m_pNext, ++Count)
+		io_write(File, aRecord, PackBanRecord(aRecord, BANLIST_RECORD_BAN, &pBan->m_Data, &pBan->m_Info));
+	for(CBanRange *pBan = m_BanRangePool.First(); pBan; pBan = pBan->m_pNext, ++Count)
+		io_write(File, aRecord, PackBanRecord(aRecord, BANLIST_RECORD_BAN, &pBan->m_Data, &pBan->m_Info));
+
+	CNetBanShared::CEntry Entry;
+	CBanInfo Info;
+	for(int i = 0; m_SharedBans.IsAttached() && m_SharedBans.Get(i, &Entry); ++i, ++Count)
+	{
+		SharedBanInfo(&Entry, &Info);
+		if(Entry.IsRange())
+		{
+			CNetRange Range;
+			Range.m_LB = Entry.m_LB;
+			Range.m_UB = Entry.m_UB;
+			io_write(File, aRecord, PackBanRecord(aRecord, BANLIST_RECORD_BAN, &Range, &Info));
+		}
+		else
+			io_write(File, aRecord, PackBanRecord(aRecord, BANLIST_RECORD_BAN, &Entry.m_LB, &Info));
+	}
+
+	io_close(File);
+
+	// the compacted journal takes the changes from now on, other files leave it alone
+	if(Journal)
+		OpenJournal();
+	return Count;
+}
+
+int CNetBan::LoadBinary(const char *pFilename)
+{
+	IOHANDLE File = Storage()->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+		return -1;
+
+	int Size = (int)io_length(File);
+	unsigned char *pData = (unsigned char *)mem_alloc(max(Size, 1), 1);
+	Size = io_read(File, pData, Size);
+	io_close(File);
+
+	if(Size < BANLIST_HEADER_SIZE || mem_comp(pData, s_aBanlistMagic, sizeof(s_aBanlistMagic)) != 0 || pData[4] != BANLIST_VERSION)
+	{
+		mem_free(pData);
+		return -1;
+	}
+
+	// apply all records silently, one summary is printed by the caller
+	int Now = time_timestamp();
+	int Count = 0;
+	const unsigned char *pEnd = pData+Size;
+	const unsigned char *p = pData+BANLIST_HEADER_SIZE;
+	while(p && p < pEnd)
+	{
+		int Record = *p++;
+		bool Range = Record&BANLIST_RECORD_RANGE;
+		Record &= ~BANLIST_RECORD_RANGE;
+
+		if(Record == BANLIST_RECORD_UNBANALL)
+		{
+			m_BanAddrPool.Reset();
+			m_BanRangePool.Reset();
+			if(m_SharedBans.IsAttached())
+				m_SharedBans.Reset();
+			continue;
+		}
+
+		CBanInfo Info = {0};
+		if(Record == BANLIST_RECORD_BAN)
+		{
+			if(pEnd-p < 4)
+				break;
+			Info.m_Expires = (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3];
+			Info.m_LastInfoQuery = Now;
+			p += 4;
+		}
+		else if(Record != BANLIST_RECORD_UNBAN)
+			break;
+
+		NETADDR Addr;
+		CNetRange NetRange;
+		p = Range ? UnpackNet(p, pEnd, &NetRange) : UnpackNet(p, pEnd, &Addr);
+		if(!p)
+			break;
+
+		if(Record == BANLIST_RECORD_UNBAN)
+		{
+			if(Range)
+				BulkUnban(&m_BanRangePool, &NetRange);
+			else
+				BulkUnban(&m_BanAddrPool, &Addr);
+			continue;
+		}
+
+		if(p >= pEnd || pEnd-p < 1+p[0])
+			break;
+		mem_copy(Info.m_aReason, p+1, min((int)p[0], (int)sizeof(Info.m_aReason)-1));
+		p += 1+p[0];
+
+		if(Info.m_Expires != CBanInfo::EXPIRES_NEVER && Info.m_Expires <= Now)
+			continue;
+		if(Range && !NetRange.IsValid())
+			continue;
+
+		if((Range ? BulkBan(&m_BanRangePool, &NetRange, &Info) : BulkBan(&m_BanAddrPool, &Addr, &Info)) == 0)
+			++Count;
+	}
+
+	mem_free(pData);
+	return Count;
+}
+
+void CNetBan::ConchainJournalUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+		static_cast<CNetBan *>(pUserData)->OpenJournal();
+}
+
+void CNetBan::ConchainSharedMemoryUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	CNetBan *pThis = static_cast<CNetBan *>(pUserData);
+	if(pResult->NumArguments() && str_comp(pThis->m_aSharedBansName, g_Config.m_BanSharedMemory) != 0)
+		pThis->AttachShared(g_Config.m_BanSharedMemory);
+}
+
 void CNetBan::ConBan(IConsole::IResult *pResult, void *pUser)
 {
 	CNetBan *pThis = static_cast<CNetBan *>(pUser);
@@ -585,6 +1231,27 @@ void CNetBan::ConBans(IConsole::IResult *pResult, void *pUser)
 		str_format(aMsg, sizeof(aMsg), "#%i %s", Count++, aBuf);
 		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
 	}
+	CNetBanShared::CEntry Entry;
+	for(int i = 0; pThis->m_SharedBans.IsAttached() && pThis->m_SharedBans.Get(i, &Entry); ++i)
+	{
+		if(Entry.IsRange())
+		{
+			CBanRange Ban;
+			Ban.m_Data.m_LB = Entry.m_LB;
+			Ban.m_Data.m_UB = Entry.m_UB;
+			SharedBanInfo(&Entry, &Ban.m_Info);
+			pThis->MakeBanInfo(&Ban, aBuf, sizeof(aBuf), MSGTYPE_LIST);
+		}
+		else
+		{
+			CBanAddr Ban;
+			Ban.m_Data = Entry.m_LB;
+			SharedBanInfo(&Entry, &Ban.m_Info);
+			pThis->MakeBanInfo(&Ban, aBuf, sizeof(aBuf), MSGTYPE_LIST);
+		}
+		str_format(aMsg, sizeof(aMsg), "#%i %s", Count++, aBuf);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
+	}
 	str_format(aMsg, sizeof(aMsg), "%d %s", Count, Count==1?"ban":"bans");
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
 }
@@ -622,16 +1289,63 @@ void CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 		io_write(File, aBuf, str_length(aBuf));
 		io_write_newline(File);
 	}
+	CNetBanShared::CEntry Entry;
+	for(int i = 0; pThis->m_SharedBans.IsAttached() && pThis->m_SharedBans.Get(i, &Entry); ++i)
+	{
+		int Min = Entry.m_Expires>-1 ? (Entry.m_Expires-Now+59)/60 : -1;
+		net_addr_str(&Entry.m_LB, aAddrStr1, sizeof(aAddrStr1), false);
+		if(Entry.IsRange())
+		{
+			net_addr_str(&Entry.m_UB, aAddrStr2, sizeof(aAddrStr2), false);
+			str_format(aBuf, sizeof(aBuf), "ban_range %s %s %i %s", aAddrStr1, aAddrStr2, Min, Entry.m_aReason);
+		}
+		else
+			str_format(aBuf, sizeof(aBuf), "ban %s %i %s", aAddrStr1, Min, Entry.m_aReason);
+		io_write(File, aBuf, str_length(aBuf));
+		io_write_newline(File);
+	}
 
 	io_close(File);
 	str_format(aBuf, sizeof(aBuf), "saved banlist to '%s'", pFilename);
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 }
 
+void CNetBan::ConBansSaveBinary(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+	char aBuf[256];
+	const char *pFilename = pResult->GetString(0);
+
+	int Count = pThis->SaveBinary(pFilename);
+	if(Count < 0)
+		str_format(aBuf, sizeof(aBuf), "failed to save banlist to '%s'", pFilename);
+	else
+		str_format(aBuf, sizeof(aBuf), "saved %d %s to '%s'", Count, Count==1?"ban":"bans", pFilename);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
+
+void CNetBan::ConBansLoad(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+	char aBuf[256];
+	const char *pFilename = pResult->GetString(0);
+
+	int Count = pThis->LoadBinary(pFilename);
+	if(Count < 0)
+		str_format(aBuf, sizeof(aBuf), "failed to load banlist from '%s'", pFilename);
+	else
+		str_format(aBuf, sizeof(aBuf), "loaded %d %s from '%s'", Count, Count==1?"ban":"bans", pFilename);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
+
 // explicitly instantiate template for src/engine/server/server.cpp
 template void CNetBan::MakeBanInfo<CNetRange>(CBan<CNetRange> *pBan, char *pBuf, unsigned BufferSize, int Type, int *pLastInfoQuery);
 template void CNetBan::MakeBanInfo<NETADDR>(CBan<NETADDR> *pBan, char *pBuf, unsigned BufferSize, int Type, int *pLastInfoQuery);
-template int CNetBan::Ban<CNetBan::CBanPool<NETADDR, 1> >(CNetBan::CBanPool<NETADDR, 1> *pBanPool, const NETADDR *pData, int Seconds, const char *pReason);
-template int CNetBan::Ban<CNetBan::CBanPool<CNetRange, 16> >(CNetBan::CBanPool<CNetRange, 16> *pBanPool, const CNetRange *pData, int Seconds, const char *pReason);
+template int CNetBan::Ban<CNetBan::CBanAddrPool>(CNetBan::CBanAddrPool *pBanPool, const NETADDR *pData, int Seconds, const char *pReason);
+template int CNetBan::Ban<CNetBan::CBanRangePool>(CNetBan::CBanRangePool *pBanPool, const CNetRange *pData, int Seconds, const char *pReason);
 template bool CNetBan::IsBannable<NETADDR>(const NETADDR *pData);
+template void CNetBan::MakePlayerBanInfo<CNetBan::CBanAddrPool>(CNetBan::CBanAddrPool *pBanPool, const NETADDR *pData, char *pBuf, unsigned BufferSize);
+template void CNetBan::MakePlayerBanInfo<CNetBan::CBanRangePool>(CNetBan::CBanRangePool *pBanPool, const CNetRange *pData, char *pBuf, unsigned BufferSize);
 template bool CNetBan::IsBannable<CNetRange>(const CNetRange *pData);
+template class CNetBan::CBanPool<NETADDR, 4096>;
+template class CNetBan::CBanPool<CNetRange, 4096>;
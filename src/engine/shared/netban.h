@@ -3,6 +3,8 @@
 
 #include <base/system.h>
 
+#include "netban_shared.h"
+
 
 inline int NetComp(const NETADDR *pAddr1, const NETADDR *pAddr2)
 {
@@ -27,18 +29,18 @@ inline int NetComp(const CNetRange *pRange1, const CNetRange *pRange2)
 class CNetBan
 {
 protected:
-	bool NetMatch(const NETADDR *pAddr1, const NETADDR *pAddr2) const
+	static bool NetMatch(const NETADDR *pAddr1, const NETADDR *pAddr2)
 	{
 		return NetComp(pAddr1, pAddr2) == 0;
 	}
 
-	bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr, int Start, int Length) const
+	static bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr, int Start, int Length)
 	{
 		return pRange->m_LB.type == pAddr->type && (Start == 0 || mem_comp(&pRange->m_LB.ip[0], &pAddr->ip[0], Start) == 0) &&
 			mem_comp(&pRange->m_LB.ip[Start], &pAddr->ip[Start], Length-Start) <= 0 && mem_comp(&pRange->m_UB.ip[Start], &pAddr->ip[Start], Length-Start) >= 0;
 	}
 
-	bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr) const
+	static bool NetMatch(const CNetRange *pRange, const NETADDR *pAddr)
 	{
 		return NetMatch(pRange, pAddr, 0,  pRange->m_LB.type==NETTYPE_IPV4 ? 4 : 16);
 	}
@@ -63,17 +65,20 @@ protected:
 	// todo: move?
 	static bool StrAllnum(const char *pStr);
 
-	class CNetHash
+	// leading bits of an address (all of them) or a range (the ones both bounds share),
+	// this is the key under which a ban is stored in the trie
+	class CNetPrefix
 	{
 	public:
-		int m_Hash;
-		int m_HashIndex;	// matching parts for ranges, 0 for addr
+		int m_Family;	// 0 for ipv4, 1 for ipv6
+		int m_Length;	// in bits
+		const unsigned char *m_pIp;
 
-		CNetHash() {}	
-		CNetHash(const NETADDR *pAddr);
-		CNetHash(const CNetRange *pRange);
+		CNetPrefix(const NETADDR *pAddr);
+		CNetPrefix(const CNetRange *pRange);
 
-		static int MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17]);
+		static int Family(const NETADDR *pAddr) { return pAddr->type==NETTYPE_IPV4 ? 0 : 1; }
+		static int MaxLength(const NETADDR *pAddr) { return pAddr->type==NETTYPE_IPV4 ? 32 : 128; }
 	};
 
 	struct CBanInfo
@@ -88,27 +93,42 @@ protected:
 		char m_aReason[REASON_LENGTH];		
 	};
 
+	template<class T> struct CBanNode;
+
 	template<class T> struct CBan
 	{
 		T m_Data;
 		CBanInfo m_Info;
-		CNetHash m_NetHash;
+		CBanNode<T> *m_pNode;
 
-		// hash list
-		CBan *m_pHashNext;
-		CBan *m_pHashPrev;
+		// bans sharing the same trie node
+		CBan *m_pNodeNext;
+		CBan *m_pNodePrev;
 
 		// used or free list
 		CBan *m_pNext;
 		CBan *m_pPrev;
 	};
 
-	template<class T, int HashCount> class CBanPool
+	// node of a path compressed binary trie, it only exists if bans are
+	// attached to it or if it branches into two subtrees
+	template<class T> struct CBanNode
+	{
+		unsigned char m_aPrefix[16];
+		int m_Length;
+		CBanNode *m_pParent;	// next free node if unused
+		CBanNode *m_apChild[2];
+		CBan<T> *m_pFirstBan;
+	};
+
+	template<class T, int MaxBans> class CBanPool
 	{
 	public:
 		typedef T CDataType;
 
-		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo, const CNetHash *pNetHash);
+		CBanPool() : m_Generation(1) {}
+
+		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo);
 		int Remove(CBan<CDataType> *pBan);
 		void Update(CBan<CDataType> *pBan, const CBanInfo *pInfo);
 		void Reset();
@@ -116,35 +136,41 @@ protected:
 		int Num() const { return m_CountUsed; }
 		bool IsFull() const { return m_CountUsed == MAX_BANS; }
 
+		// changes whenever a ban gets added, so negative lookups can be cached
+		unsigned Generation() const { return m_Generation; }
+
 		CBan<CDataType> *First() const { return m_pFirstUsed; }
-		CBan<CDataType> *First(const CNetHash *pNetHash) const { return m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; }
-		CBan<CDataType> *Find(const CDataType *pData, const CNetHash *pNetHash) const
-		{
-			for(CBan<CDataType> *pBan = m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; pBan; pBan = pBan->m_pHashNext)
-			{
-				if(NetComp(&pBan->m_Data, pData) == 0)
-					return pBan;
-			}
-
-			return 0;
-		}
+		CBan<CDataType> *Find(const CDataType *pData) const;
+		// most specific ban matching the address, O(address bits)
+		CBan<CDataType> *Match(const NETADDR *pAddr) const;
 		CBan<CDataType> *Get(int Index) const;
 
 	private:
 		enum
 		{
-			MAX_BANS=1024,
+			MAX_BANS=MaxBans,
+			MAX_NODES=MaxBans*2,
 		};
 
-		CBan<CDataType> *m_paaHashList[HashCount][256];
+		void InsertUsed(CBan<CDataType> *pBan);
+		CBanNode<CDataType> *FindNode(const CNetPrefix *pPrefix) const;
+		CBanNode<CDataType> *InsertNode(const CNetPrefix *pPrefix);
+		CBanNode<CDataType> *NewNode(const unsigned char *pPrefix, int Length, CBanNode<CDataType> *pParent);
+		void CollapseNode(CBanNode<CDataType> *pNode);
+
+		CBanNode<CDataType> *m_apRoot[2];
+		CBanNode<CDataType> m_aNodes[MAX_NODES];
+		CBanNode<CDataType> *m_pFirstFreeNode;
 		CBan<CDataType> m_aBans[MAX_BANS];
 		CBan<CDataType> *m_pFirstFree;
 		CBan<CDataType> *m_pFirstUsed;
+		CBan<CDataType> *m_pLastUsed;
 		int m_CountUsed;
+		unsigned m_Generation;
 	};
 
-	typedef CBanPool<NETADDR, 1> CBanAddrPool;
-	typedef CBanPool<CNetRange, 16> CBanRangePool;
+	typedef CBanPool<NETADDR, 4096> CBanAddrPool;
+	typedef CBanPool<CNetRange, 4096> CBanRangePool;
 	typedef CBan<NETADDR> CBanAddr;
 	typedef CBan<CNetRange> CBanRange;
 	
@@ -152,12 +178,60 @@ protected:
 	template<class T> int Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
 	template<class T> int Unban(T *pBanPool, const typename T::CDataType *pData);
 
+	// binary banlist, a header followed by ban/unban records that are applied in order
+	enum
+	{
+		BANLIST_VERSION=1,
+		BANLIST_HEADER_SIZE=8,
+		BANLIST_MAX_RECORD_SIZE=1+4+2*17+1+CBanInfo::REASON_LENGTH,
+
+		BANLIST_RECORD_BAN=0,
+		BANLIST_RECORD_UNBAN,
+		BANLIST_RECORD_UNBANALL,
+		BANLIST_RECORD_RANGE=0x80,
+	};
+	template<class T> static int PackBanRecord(unsigned char *pBuf, int Record, const T *pData, const CBanInfo *pInfo);
+	template<class T> int BulkBan(T *pBanPool, const typename T::CDataType *pData, const CBanInfo *pInfo);
+	template<class T> int BulkUnban(T *pBanPool, const typename T::CDataType *pData);
+	void OpenJournal();
+	void JournalWrite(const unsigned char *pRecord, int Size);
+	template<class T> void JournalBan(const CBan<T> *pBan);
+	template<class T> void JournalUnban(const T *pData);
+
+	// while attached the shared table holds all bans and the pools stay empty
+	template<class T> int BanShared(const T *pData, const CBanInfo *pInfo);
+	template<class T> int UnbanShared(const T *pData);
+	static void SharedBanInfo(const CNetBanShared::CEntry *pEntry, CBanInfo *pInfo);
+	void AttachShared(const char *pName);
+	template<class T> void MakePlayerBanInfo(T *pBanPool, const typename T::CDataType *pData, char *pBuf, unsigned BufferSize);
+
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
 	CBanAddrPool m_BanAddrPool;
 	CBanRangePool m_BanRangePool;
 	NETADDR m_LocalhostIPV4, m_LocalhostIPV6;
 
+	// addresses recently found not to be banned
+	enum
+	{
+		NEGATIVE_CACHE_SIZE=256,
+	};
+	struct CNegativeCacheEntry
+	{
+		NETADDR m_Addr;
+		unsigned m_Generation;
+	};
+	CNegativeCacheEntry m_aNegativeCache[NEGATIVE_CACHE_SIZE];
+
+	// stays open, every ban and unban gets appended and flushed
+	IOHANDLE m_JournalFile;
+
+	CNetBanShared m_SharedBans;
+	char m_aSharedBansName[64];
+	int m_SharedExpireTime;
+
+	unsigned BanGeneration() const { return m_BanAddrPool.Generation()+m_BanRangePool.Generation()+m_SharedBans.Sequence(); }
+
 public:
 	enum
 	{
@@ -170,7 +244,8 @@ public:
 	class IConsole *Console() const { return m_pConsole; }
 	class IStorage *Storage() const { return m_pStorage; }
 
-	virtual ~CNetBan() {}
+	CNetBan();
+	virtual ~CNetBan();
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void Update();
 
@@ -183,11 +258,18 @@ public:
 	template<class T> bool IsBannable(const T *pData);
 	bool IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize, int *pLastInfoQuery);
 
+	int SaveBinary(const char *pFilename);
+	int LoadBinary(const char *pFilename);
+
 	static void ConBan(class IConsole::IResult *pResult, void *pUser);
 	static void ConUnban(class IConsole::IResult *pResult, void *pUser);
 	static void ConUnbanAll(class IConsole::IResult *pResult, void *pUser);
 	static void ConBans(class IConsole::IResult *pResult, void *pUser);
 	static void ConBansSave(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansSaveBinary(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansLoad(class IConsole::IResult *pResult, void *pUser);
+	static void ConchainJournalUpdate(class IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConchainSharedMemoryUpdate(class IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 };
 
 #endif
@@ -0,0 +1,539 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include <engine/console.h>
+
+#include "netban.h"
+#include "netban_shared.h"
+
+static const char s_aSharedBansMagic[4] = {'T', 'W', 'S', 'B'};
+
+// orders ipv4 before ipv6 and ignores the port
+static int AddrComp(const NETADDR *pAddr1, const NETADDR *pAddr2)
+{
+	if(pAddr1->type != pAddr2->type)
+		return pAddr1->type < pAddr2->type ? -1 : 1;
+	return mem_comp(pAddr1->ip, pAddr2->ip, pAddr1->type==NETTYPE_IPV4 ? 4 : 16);
+}
+
+static bool Expired(const CNetBanShared::CEntry *pEntry, int Now)
+{
+	return pEntry->m_Expires != -1 && pEntry->m_Expires < Now;
+}
+
+unsigned CNetBanShared::Hash(const NETADDR *pAddr)
+{
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < (pAddr->type==NETTYPE_IPV4 ? 4 : 16); ++i)
+		Hash = (Hash^pAddr->ip[i])*16777619u;
+	return Hash;
+}
+
+unsigned CNetBanShared::ReadBegin() const
+{
+	// a writer that died mid-write leaves the counter odd, don't wait for it forever
+	unsigned Sequence = m_pTable->m_Sequence;
+	for(int i = 0; (Sequence&1) && i < MAX_READ_SPINS; ++i)
+	{
+		cpu_relax();
+		Sequence = m_pTable->m_Sequence;
+	}
+	sync_barrier();
+	return Sequence;
+}
+
+bool CNetBanShared::ReadRetry(unsigned Sequence) const
+{
+	sync_barrier();
+	return m_pTable->m_Sequence != Sequence;
+}
+
+void CNetBanShared::WriteBegin()
+{
+	unsigned Self = pid();
+	bool TookOver = false;
+	while(1)
+	{
+		unsigned Owner = atomic_compswap(&m_pTable->m_WriteLock, 0, Self);
+		if(Owner == 0)
+			break;
+
+		// only take the lock of a writer that died while holding it, writes of one
+		// process never overlap, so our own id can only be left over from a dead one
+		if((Owner == Self || !process_alive(Owner)) && atomic_compswap(&m_pTable->m_WriteLock, Owner, Self) == Owner)
+		{
+			TookOver = true;
+			break;
+		}
+		thread_yield();
+	}
+
+	m_pTable->m_Sequence = m_pTable->m_Sequence|1;
+	sync_barrier();
+
+	if(TookOver)
+		Repair();
+}
+
+void CNetBanShared::WriteEnd()
+{
+	sync_barrier();
+	m_pTable->m_Sequence = m_pTable->m_Sequence+1;
+	sync_barrier();
+	m_pTable->m_WriteLock = 0;
+}
+
+bool CNetBanShared::Attach(const char *pName)
+{
+	Detach();
+
+	int Created;
+	m_pTable = (CTable *)shm_map(pName, sizeof(CTable), &Created);
+	if(!m_pTable)
+		return false;
+
+	WriteBegin();
+	if(mem_comp(m_pTable->m_aMagic, s_aSharedBansMagic, sizeof(s_aSharedBansMagic)) != 0)
+	{
+		// fresh block, set up an empty table
+		m_pTable->m_Version = VERSION;
+		m_pTable->m_NumAddrs = 0;
+		m_pTable->m_NumDeleted = 0;
+		m_pTable->m_NumRanges = 0;
+		for(int i = 0; i < INDEX_SIZE; ++i)
+			m_pTable->m_aIndex[i] = INDEX_EMPTY;
+		mem_copy(m_pTable->m_aMagic, s_aSharedBansMagic, sizeof(s_aSharedBansMagic));
+	}
+	bool Compatible = m_pTable->m_Version == VERSION;
+	WriteEnd();
+
+	// created by a server with a different layout
+	if(!Compatible)
+		Detach();
+	return Compatible;
+}
+
+void CNetBanShared::Detach()
+{
+	if(m_pTable)
+		shm_unmap(m_pTable, sizeof(CTable));
+	m_pTable = 0;
+}
+
+int CNetBanShared::FindIndex(const NETADDR *pAddr, int *pEntry) const
+{
+	// readers can see the table mid-write, so every value read is checked
+	unsigned Pos = Hash(pAddr);
+	for(int i = 0; i < INDEX_SIZE; ++i, ++Pos)
+	{
+		int Entry = m_pTable->m_aIndex[Pos%INDEX_SIZE];
+		if(Entry == INDEX_EMPTY)
+			break;
+		if(Entry >= 0 && Entry < MAX_ADDR_BANS && NetComp(&m_pTable->m_aAddrs[Entry].m_LB, pAddr) == 0)
+		{
+			if(pEntry)
+				*pEntry = Entry;
+			return Pos%INDEX_SIZE;
+		}
+	}
+	return -1;
+}
+
+int CNetBanShared::RangeBound(const NETADDR *pAddr, bool Upper) const
+{
+	// first range with a lower bound above (or not below) the address
+	int Low = 0;
+	int High = clamp(m_pTable->m_NumRanges, 0, (int)MAX_RANGE_BANS);
+	while(Low < High)
+	{
+		int Mid = (Low+High)/2;
+		int Comp = AddrComp(&m_pTable->m_aRanges[Mid].m_LB, pAddr);
+		if(Comp < 0 || (Upper && Comp == 0))
+			Low = Mid+1;
+		else
+			High = Mid;
+	}
+	return Low;
+}
+
+int CNetBanShared::FindRange(const CNetRange *pRange) const
+{
+	int NumRanges = clamp(m_pTable->m_NumRanges, 0, (int)MAX_RANGE_BANS);
+	for(int i = RangeBound(&pRange->m_LB, false); i < NumRanges && AddrComp(&m_pTable->m_aRanges[i].m_LB, &pRange->m_LB) == 0; ++i)
+	{
+		if(AddrComp(&m_pTable->m_aRanges[i].m_UB, &pRange->m_UB) == 0)
+			return i;
+	}
+	return -1;
+}
+
+void CNetBanShared::Rebuild()
+{
+	for(int i = 0; i < INDEX_SIZE; ++i)
+		m_pTable->m_aIndex[i] = INDEX_EMPTY;
+	for(int i = 0; i < m_pTable->m_NumAddrs; ++i)
+	{
+		unsigned Pos = Hash(&m_pTable->m_aAddrs[i].m_LB);
+		while(m_pTable->m_aIndex[Pos%INDEX_SIZE] != INDEX_EMPTY)
+			++Pos;
+		m_pTable->m_aIndex[Pos%INDEX_SIZE] = i;
+	}
+	m_pTable->m_NumDeleted = 0;
+}
+
+void CNetBanShared::RebuildRanges(int From)
+{
+	for(int i = max(From, 0); i < m_pTable->m_NumRanges; ++i)
+	{
+		const NETADDR *pUB = &m_pTable->m_aRanges[i].m_UB;
+		if(i > 0 && AddrComp(&m_pTable->m_aRangeMaxUB[i-1], pUB) > 0)
+			pUB = &m_pTable->m_aRangeMaxUB[i-1];
+		m_pTable->m_aRangeMaxUB[i] = *pUB;
+	}
+}
+
+void CNetBanShared::Repair()
+{
+	// the previous writer died mid-write, restore everything derived from the entries
+	m_pTable->m_NumAddrs = clamp(m_pTable->m_NumAddrs, 0, (int)MAX_ADDR_BANS);
+	m_pTable->m_NumRanges = clamp(m_pTable->m_NumRanges, 0, (int)MAX_RANGE_BANS);
+	Rebuild();
+
+	// an insert or removal may have been cut short while moving the ranges
+	for(int i = 1; i < m_pTable->m_NumRanges; ++i)
+	{
+		CEntry Range = m_pTable->m_aRanges[i];
+		int j = i;
+		for(; j > 0 && AddrComp(&m_pTable->m_aRanges[j-1].m_LB, &Range.m_LB) > 0; --j)
+			m_pTable->m_aRanges[j] = m_pTable->m_aRanges[j-1];
+		m_pTable->m_aRanges[j] = Range;
+	}
+	RebuildRanges(0);
+}
+
+void CNetBanShared::RemoveAddr(int IndexPos)
+{
+	// keep the entries dense by moving the last one into the hole
+	int Entry = m_pTable->m_aIndex[IndexPos];
+	int Last = --m_pTable->m_NumAddrs;
+	m_pTable->m_aIndex[IndexPos] = INDEX_DELETED;
+	m_pTable->m_NumDeleted++;
+	if(Entry != Last)
+	{
+		m_pTable->m_aIndex[FindIndex(&m_pTable->m_aAddrs[Last].m_LB)] = Entry;
+		m_pTable->m_aAddrs[Entry] = m_pTable->m_aAddrs[Last];
+	}
+}
+
+void CNetBanShared::RemoveRange(int Range)
+{
+	// keep the ranges sorted
+	int Last = --m_pTable->m_NumRanges;
+	for(int i = Range; i < Last; ++i)
+		m_pTable->m_aRanges[i] = m_pTable->m_aRanges[i+1];
+	RebuildRanges(Range);
+}
+
+int CNetBanShared::AddAddr(const NETADDR *pAddr, int Expires, const char *pReason)
+{
+	int Pos = FindIndex(pAddr);
+	if(Pos >= 0)
+	{
+		CEntry *pEntry = &m_pTable->m_aAddrs[m_pTable->m_aIndex[Pos]];
+		pEntry->m_Expires = Expires;
+		str_copy(pEntry->m_aReason, pReason, sizeof(pEntry->m_aReason));
+		return 1;
+	}
+	if(m_pTable->m_NumAddrs >= MAX_ADDR_BANS)
+		return -1;
+
+	if(m_pTable->m_NumAddrs+m_pTable->m_NumDeleted >= INDEX_SIZE*3/4)
+		Rebuild();
+
+	int Entry = m_pTable->m_NumAddrs++;
+	CEntry *pEntry = &m_pTable->m_aAddrs[Entry];
+	mem_zero(pEntry, sizeof(*pEntry));
+	pEntry->m_LB = *pAddr;
+	pEntry->m_LB.port = 0;
+	pEntry->m_Expires = Expires;
+	str_copy(pEntry->m_aReason, pReason, sizeof(pEntry->m_aReason));
+
+	unsigned Hashed = Hash(pAddr);
+	while(m_pTable->m_aIndex[Hashed%INDEX_SIZE] >= 0)
+		++Hashed;
+	if(m_pTable->m_aIndex[Hashed%INDEX_SIZE] == INDEX_DELETED)
+		m_pTable->m_NumDeleted--;
+	m_pTable->m_aIndex[Hashed%INDEX_SIZE] = Entry;
+	return 0;
+}
+
+int CNetBanShared::AddRange(const CNetRange *pRange, int Expires, const char *pReason)
+{
+	int Range = FindRange(pRange);
+	if(Range >= 0)
+	{
+		CEntry *pEntry = &m_pTable->m_aRanges[Range];
+		pEntry->m_Expires = Expires;
+		str_copy(pEntry->m_aReason, pReason, sizeof(pEntry->m_aReason));
+		return 1;
+	}
+	if(m_pTable->m_NumRanges >= MAX_RANGE_BANS)
+		return -1;
+
+	// insert behind the ranges with the same lower bound
+	Range = RangeBound(&pRange->m_LB, true);
+	for(int i = m_pTable->m_NumRanges; i > Range; --i)
+		m_pTable->m_aRanges[i] = m_pTable->m_aRanges[i-1];
+	m_pTable->m_NumRanges++;
+
+	CEntry *pEntry = &m_pTable->m_aRanges[Range];
+	mem_zero(pEntry, sizeof(*pEntry));
+	pEntry->m_LB = pRange->m_LB;
+	pEntry->m_UB = pRange->m_UB;
+	pEntry->m_LB.port = pEntry->m_UB.port = 0;
+	pEntry->m_Expires = Expires;
+	str_copy(pEntry->m_aReason, pReason, sizeof(pEntry->m_aReason));
+	RebuildRanges(Range);
+	return 0;
+}
+
+int CNetBanShared::Ban(const NETADDR *pAddr, int Expires, const char *pReason)
+{
+	WriteBegin();
+	int Result = AddAddr(pAddr, Expires, pReason);
+	WriteEnd();
+	return Result;
+}
+
+int CNetBanShared::Ban(const CNetRange *pRange, int Expires, const char *pReason)
+{
+	WriteBegin();
+	int Result = AddRange(pRange, Expires, pReason);
+	WriteEnd();
+	return Result;
+}
+
+int CNetBanShared::Unban(const NETADDR *pAddr)
+{
+	WriteBegin();
+	int Pos = FindIndex(pAddr);
+	if(Pos >= 0)
+		RemoveAddr(Pos);
+	WriteEnd();
+	return Pos >= 0 ? 0 : -1;
+}
+
+int CNetBanShared::Unban(const CNetRange *pRange)
+{
+	WriteBegin();
+	int Range = FindRange(pRange);
+	if(Range >= 0)
+		RemoveRange(Range);
+	WriteEnd();
+	return Range >= 0 ? 0 : -1;
+}
+
+int CNetBanShared::Merge(const CEntry *pEntries, int Num)
+{
+	WriteBegin();
+
+	// count the new bans first, so the table stays as it is if they don't fit
+	int NumNewAddrs = 0;
+	int NumNewRanges = 0;
+	for(int i = 0; i < Num; ++i)
+	{
+		if(pEntries[i].IsRange())
+		{
+			CNetRange Range;
+			Range.m_LB = pEntries[i].m_LB;
+			Range.m_UB = pEntries[i].m_UB;
+			NumNewRanges += FindRange(&Range) < 0;
+		}
+		else
+			NumNewAddrs += FindIndex(&pEntries[i].m_LB) < 0;
+	}
+
+	int Result = -1;
+	if(m_pTable->m_NumAddrs+NumNewAddrs <= MAX_ADDR_BANS && m_pTable->m_NumRanges+NumNewRanges <= MAX_RANGE_BANS)
+	{
+		for(int i = 0; i < Num; ++i)
+		{
+			if(pEntries[i].IsRange())
+			{
+				CNetRange Range;
+				Range.m_LB = pEntries[i].m_LB;
+				Range.m_UB = pEntries[i].m_UB;
+				AddRange(&Range, pEntries[i].m_Expires, pEntries[i].m_aReason);
+			}
+			else
+				AddAddr(&pEntries[i].m_LB, pEntries[i].m_Expires, pEntries[i].m_aReason);
+		}
+		Result = NumNewAddrs+NumNewRanges;
+	}
+
+	WriteEnd();
+	return Result;
+}
+
+void CNetBanShared::Reset()
+{
+	WriteBegin();
+	m_pTable->m_NumAddrs = 0;
+	m_pTable->m_NumRanges = 0;
+	Rebuild();
+	WriteEnd();
+}
+
+int CNetBanShared::Expire(int Now, CEntry *pEntries, int MaxEntries)
+{
+	// checked without the lock first, every server runs this
+	int Num = 0;
+	bool Found = false;
+	unsigned Sequence;
+	do
+	{
+		Sequence = ReadBegin();
+		Found = false;
+		for(int i = 0; !Found && i < min(m_pTable->m_NumAddrs, (int)MAX_ADDR_BANS); ++i)
+			Found = Expired(&m_pTable->m_aAddrs[i], Now);
+		for(int i = 0; !Found && i < min(m_pTable->m_NumRanges, (int)MAX_RANGE_BANS); ++i)
+			Found = Expired(&m_pTable->m_aRanges[i], Now);
+	}
+	while(ReadRetry(Sequence));
+	if(!Found)
+		return 0;
+
+	WriteBegin();
+	for(int i = 0; i < m_pTable->m_NumAddrs && Num < MaxEntries;)
+	{
+		if(Expired(&m_pTable->m_aAddrs[i], Now))
+		{
+			pEntries[Num++] = m_pTable->m_aAddrs[i];
+			RemoveAddr(FindIndex(&m_pTable->m_aAddrs[i].m_LB));
+		}
+		else
+			++i;
+	}
+	for(int i = 0; i < m_pTable->m_NumRanges && Num < MaxEntries;)
+	{
+		if(Expired(&m_pTable->m_aRanges[i], Now))
+		{
+			pEntries[Num++] = m_pTable->m_aRanges[i];
+			RemoveRange(i);
+		}
+		else
+			++i;
+	}
+	WriteEnd();
+	return Num;
+}
+
+int CNetBanShared::Num() const
+{
+	int Num;
+	unsigned Sequence;
+	do
+	{
+		Sequence = ReadBegin();
+		Num = m_pTable->m_NumAddrs+m_pTable->m_NumRanges;
+	}
+	while(ReadRetry(Sequence));
+	return Num;
+}
+
+bool CNetBanShared::Get(int Index, CEntry *pEntry) const
+{
+	bool Found;
+	unsigned Sequence;
+	do
+	{
+		Sequence = ReadBegin();
+		int NumAddrs = min(m_pTable->m_NumAddrs, (int)MAX_ADDR_BANS);
+		int NumRanges = min(m_pTable->m_NumRanges, (int)MAX_RANGE_BANS);
+		Found = true;
+		if(Index >= 0 && Index < NumAddrs)
+			*pEntry = m_pTable->m_aAddrs[Index];
+		else if(Index >= NumAddrs && Index < NumAddrs+NumRanges)
+			*pEntry = m_pTable->m_aRanges[Index-NumAddrs];
+		else
+			Found = false;
+	}
+	while(ReadRetry(Sequence));
+	return Found;
+}
+
+bool CNetBanShared::Find(const NETADDR *pAddr, CEntry *pEntry) const
+{
+	int Pos;
+	unsigned Sequence;
+	do
+	{
+		Sequence = ReadBegin();
+		int Entry;
+		Pos = FindIndex(pAddr, &Entry);
+		if(Pos >= 0)
+			*pEntry = m_pTable->m_aAddrs[Entry];
+	}
+	while(ReadRetry(Sequence));
+	return Pos >= 0;
+}
+
+bool CNetBanShared::Find(const CNetRange *pRange, CEntry *pEntry) const
+{
+	int Range;
+	unsigned Sequence;
+	do
+	{
+		Sequence = ReadBegin();
+		Range = FindRange(pRange);
+		if(Range >= 0)
+			*pEntry = m_pTable->m_aRanges[Range];
+	}
+	while(ReadRetry(Sequence));
+	return Range >= 0;
+}
+
+int CNetBanShared::Match(const NETADDR *pAddr, int Now, CEntry *pEntry) const
+{
+	int Slot;
+	unsigned Sequence;
+	do
+	{
+		Sequence = ReadBegin();
+		Slot = -1;
+		int Entry;
+		if(FindIndex(pAddr, &Entry) >= 0 && !Expired(&m_pTable->m_aAddrs[Entry], Now))
+		{
+			Slot = Entry;
+			*pEntry = m_pTable->m_aAddrs[Slot];
+		}
+		else
+		{
+			// only ranges starting at or below the address can contain it
+			for(int i = RangeBound(pAddr, true)-1; i >= 0 && AddrComp(&m_pTable->m_aRangeMaxUB[i], pAddr) >= 0; --i)
+			{
+				const CEntry *pRange = &m_pTable->m_aRanges[i];
+				if(AddrComp(&pRange->m_UB, pAddr) >= 0 && !Expired(pRange, Now))
+				{
+					Slot = MAX_ADDR_BANS+i;
+					*pEntry = *pRange;
+					break;
+				}
+			}
+		}
+	}
+	while(ReadRetry(Sequence));
+	return Slot;
+}
+
+void CNetBanShared::SetLastInfoQuery(int Slot, int Time)
+{
+	// only throttles ban messages, a racing write doesn't matter
+	if(Slot >= 0 && Slot < MAX_ADDR_BANS)
+		m_pTable->m_aAddrs[Slot].m_LastInfoQuery = Time;
+	else if(Slot >= MAX_ADDR_BANS && Slot < MAX_ADDR_BANS+MAX_RANGE_BANS)
+		m_pTable->m_aRanges[Slot-MAX_ADDR_BANS].m_LastInfoQuery = Time;
+}
@@ -0,0 +1,115 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_NETBAN_SHARED_H
+#define ENGINE_SHARED_NETBAN_SHARED_H
+
+#include <base/system.h>
+
+class CNetRange;
+
+// banlist in a named shared memory block, used by all servers on one host.
+// writers serialize on a spin lock that holds the process id of the writer, readers
+// never block: every change is framed by a sequence counter that is odd while the
+// table is written, readers copy what they need and retry when the counter moved in
+// the meantime.
+class CNetBanShared
+{
+public:
+	enum
+	{
+		MAX_ADDR_BANS=8192,
+		MAX_RANGE_BANS=1024,
+		REASON_LENGTH=64,
+	};
+
+	struct CEntry
+	{
+		NETADDR m_LB;
+		NETADDR m_UB;	// NETTYPE_INVALID for address bans
+		int m_Expires;
+		int m_LastInfoQuery;
+		char m_aReason[REASON_LENGTH];
+
+		bool IsRange() const { return m_UB.type != NETTYPE_INVALID; }
+	};
+
+private:
+	enum
+	{
+		VERSION=2,
+		INDEX_SIZE=MAX_ADDR_BANS*2,
+		INDEX_EMPTY=-1,
+		INDEX_DELETED=-2,
+		MAX_READ_SPINS=4096,
+	};
+
+	// layout of the shared block, address bans are kept dense and found through an
+	// open addressing hash index. ranges are sorted by their lower bound and carry
+	// the highest upper bound up to them, a lookup starts at the last range beginning
+	// below the address and walks back only while a range could still reach it.
+	struct CTable
+	{
+		char m_aMagic[4];
+		int m_Version;
+		volatile unsigned m_Sequence;
+		volatile unsigned m_WriteLock;
+		int m_NumAddrs;
+		int m_NumDeleted;
+		int m_NumRanges;
+		int m_aIndex[INDEX_SIZE];
+		CEntry m_aAddrs[MAX_ADDR_BANS];
+		CEntry m_aRanges[MAX_RANGE_BANS];
+		NETADDR m_aRangeMaxUB[MAX_RANGE_BANS];
+	};
+
+	CTable *m_pTable;
+
+	static unsigned Hash(const NETADDR *pAddr);
+	int FindIndex(const NETADDR *pAddr, int *pEntry=0) const;
+	int FindRange(const CNetRange *pRange) const;
+	int RangeBound(const NETADDR *pAddr, bool Upper) const;
+	void Rebuild();
+	void RebuildRanges(int From);
+	void Repair();
+	int AddAddr(const NETADDR *pAddr, int Expires, const char *pReason);
+	int AddRange(const CNetRange *pRange, int Expires, const char *pReason);
+	void RemoveAddr(int IndexPos);
+	void RemoveRange(int Range);
+
+	unsigned ReadBegin() const;
+	bool ReadRetry(unsigned Sequence) const;
+	void WriteBegin();
+	void WriteEnd();
+
+public:
+	CNetBanShared() : m_pTable(0) {}
+	~CNetBanShared() { Detach(); }
+
+	bool Attach(const char *pName);
+	void Detach();
+	bool IsAttached() const { return m_pTable != 0; }
+	// changes with every write to the table
+	unsigned Sequence() const { return m_pTable ? m_pTable->m_Sequence : 0; }
+
+	// 0 if the ban got added, 1 if an existing one got updated, -1 if the table is full
+	int Ban(const NETADDR *pAddr, int Expires, const char *pReason);
+	int Ban(const CNetRange *pRange, int Expires, const char *pReason);
+	// 0 if the ban got removed, -1 if there is none
+	int Unban(const NETADDR *pAddr);
+	int Unban(const CNetRange *pRange);
+	// adds all entries or none of them, number of new bans or -1 if they don't fit
+	int Merge(const CEntry *pEntries, int Num);
+	void Reset();
+	// removes up to MaxEntries expired bans and copies them to pEntries
+	int Expire(int Now, CEntry *pEntries, int MaxEntries);
+
+	int Num() const;
+	bool Get(int Index, CEntry *pEntry) const;
+	bool Find(const NETADDR *pAddr, CEntry *pEntry) const;
+	bool Find(const CNetRange *pRange, CEntry *pEntry) const;
+	// returns a slot for SetLastInfoQuery or -1 if the address isn't banned
+	int Match(const NETADDR *pAddr, int Now, CEntry *pEntry) const;
+	void SetLastInfoQuery(int Slot, int Time);
+};
+
+#endif
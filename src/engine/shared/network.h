@@ -273,6 +273,49 @@ private:
 };
 
 
+// token buckets for packets from addresses without a connection, one bucket per
+// /24 (ipv4) or /48 (ipv6) network and a global one. checked before any token or
+// server info work is done so floods with spoofed sources are dropped cheaply.
+class CNetConnlessLimiter
+{
+public:
+	void Init();
+	// packets per second, bursts of up to two seconds are allowed, 0 disables a limit
+	void SetRates(int PrefixRate, int GlobalRate);
+	bool Admit(const NETADDR *pAddr, int64 Now);
+
+	int NumAdmitted() const { return m_NumAdmitted; }
+	int NumDroppedPrefix() const { return m_NumDroppedPrefix; }
+	int NumDroppedGlobal() const { return m_NumDroppedGlobal; }
+
+private:
+	enum
+	{
+		NUM_BUCKETS=4096,
+		PREFIX_SIZE=7,	// family and up to 6 address bytes
+		TOKEN_SCALE=1000,
+	};
+
+	struct CBucket
+	{
+		unsigned char m_aPrefix[PREFIX_SIZE];
+		int64 m_Tokens;	// in 1/TOKEN_SCALE tokens
+		int64 m_LastRefill;
+	};
+
+	static bool Take(CBucket *pBucket, int Rate, int64 Now);
+
+	CBucket m_aBuckets[NUM_BUCKETS];
+	CBucket m_Global;
+	int m_PrefixRate;
+	int m_GlobalRate;
+
+	int m_NumAdmitted;
+	int m_NumDroppedPrefix;
+	int m_NumDroppedGlobal;
+};
+
+
 class CNetConnection
 {
 	// TODO: is this needed because this needs to be aware of
@@ -289,6 +332,8 @@ private:
 	bool m_BlockCloseMsg;
 
 	TStaticRingBuffer<CNetChunkResend, NET_CONN_BUFFERSIZE> m_Buffer;
+	// bytes of vital chunks waiting for their ack
+	int m_BufferUsed;
 
 	int64 m_LastUpdateTime;
 	int64 m_LastRecvTime;
@@ -350,6 +395,11 @@ public:
 	int64 ConnectTime() const { return m_LastUpdateTime; }
 
 	int AckSequence() const { return m_Ack; }
+	// bytes of vital chunks that can still be queued before the resend buffer runs full
+	int ResendBufferFree() const { return NET_CONN_BUFFERSIZE-m_BufferUsed; }
+
+	// sent_packets/sent_bytes count flushed data packets and their payload
+	const NETSTATS *Stats() const { return &m_Stats; }
 };
 
 class CConsoleNetConnection
@@ -407,6 +457,7 @@ class CNetServer
 	{
 	public:
 		CNetConnection m_Connection;
+		bool m_FlushPending;
 	};
 
 	NETSOCKET m_Socket;
@@ -414,6 +465,7 @@ class CNetServer
 	CSlot m_aSlots[NET_MAX_CLIENTS];
 	int m_MaxClients;
 	int m_MaxClientsPerIP;
+	bool m_CoalesceFlush;
 
 	NETFUNC_NEWCLIENT m_pfnNewClient;
 	NETFUNC_DELCLIENT m_pfnDelClient;
@@ -423,6 +475,7 @@ class CNetServer
 
 	CNetTokenManager m_TokenManager;
 	CNetTokenCache m_TokenCache;
+	CNetConnlessLimiter m_ConnlessLimiter;
 
 	int m_Flags;
 public:
@@ -436,6 +489,7 @@ public:
 	int Recv(CNetChunk *pChunk, TOKEN *pResponseToken = 0);
 	int Send(CNetChunk *pChunk, TOKEN Token = NET_TOKEN_NONE);
 	int Update();
+	int Flush();
 	void AddToken(const NETADDR *pAddr, TOKEN Token) { m_TokenCache.AddToken(pAddr, Token, 0); };
 
 	//
@@ -443,13 +497,19 @@ public:
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	int ResendBufferFree(int ClientID) const { return m_aSlots[ClientID].m_Connection.ResendBufferFree(); }
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
 	int MaxClients() const { return m_MaxClients; }
 
+	void Stats(NETSTATS *pStats) const;
+	const CNetConnlessLimiter *ConnlessLimiter() const { return &m_ConnlessLimiter; }
+
 	//
 	void SetMaxClientsPerIP(int Max);
+	void SetCoalesceFlush(bool Coalesce);
+	void SetConnlessRates(int PrefixRate, int GlobalRate) { m_ConnlessLimiter.SetRates(PrefixRate, GlobalRate); }
 };
 
 class CNetConsole
@@ -27,6 +27,7 @@ void CNetConnection::Reset()
 	mem_zero(&m_PeerAddr, sizeof(m_PeerAddr));
 
 	m_Buffer.Init();
+	m_BufferUsed = 0;
 
 	mem_zero(&m_Construct, sizeof(m_Construct));
 }
@@ -73,7 +74,10 @@ void CNetConnection::AckChunks(int Ack)
 			break;
 
 		if(CNetBase::IsSeqInBackroom(pResend->m_Sequence, Ack))
+		{
+			m_BufferUsed -= sizeof(CNetChunkResend)+pResend->m_DataSize;
 			m_Buffer.PopFirst();
+		}
 		else
 			break;
 	}
@@ -90,6 +94,12 @@ int CNetConnection::Flush()
 	if(!NumChunks && !m_Construct.m_Flags)
 		return 0;
 
+	if(NumChunks)
+	{
+		m_Stats.sent_packets++;
+		m_Stats.sent_bytes += m_Construct.m_DataSize;
+	}
+
 	// send of the packets
 	m_Construct.m_Ack = m_Ack;
 	m_Construct.m_Token = m_PeerToken;
@@ -140,6 +150,7 @@ int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int
 			pResend->m_FirstSendTime = time_get();
 			pResend->m_LastSendTime = pResend->m_FirstSendTime;
 			mem_copy(pResend->m_pData, pData, DataSize);
+			m_BufferUsed += sizeof(CNetChunkResend)+DataSize;
 		}
 		else
 		{
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/console.h>
@@ -20,6 +21,7 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 
 	m_TokenManager.Init(m_Socket);
 	m_TokenCache.Init(m_Socket, &m_TokenManager);
+	m_ConnlessLimiter.Init();
 
 	m_pNetBan = pNetBan;
 
@@ -33,7 +35,10 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	m_MaxClientsPerIP = MaxClientsPerIP;
 
 	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+	{
 		m_aSlots[i].m_Connection.Init(m_Socket, true);
+		m_aSlots[i].m_FlushPending = false;
+	}
 
 	m_Flags = Flags;
 
@@ -65,7 +70,15 @@ int CNetServer::Drop(int ClientID, const char *pReason, bool ForceDisconnect)
 		Error = m_pfnDelClient(ClientID, pReason, m_UserPtr, ForceDisconnect);
 
 	if(Error == 0)
+	{
+		// deliver deferred messages before the close message
+		if(m_aSlots[ClientID].m_FlushPending)
+		{
+			m_aSlots[ClientID].m_Connection.Flush();
+			m_aSlots[ClientID].m_FlushPending = false;
+		}
 		m_aSlots[ClientID].m_Connection.Disconnect(pReason);
+	}
 
 	return Error;
 }
@@ -94,6 +107,87 @@ int CNetServer::Update()
 	return 0;
 }
 
+// sends all chunks that were queued with a deferred flush request,
+// packed into as few packets per connection as possible
+int CNetServer::Flush()
+{
+	int NumFlushed = 0;
+	for(int i = 0; i < MaxClients(); i++)
+	{
+		if(!m_aSlots[i].m_FlushPending)
+			continue;
+
+		m_aSlots[i].m_FlushPending = false;
+		if(m_aSlots[i].m_Connection.State() != NET_CONNSTATE_OFFLINE)
+		{
+			m_aSlots[i].m_Connection.Flush();
+			NumFlushed++;
+		}
+	}
+	return NumFlushed;
+}
+
+void CNetConnlessLimiter::Init()
+{
+	mem_zero(this, sizeof(*this));
+}
+
+void CNetConnlessLimiter::SetRates(int PrefixRate, int GlobalRate)
+{
+	m_PrefixRate = PrefixRate;
+	m_GlobalRate = GlobalRate;
+}
+
+bool CNetConnlessLimiter::Take(CBucket *pBucket, int Rate, int64 Now)
+{
+	if(Rate <= 0)
+		return true;
+
+	int64 Burst = (int64)Rate*2*TOKEN_SCALE;
+	if(pBucket->m_LastRefill == 0 || Now-pBucket->m_LastRefill >= time_freq()*2)
+		pBucket->m_Tokens = Burst;
+	else if(Now > pBucket->m_LastRefill)
+		pBucket->m_Tokens = min(Burst, pBucket->m_Tokens + (Now-pBucket->m_LastRefill)*Rate*TOKEN_SCALE/time_freq());
+	pBucket->m_LastRefill = Now;
+
+	if(pBucket->m_Tokens < TOKEN_SCALE)
+		return false;
+	pBucket->m_Tokens -= TOKEN_SCALE;
+	return true;
+}
+
+bool CNetConnlessLimiter::Admit(const NETADDR *pAddr, int64 Now)
+{
+	unsigned char aPrefix[PREFIX_SIZE] = {0};
+	aPrefix[0] = pAddr->type;
+	mem_copy(&aPrefix[1], pAddr->ip, pAddr->type == NETTYPE_IPV4 ? 3 : 6);
+
+	unsigned Hash = 0;
+	for(int i = 0; i < PREFIX_SIZE; i++)
+		Hash = Hash*31 + aPrefix[i];
+
+	// buckets are direct mapped, a colliding network takes the bucket over with a full burst
+	CBucket *pBucket = &m_aBuckets[Hash%NUM_BUCKETS];
+	if(mem_comp(pBucket->m_aPrefix, aPrefix, PREFIX_SIZE) != 0)
+	{
+		mem_copy(pBucket->m_aPrefix, aPrefix, PREFIX_SIZE);
+		pBucket->m_LastRefill = 0;
+	}
+
+	if(!Take(pBucket, m_PrefixRate, Now))
+	{
+		m_NumDroppedPrefix++;
+		return false;
+	}
+	if(!Take(&m_Global, m_GlobalRate, Now))
+	{
+		m_NumDroppedGlobal++;
+		return false;
+	}
+	m_NumAdmitted++;
+	return true;
+}
+
 /*
 	TODO: chopp up this function into smaller working parts
 */
@@ -116,6 +210,20 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 
 		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
 		{
+			// packets from addresses without a connection can have spoofed sources,
+			// they are limited before the ban lookup or any token work
+			int SlotID = -1;
+			for(int i = 0; i < MaxClients(); i++)
+			{
+				if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
+				{
+					SlotID = i;
+					break;
+				}
+			}
+			if(SlotID < 0 && !m_ConnlessLimiter.Admit(&Addr, time_get()))
+				continue;
+
 			// check for bans
 			char aBuf[128];
 			int LastInfoQuery;
@@ -130,37 +238,27 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 				continue;
 			}
 
-			bool Found = false;
-			// try to find matching slot
-			for(int i = 0; i < MaxClients(); i++)
+			if(SlotID >= 0)
 			{
-				if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
+				CNetConnection *pConnection = &m_aSlots[SlotID].m_Connection;
+				if(pConnection->Feed(&m_RecvUnpacker.m_Data, &Addr) && m_RecvUnpacker.m_Data.m_DataSize)
 				{
-					if(m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
+					if(!(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS))
+						m_RecvUnpacker.Start(&Addr, pConnection, SlotID);
+					else
 					{
-						if(m_RecvUnpacker.m_Data.m_DataSize)
-						{
-							if(!(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS))
-								m_RecvUnpacker.Start(&Addr, &m_aSlots[i].m_Connection, i);
-							else
-							{
-								pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-								pChunk->m_Address = *m_aSlots[i].m_Connection.PeerAddress();
-								pChunk->m_ClientID = i;
-								pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-								pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-								if(pResponseToken)
-									*pResponseToken = NET_TOKEN_NONE;
-								return 1;
-							}
-						}
+						pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+						pChunk->m_Address = *pConnection->PeerAddress();
+						pChunk->m_ClientID = SlotID;
+						pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+						pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+						if(pResponseToken)
+							*pResponseToken = NET_TOKEN_NONE;
+						return 1;
 					}
-					Found = true;
 				}
-			}
-
-			if(Found)
 				continue;
+			}
 
 			int Accept = m_TokenManager.ProcessMessage(&Addr, &m_RecvUnpacker.m_Data);
 			if(Accept <= 0)
@@ -289,7 +387,12 @@ int CNetServer::Send(CNetChunk *pChunk, TOKEN Token)
 		if(m_aSlots[pChunk->m_ClientID].m_Connection.QueueChunk(Flags, pChunk->m_DataSize, pChunk->m_pData) == 0)
 		{
 			if(pChunk->m_Flags&NETSENDFLAG_FLUSH)
-				m_aSlots[pChunk->m_ClientID].m_Connection.Flush();
+			{
+				if(m_CoalesceFlush)
+					m_aSlots[pChunk->m_ClientID].m_FlushPending = true;
+				else
+					m_aSlots[pChunk->m_ClientID].m_Connection.Flush();
+			}
 		}
 		else
 		{
@@ -309,3 +412,23 @@ void CNetServer::SetMaxClientsPerIP(int Max)
 
 	m_MaxClientsPerIP = Max;
 }
+
+void CNetServer::SetCoalesceFlush(bool Coalesce)
+{
+	m_CoalesceFlush = Coalesce;
+	if(!m_CoalesceFlush)
+		Flush();
+}
+
+void CNetServer::Stats(NETSTATS *pStats) const
+{
+	mem_zero(pStats, sizeof(*pStats));
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+	{
+		const NETSTATS *pConnStats = m_aSlots[i].m_Connection.Stats();
+		pStats->sent_packets += pConnStats->sent_packets;
+		pStats->sent_bytes += pConnStats->sent_bytes;
+		pStats->recv_packets += pConnStats->recv_packets;
+		pStats->recv_bytes += pConnStats->recv_bytes;
+	}
+}
@@ -156,3 +156,65 @@ const unsigned char *CUnpacker::GetRaw(int Size)
 	m_pCurrent += Size;
 	return pPtr;
 }
+
+
+CPackedMsgList::CPackedMsgList()
+{
+	m_pData = 0;
+	m_DataSize = 0;
+	m_DataCapacity = 0;
+	m_pOffsets = 0;
+	m_Num = 0;
+	m_Capacity = 0;
+}
+
+CPackedMsgList::~CPackedMsgList()
+{
+	if(m_pData)
+		mem_free(m_pData);
+	if(m_pOffsets)
+		mem_free(m_pOffsets);
+}
+
+void CPackedMsgList::Clear()
+{
+	m_DataSize = 0;
+	m_Num = 0;
+}
+
+void CPackedMsgList::Add(const CPacker *pMsg)
+{
+	if(pMsg->Error())
+		return;
+
+	if(m_Num == m_Capacity)
+	{
+		int NewCapacity = m_Capacity ? m_Capacity*2 : 16;
+		int *pNewOffsets = (int *)mem_alloc(NewCapacity*sizeof(int), sizeof(int));
+		if(m_pOffsets)
+		{
+			mem_copy(pNewOffsets, m_pOffsets, m_Num*sizeof(int));
+			mem_free(m_pOffsets);
+		}
+		m_pOffsets = pNewOffsets;
+		m_Capacity = NewCapacity;
+	}
+	if(m_DataSize+pMsg->Size() > m_DataCapacity)
+	{
+		int NewCapacity = m_DataCapacity ? m_DataCapacity*2 : 1024;
+		while(NewCapacity < m_DataSize+pMsg->Size())
+			NewCapacity *= 2;
+		unsigned char *pNewData = (unsigned char *)mem_alloc(NewCapacity, 1);
+		if(m_pData)
+		{
+			mem_copy(pNewData, m_pData, m_DataSize);
+			mem_free(m_pData);
+		}
+		m_pData = pNewData;
+		m_DataCapacity = NewCapacity;
+	}
+
+	m_pOffsets[m_Num++] = m_DataSize;
+	mem_copy(m_pData+m_DataSize, pMsg->Data(), pMsg->Size());
+	m_DataSize += pMsg->Size();
+}
@@ -48,4 +48,26 @@ public:
 	bool Error() const { return m_Error; }
 };
 
+// messages that are packed once and sent to many clients
+class CPackedMsgList
+{
+	unsigned char *m_pData;
+	int m_DataSize;
+	int m_DataCapacity;
+	int *m_pOffsets;
+	int m_Num;
+	int m_Capacity;
+
+public:
+	CPackedMsgList();
+	~CPackedMsgList();
+
+	void Clear();
+	void Add(const CPacker *pMsg);
+
+	int Num() const { return m_Num; }
+	const unsigned char *Data(int Index) const { return m_pData+m_pOffsets[Index]; }
+	int Size(int Index) const { return (Index+1 < m_Num ? m_pOffsets[Index+1] : m_DataSize)-m_pOffsets[Index]; }
+};
+
 #endif
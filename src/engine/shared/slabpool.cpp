@@ -0,0 +1,121 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <string.h>
+
+#include <base/system.h>
+#include "slabpool.h"
+
+CSlabPool *CSlabPool::ms_pFirstPool = 0;
+
+CSlabPool::CSlabPool(const char *pName, unsigned SlotSize, int SlotsPerSlab)
+{
+	m_pName = pName;
+	// every slot has to hold the free list link
+	if(SlotSize < sizeof(CFreeSlot))
+		SlotSize = sizeof(CFreeSlot);
+	m_SlotSize = (SlotSize+ALIGNMENT-1)/ALIGNMENT*ALIGNMENT;
+	m_SlotsPerSlab = SlotsPerSlab > 0 ? SlotsPerSlab : 1;
+#ifdef CONF_DEBUG
+	m_Poison = true;
+#else
+	m_Poison = false;
+#endif
+
+	m_pFirstSlab = 0;
+	m_pFirstFree = 0;
+	m_NumSlabs = 0;
+	m_NumUsed = 0;
+	m_PeakUsed = 0;
+	m_NumAllocs = 0;
+
+	m_pNextPool = ms_pFirstPool;
+	ms_pFirstPool = this;
+}
+
+CSlabPool::~CSlabPool()
+{
+	for(CSlabPool **ppPool = &ms_pFirstPool; *ppPool; ppPool = &(*ppPool)->m_pNextPool)
+	{
+		if(*ppPool == this)
+		{
+			*ppPool = m_pNextPool;
+			break;
+		}
+	}
+
+	// objects still alive at exit keep their memory
+	if(m_NumUsed)
+		return;
+
+	while(m_pFirstSlab)
+	{
+		CSlab *pNext = m_pFirstSlab->m_pNext;
+		mem_free(m_pFirstSlab);
+		m_pFirstSlab = pNext;
+	}
+}
+
+void CSlabPool::NewSlab()
+{
+	// the slab header is padded so that the slots stay aligned
+	unsigned HeaderSize = (sizeof(CSlab)+ALIGNMENT-1)/ALIGNMENT*ALIGNMENT;
+	char *pMem = (char *)mem_alloc(HeaderSize+m_SlotSize*m_SlotsPerSlab, ALIGNMENT);
+	if(!pMem)
+		return;
+
+	CSlab *pSlab = (CSlab *)pMem;
+	pSlab->m_pNext = m_pFirstSlab;
+	m_pFirstSlab = pSlab;
+	m_NumSlabs++;
+
+	// chain the slots backwards so they get handed out in address order
+	char *pSlots = pMem+HeaderSize;
+	for(int i = m_SlotsPerSlab-1; i >= 0; i--)
+	{
+		CFreeSlot *pSlot = (CFreeSlot *)(pSlots+i*m_SlotSize);
+		if(m_Poison)
+			memset(pSlot, POISON, m_SlotSize);
+		pSlot->m_pNext = m_pFirstFree;
+		m_pFirstFree = pSlot;
+	}
+}
+
+void *CSlabPool::Allocate()
+{
+	if(!m_pFirstFree)
+	{
+		NewSlab();
+		if(!m_pFirstFree)
+			return 0;
+	}
+
+	CFreeSlot *pSlot = m_pFirstFree;
+	m_pFirstFree = pSlot->m_pNext;
+
+	if(m_Poison)
+	{
+		const unsigned char *pByte = (const unsigned char *)pSlot;
+		for(unsigned i = sizeof(CFreeSlot); i < m_SlotSize; i++)
+			dbg_assert(pByte[i] == POISON, "slab slot written after free");
+	}
+
+	m_NumUsed++;
+	m_NumAllocs++;
+	if(m_NumUsed > m_PeakUsed)
+		m_PeakUsed = m_NumUsed;
+	return pSlot;
+}
+
+void CSlabPool::Free(void *pPtr)
+{
+	if(!pPtr)
+		return;
+
+	dbg_assert(m_NumUsed > 0, "slab pool freed more than allocated");
+	CFreeSlot *pSlot = (CFreeSlot *)pPtr;
+	if(m_Poison)
+		memset(pSlot, POISON, m_SlotSize);
+	pSlot->m_pNext = m_pFirstFree;
+	m_pFirstFree = pSlot;
+	m_NumUsed--;
+}
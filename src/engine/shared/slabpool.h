@@ -0,0 +1,68 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_SLABPOOL_H
+#define ENGINE_SHARED_SLABPOOL_H
+
+// fixed size allocator, slots are handed out of contiguous slabs and kept on a free
+// list when released, slabs are never given back while slots are in use.
+// all pools are chained so they can be listed with their counters.
+class CSlabPool
+{
+	struct CSlab
+	{
+		CSlab *m_pNext;
+	};
+
+	struct CFreeSlot
+	{
+		CFreeSlot *m_pNext;
+	};
+
+	enum
+	{
+		// fill byte of released slots in poison mode
+		POISON=0xdd,
+		ALIGNMENT=16,
+	};
+
+	const char *m_pName;
+	unsigned m_SlotSize;
+	int m_SlotsPerSlab;
+	bool m_Poison;
+
+	CSlab *m_pFirstSlab;
+	CFreeSlot *m_pFirstFree;
+
+	int m_NumSlabs;
+	int m_NumUsed;
+	int m_PeakUsed;
+	int m_NumAllocs;
+
+	CSlabPool *m_pNextPool;
+	static CSlabPool *ms_pFirstPool;
+
+	void NewSlab();
+
+public:
+	CSlabPool(const char *pName, unsigned SlotSize, int SlotsPerSlab);
+	~CSlabPool();
+
+	void *Allocate();
+	void Free(void *pPtr);
+
+	// fills released slots and checks on reuse that nobody wrote to them,
+	// has to be set before the first allocation
+	void SetPoison(bool Poison) { m_Poison = Poison; }
+
+	const char *Name() const { return m_pName; }
+	unsigned SlotSize() const { return m_SlotSize; }
+	int NumSlabs() const { return m_NumSlabs; }
+	int NumUsed() const { return m_NumUsed; }
+	int PeakUsed() const { return m_PeakUsed; }
+	int NumAllocs() const { return m_NumAllocs; }
+
+	static CSlabPool *First() { return ms_pFirstPool; }
+	CSlabPool *Next() const { return m_pNextPool; }
+};
+
+#endif
@@ -122,11 +122,13 @@ public:
 
 class CSnapshotBuilder
 {
+public:
 	enum
 	{
 		MAX_ITEMS = 1024
 	};
 
+private:
 	char m_aData[CSnapshot::MAX_SIZE];
 	int m_DataSize;
 
@@ -77,6 +77,8 @@ public:
 				fs_makedir(GetPath(TYPE_SAVE, "demos", aPath, sizeof(aPath)));
 				fs_makedir(GetPath(TYPE_SAVE, "demos/auto", aPath, sizeof(aPath)));
 				fs_makedir(GetPath(TYPE_SAVE, "configs", aPath, sizeof(aPath)));
+				if(StorageType == STORAGETYPE_SERVER)
+					fs_makedir(GetPath(TYPE_SAVE, "inputs", aPath, sizeof(aPath)));
 			}
 			else
 			{
@@ -340,7 +342,7 @@ public:
 		}
 
 		// open file
-		if(Flags&IOFLAG_WRITE)
+		if(Flags&(IOFLAG_WRITE|IOFLAG_APPEND))
 		{
 			return io_open(GetPath(TYPE_SAVE, pFilename, pBuffer, BufferSize), Flags);
 		}
@@ -0,0 +1,49 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CHECKSUM_H
+#define GAME_CHECKSUM_H
+
+/*
+	Class: CChecksum
+		FNV-1a hash of game state. Values are added byte by byte in a fixed
+		order and floats by their bits, so equal states give equal hashes
+		on every platform.
+*/
+class CChecksum
+{
+	unsigned m_Hash;
+
+public:
+	CChecksum() : m_Hash(2166136261u) {}
+
+	void AddInt(int Value)
+	{
+		unsigned v = Value;
+		for(int i = 0; i < 4; i++)
+		{
+			m_Hash = (m_Hash^(v&0xff))*16777619u;
+			v >>= 8;
+		}
+	}
+
+	void AddFloat(float Value)
+	{
+		union
+		{
+			float f;
+			unsigned u;
+		} Bits;
+		Bits.f = Value;
+		AddInt(Bits.u);
+	}
+
+	void AddInts(const int *pValues, int Num)
+	{
+		for(int i = 0; i < Num; i++)
+			AddInt(pValues[i]);
+	}
+
+	unsigned Hash() const { return m_Hash; }
+};
+
+#endif
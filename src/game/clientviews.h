@@ -0,0 +1,87 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENTVIEWS_H
+#define GAME_CLIENTVIEWS_H
+
+#include <base/math.h>
+#include <base/system.h>
+#include <base/vmath.h>
+
+#include <engine/shared/protocol.h>
+
+/*
+	Class: CClientViews
+		View positions of the clients for the snapshot being built.
+		Answers which clients are close to a position as a mask with a
+		bit per client id.
+*/
+class CClientViews
+{
+	int m_NumViews;
+	int m_aClientIDs[MAX_CLIENTS];
+	float m_aX[MAX_CLIENTS];
+	float m_aY[MAX_CLIENTS];
+
+public:
+	CClientViews() : m_NumViews(0) {}
+
+	void Clear() { m_NumViews = 0; }
+	void Add(int ClientID, vec2 ViewPos)
+	{
+		m_aClientIDs[m_NumViews] = ClientID;
+		m_aX[m_NumViews] = ViewPos.x;
+		m_aY[m_NumViews] = ViewPos.y;
+		m_NumViews++;
+	}
+
+	static bool InView(vec2 ViewPos, vec2 Pos)
+	{
+		float dx = ViewPos.x-Pos.x;
+		float dy = ViewPos.y-Pos.y;
+		return absolute(dx) <= 1000.0f && absolute(dy) <= 800.0f && dx*dx+dy*dy <= 1100.0f*1100.0f;
+	}
+
+	// clients whose view contains the position
+	int64 ClientsInView(vec2 Pos) const
+	{
+		int64 Mask = 0;
+		for(int i = 0; i < m_NumViews; i++)
+		{
+			if(InView(vec2(m_aX[i], m_aY[i]), Pos))
+				Mask |= (int64)1<<m_aClientIDs[i];
+		}
+		return Mask;
+	}
+
+	// clients whose view is closer than Range to the position, only the candidates are checked
+	int64 ClientsInRange(vec2 Pos, float Range, int64 Candidates = -1) const
+	{
+		int64 Mask = 0;
+		for(int i = 0; i < m_NumViews; i++)
+		{
+			if(!(Candidates&((int64)1<<m_aClientIDs[i])))
+				continue;
+			float dx = m_aX[i]-Pos.x;
+			float dy = m_aY[i]-Pos.y;
+			if(dx*dx+dy*dy < Range*Range)
+				Mask |= (int64)1<<m_aClientIDs[i];
+		}
+		return Mask;
+	}
+
+	// clients whose view is closer than Range to the box
+	int64 ClientsInRange(vec2 Min, vec2 Max, float Range) const
+	{
+		int64 Mask = 0;
+		for(int i = 0; i < m_NumViews; i++)
+		{
+			float dx = max(max(Min.x-m_aX[i], m_aX[i]-Max.x), 0.0f);
+			float dy = max(max(Min.y-m_aY[i], m_aY[i]-Max.y), 0.0f);
+			if(dx*dx+dy*dy < Range*Range)
+				Mask |= (int64)1<<m_aClientIDs[i];
+		}
+		return Mask;
+	}
+};
+
+#endif
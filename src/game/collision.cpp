@@ -18,6 +18,16 @@ CCollision::CCollision()
 	m_Width = 0;
 	m_Height = 0;
 	m_pLayers = 0;
+	m_pFlags = 0;
+	m_FlagsWidth = 0;
+	m_FlagsHeight = 0;
+	m_MoveBoxMode = MOVEBOX_STEPPED;
+}
+
+CCollision::~CCollision()
+{
+	if(m_pFlags)
+		mem_free(m_pFlags);
 }
 
 void CCollision::Init(class CLayers *pLayers)
@@ -74,44 +84,134 @@ void CCollision::Init(class CLayers *pLayers)
 			m_pTiles[i].m_Index = 0;
 		}
 	}
+
+	// pack the converted tiles into flags, the border repeats the outermost
+	// tiles so that lookups just outside the map need no clamping
+	if(m_pFlags)
+		mem_free(m_pFlags);
+	m_FlagsWidth = m_Width+2*BORDER;
+	m_FlagsHeight = m_Height+2*BORDER;
+	m_pFlags = (unsigned short *)mem_alloc(sizeof(unsigned short)*m_FlagsWidth*m_FlagsHeight, 1);
+	for(int y = 0; y < m_FlagsHeight; y++)
+	{
+		int Ny = clamp(y-BORDER, 0, m_Height-1);
+		for(int x = 0; x < m_FlagsWidth; x++)
+		{
+			const CTile *pTile = &m_pTiles[Ny*m_Width+clamp(x-BORDER, 0, m_Width-1)];
+			int Flags = 0;
+			if(pTile->m_Reserved)
+				Flags = pTile->m_Index<<8;
+			else if(pTile->m_Index <= 128)
+				Flags = pTile->m_Index;
+			m_pFlags[y*m_FlagsWidth+x] = Flags;
+		}
+	}
 }
 
-int CCollision::GetTile(int x, int y) const
+int CCollision::FlagsColumn(int x) const
+{
+	// same tile as clamping x/32 to the map, only positions further out
+	// than the border need the clamp
+	unsigned Column = (unsigned)(x+BORDER*32)/32;
+	if(Column < (unsigned)m_FlagsWidth)
+		return Column;
+	return x < 0 ? 0 : m_FlagsWidth-1;
+}
+
+int CCollision::FlagsRow(int y) const
+{
+	unsigned Row = (unsigned)(y+BORDER*32)/32;
+	if(Row < (unsigned)m_FlagsHeight)
+		return Row;
+	return y < 0 ? 0 : m_FlagsHeight-1;
+}
+
+int CCollision::GetTileIndex(int x, int y) const
 {
 	int Nx = clamp(x/32, 0, m_Width-1);
 	int Ny = clamp(y/32, 0, m_Height-1);
+	return Ny*m_Width+Nx;
+}
 
-	if(m_pTiles[Ny*m_Width + Nx].m_Reserved)
-		return m_pTiles[Ny*m_Width + Nx].m_Index << COLFLAG_SPIKE_SHIFT;
-	else
-		return m_pTiles[Ny*m_Width+Nx].m_Index > 128 ? 0 : m_pTiles[Ny*m_Width+Nx].m_Index;
+int CCollision::GetTile(int x, int y) const
+{
+	return FlagsToTile(GetFlags(x, y));
 }
 
 bool CCollision::IsTile(int x, int y, int Flag) const
 {
-	return GetTile(x, y)&Flag;
+	return FlagsToTile(GetFlags(x, y))&Flag;
+}
+
+int CCollision::GetCollisionBox(vec2 Pos, vec2 Size) const
+{
+	Size *= 0.5f;
+	int x0 = FlagsColumn(round_to_int(Pos.x-Size.x));
+	int x1 = FlagsColumn(round_to_int(Pos.x+Size.x));
+	int y0 = FlagsRow(round_to_int(Pos.y-Size.y));
+	int y1 = FlagsRow(round_to_int(Pos.y+Size.y));
+
+	int Flags = 0;
+	for(int y = y0; y <= y1; y++)
+		for(int x = x0; x <= x1; x++)
+			Flags |= m_pFlags[y*m_FlagsWidth+x];
+	return FlagsToTile(Flags);
+}
+
+// first step of the line at which the coordinate passes the border
+static int LineStepAt(float From, float To, float Border, int End)
+{
+	float t = clamp((Border-From)/(To-From), 0.0f, 1.0f);
+	return (int)ceilf(t*End);
+}
+
+int CCollision::LineTileIndex(vec2 Pos0, vec2 Pos1, int Step, int End) const
+{
+	vec2 Pos = mix(Pos0, Pos1, Step/float(End));
+	return GetTileIndex(round_to_int(Pos.x), round_to_int(Pos.y));
 }
 
-// TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance+1);
-	vec2 Last = Pos0;
 
-	for(int i = 0; i <= End; i++)
+	// the line gets checked at End+1 evenly spaced points. the tile coordinates of
+	// these points only grow or only shrink, so the points in one tile form a run
+	// and only the first one of each run has to be checked. the end of a run is
+	// guessed from the tile border and then corrected on the actual points.
+	int i = 0;
+	while(i <= End)
 	{
-		float a = i/float(End);
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = mix(Pos0, Pos1, i/float(End));
 		if(CheckPoint(Pos.x, Pos.y))
 		{
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i > 0 ? mix(Pos0, Pos1, (i-1)/float(End)) : Pos0;
 			return GetCollisionAt(Pos.x, Pos.y);
 		}
-		Last = Pos;
+
+		int Tile = GetTileIndex(round_to_int(Pos.x), round_to_int(Pos.y));
+		int Nx = Tile%m_Width;
+		int Ny = Tile/m_Width;
+		int Next = End+1;
+		if(Pos1.x > Pos0.x && Nx < m_Width-1)
+			Next = min(Next, LineStepAt(Pos0.x, Pos1.x, (Nx+1)*32-0.5f, End));
+		else if(Pos1.x < Pos0.x && Nx > 0)
+			Next = min(Next, LineStepAt(Pos0.x, Pos1.x, Nx*32-0.5f, End));
+		if(Pos1.y > Pos0.y && Ny < m_Height-1)
+			Next = min(Next, LineStepAt(Pos0.y, Pos1.y, (Ny+1)*32-0.5f, End));
+		else if(Pos1.y < Pos0.y && Ny > 0)
+			Next = min(Next, LineStepAt(Pos0.y, Pos1.y, Ny*32-0.5f, End));
+
+		Next = clamp(Next, i+1, End+1);
+		while(Next-1 > i && LineTileIndex(Pos0, Pos1, Next-1, End) != Tile)
+			Next--;
+		while(Next <= End && LineTileIndex(Pos0, Pos1, Next, End) == Tile)
+			Next++;
+		i = Next;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -174,6 +274,15 @@ bool CCollision::TestBox(vec2 Pos, vec2 Size, int Flag) const
 }
 
 void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath) const
+{
+	// boxes stuck in the ground are left to the stepping, it keeps them in place
+	if(m_MoveBoxMode == MOVEBOX_SWEPT && !TestBox(*pInoutPos, Size))
+		MoveBoxSwept(pInoutPos, pInoutVel, Size, Elasticity, pDeath);
+	else
+		MoveBoxStepped(pInoutPos, pInoutVel, Size, Elasticity, pDeath);
+}
+
+void CCollision::MoveBoxStepped(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath) const
 {
 	// do the move
 	vec2 Pos = *pInoutPos;
@@ -240,3 +349,127 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 	*pInoutPos = Pos;
 	*pInoutVel = Vel;
 }
+
+// time until one of the box edges gets into the next tile row or column,
+// boxes behind the last row or column don't reach any further border
+float CCollision::BorderTime(float Pos, float Vel, float HalfSize, int NumTiles) const
+{
+	float Time = 2.0f;
+	for(int Side = -1; Side <= 1; Side += 2)
+	{
+		float Edge = Pos+Side*HalfSize;
+		int Tile = clamp(round_to_int(Edge)/32, 0, NumTiles-1);
+		if(Vel > 0.0f && Tile < NumTiles-1)
+			Time = min(Time, ((Tile+1)*32-0.5f-Edge)/Vel);
+		else if(Vel < 0.0f && Tile > 0)
+			Time = min(Time, (Tile*32-0.5f-Edge)/Vel);
+	}
+	return max(Time, 0.0f);
+}
+
+void CCollision::MoveBoxSwept(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath) const
+{
+	enum
+	{
+		MAX_BORDERS=1024,
+	};
+
+	// how far the box gets pushed over a border to be inside the next tile
+	const float Overshoot = 0.01f;
+
+	vec2 Pos = *pInoutPos;
+	vec2 Vel = *pInoutVel;
+	vec2 Half = Size*0.5f;
+	// deathtiles are a bit smaller
+	vec2 DeathSize = Size*(2.0f/3.0f);
+	vec2 DeathHalf = DeathSize*0.5f;
+
+	if(pDeath)
+		*pDeath = false;
+
+	if(length(Vel) > 0.00001f)
+	{
+		if(pDeath && TestBox(Pos, DeathSize, COLFLAG_DEATH))
+			*pDeath = true;
+
+		// the box only gets into new tiles when one of its edges passes a tile border,
+		// so it's enough to test the position right behind each border
+		float SubStep = 1.0f/(float)((int)length(Vel)+1);
+		float Time = 0.0f;
+		for(int i = 0; i < MAX_BORDERS && Time < 1.0f; i++)
+		{
+			float Step = 1.0f-Time;
+			float BorderX = BorderTime(Pos.x, Vel.x, Half.x, m_Width);
+			float BorderY = BorderTime(Pos.y, Vel.y, Half.y, m_Height);
+			if(pDeath)
+			{
+				BorderX = min(BorderX, BorderTime(Pos.x, Vel.x, DeathHalf.x, m_Width));
+				BorderY = min(BorderY, BorderTime(Pos.y, Vel.y, DeathHalf.y, m_Height));
+			}
+			float Border = min(BorderX, BorderY);
+			if(Border >= Step)
+			{
+				Pos += Vel*Step;
+				break;
+			}
+
+			// stop right in front of the border, nothing is in the way up to there.
+			// the push over it must not pass the next border of the other axis
+			float Other = max(BorderX, BorderY);
+			float Push;
+			if(BorderX == BorderY)
+				Push = Overshoot/max(absolute(Vel.x), absolute(Vel.y));
+			else
+				Push = Overshoot/(BorderX < BorderY ? absolute(Vel.x) : absolute(Vel.y));
+			float Before = max(Border-Push, 0.0f);
+			float After = min(Border+Push, Step);
+			if(Other > Border)
+			{
+				// borders closer than one unit step are passed together, like the
+				// stepping does when it runs into a corner
+				if(Other-Border < SubStep)
+					After = min(Other+Push, Step);
+				else
+					After = min(After, Other);
+			}
+			Pos += Vel*Before;
+			Step = After-Before;
+			Time += After;
+
+			vec2 NewPos = Pos+Vel*Step;
+			if(pDeath && TestBox(NewPos, DeathSize, COLFLAG_DEATH))
+				*pDeath = true;
+
+			if(TestBox(NewPos, Size))
+			{
+				int Hits = 0;
+
+				if(TestBox(vec2(Pos.x, NewPos.y), Size))
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					Hits++;
+				}
+
+				if(TestBox(vec2(NewPos.x, Pos.y), Size))
+				{
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+					Hits++;
+				}
+
+				// running straight into a corner
+				if(Hits == 0)
+				{
+					NewPos = Pos;
+					Vel *= -Elasticity;
+				}
+			}
+
+			Pos = NewPos;
+		}
+	}
+
+	*pInoutPos = Pos;
+	*pInoutVel = Vel;
+}
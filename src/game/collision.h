@@ -7,13 +7,34 @@
 
 class CCollision
 {
+	enum
+	{
+		// tiles around the map that repeat the outermost ones
+		BORDER=4,
+	};
+
 	class CTile *m_pTiles;
 	int m_Width;
 	int m_Height;
 	class CLayers *m_pLayers;
 
+	// collision flags in the low byte and spike flags in the high byte
+	unsigned short *m_pFlags;
+	int m_FlagsWidth;
+	int m_FlagsHeight;
+
+	int FlagsColumn(int x) const;
+	int FlagsRow(int y) const;
+	int GetFlags(int x, int y) const { return m_pFlags[FlagsRow(y)*m_FlagsWidth+FlagsColumn(x)]; }
+	static int FlagsToTile(int Flags) { return (Flags&0xff) | (Flags>>8)<<COLFLAG_SPIKE_SHIFT; }
+
 	bool IsTile(int x, int y, int Flag=COLFLAG_SOLID) const;
 	int GetTile(int x, int y) const;
+	int GetTileIndex(int x, int y) const;
+	int LineTileIndex(vec2 Pos0, vec2 Pos1, int Step, int End) const;
+	float BorderTime(float Pos, float Vel, float HalfSize, int NumTiles) const;
+
+	int m_MoveBoxMode;
 
 public:
 	enum
@@ -55,7 +76,16 @@ public:
 		TILE_SPIKE_PURPLE = 15,
 	};
 
+	enum
+	{
+		// unit sized sub-steps, the behaviour all maps are made for
+		MOVEBOX_STEPPED=0,
+		// moves from tile border to tile border
+		MOVEBOX_SWEPT,
+	};
+
 	CCollision();
+	~CCollision();
 	void Init(class CLayers *pLayers);
 	bool CheckPoint(float x, float y, int Flag=COLFLAG_SOLID) const { return IsTile(round_to_int(x), round_to_int(y), Flag); }
 	bool CheckPoint(vec2 Pos, int Flag=COLFLAG_SOLID) const { return CheckPoint(Pos.x, Pos.y, Flag); }
@@ -65,7 +95,13 @@ public:
 	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const;
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces) const;
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath=0) const;
+	void MoveBoxStepped(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath=0) const;
+	void MoveBoxSwept(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath=0) const;
+	void SetMoveBoxMode(int Mode) { m_MoveBoxMode = Mode; }
+	int MoveBoxMode() const { return m_MoveBoxMode; }
 	bool TestBox(vec2 Pos, vec2 Size, int Flag=COLFLAG_SOLID) const;
+	// all flags of the tiles touched by the box, like GetCollisionAt
+	int GetCollisionBox(vec2 Pos, vec2 Size) const;
 };
 
 #endif
@@ -55,10 +55,33 @@ float VelocityRamp(float Value, float Start, float Range, float Curvature)
 	return 1.0f/powf(Curvature, (Value-Start)/Range);
 }
 
+void CWorldCore::SetCharacter(int ClientID, CCharacterCore *pCore)
+{
+	if(m_apCharacters[ClientID])
+		m_apCharacters[ClientID]->m_WorldID = -1;
+	m_apCharacters[ClientID] = pCore;
+	if(pCore)
+	{
+		pCore->m_WorldID = ClientID;
+		pCore->SyncPos();
+	}
+}
+
 void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision)
 {
 	m_pWorld = pWorld;
 	m_pCollision = pCollision;
+	m_WorldID = -1;
+}
+
+// copies the position to the world, copies of a core stay out of it
+void CCharacterCore::SyncPos()
+{
+	if(m_pWorld && m_WorldID != -1 && m_pWorld->m_apCharacters[m_WorldID] == this)
+	{
+		m_pWorld->m_aPosX[m_WorldID] = m_Pos.x;
+		m_pWorld->m_aPosY[m_WorldID] = m_Pos.y;
+	}
 }
 
 void CCharacterCore::Reset()
@@ -75,6 +98,7 @@ void CCharacterCore::Reset()
 	m_Death = false;
 
 	mem_zero(&m_CoreStats, sizeof(m_CoreStats));
+	SyncPos();
 }
 
 void CCharacterCore::Tick(bool UseInput)
@@ -210,15 +234,16 @@ void CCharacterCore::Tick(bool UseInput)
 				if(!pCharCore || pCharCore == this)
 					continue;
 
-				vec2 ClosestPoint = closest_point_on_line(m_HookPos, NewPos, pCharCore->m_Pos);
-				if(distance(pCharCore->m_Pos, ClosestPoint) < PhysSize+2.0f)
+				vec2 CharPos = m_pWorld->CharacterPos(i);
+				vec2 ClosestPoint = closest_point_on_line(m_HookPos, NewPos, CharPos);
+				if(distance(CharPos, ClosestPoint) < PhysSize+2.0f)
 				{
-					if (m_HookedPlayer == -1 || distance(m_HookPos, pCharCore->m_Pos) < Distance)
+					if (m_HookedPlayer == -1 || distance(m_HookPos, CharPos) < Distance)
 					{
 						m_TriggeredEvents |= COREEVENTFLAG_HOOK_ATTACH_PLAYER;
 						m_HookState = HOOK_GRABBED;
 						m_HookedPlayer = i;
-						Distance = distance(m_HookPos, pCharCore->m_Pos);
+						Distance = distance(m_HookPos, CharPos);
 					}
 				}
 			}
@@ -246,9 +271,8 @@ void CCharacterCore::Tick(bool UseInput)
 	{
 		if(m_HookedPlayer != -1)
 		{
-			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[m_HookedPlayer];
-			if(pCharCore)
-				m_HookPos = pCharCore->m_Pos;
+			if(m_pWorld->m_apCharacters[m_HookedPlayer])
+				m_HookPos = m_pWorld->CharacterPos(m_HookedPlayer);
 			else
 			{
 				// release hook
@@ -309,8 +333,9 @@ void CCharacterCore::Tick(bool UseInput)
 				continue; // make sure that we don't nudge our self
 
 			// handle player <-> player collision
-			float Distance = distance(m_Pos, pCharCore->m_Pos);
-			vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
+			vec2 CharPos = m_pWorld->CharacterPos(i);
+			float Distance = distance(m_Pos, CharPos);
+			vec2 Dir = normalize(m_Pos - CharPos);
 			if(m_pWorld->m_Tuning.m_PlayerCollision && Distance < PhysSize*1.25f && Distance > 0.0f)
 			{
 				float a = (PhysSize*1.45f - Distance);
@@ -381,20 +406,38 @@ void CCharacterCore::Move()
 
 	if(m_pWorld->m_Tuning.m_PlayerCollision)
 	{
+		// only players inside the box swept by the move can be touched, the steps
+		// below test just those. the margin covers the rounding of the steps
+		float Reach = PhysSize+1.0f;
+		float MinX = min(m_Pos.x, NewPos.x)-Reach;
+		float MaxX = max(m_Pos.x, NewPos.x)+Reach;
+		float MinY = min(m_Pos.y, NewPos.y)-Reach;
+		float MaxY = max(m_Pos.y, NewPos.y)+Reach;
+		int aCandidates[MAX_CLIENTS];
+		int NumCandidates = 0;
+		for(int p = 0; p < MAX_CLIENTS; p++)
+		{
+			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
+			if(!pCharCore || pCharCore == this)
+				continue;
+			float x = m_pWorld->m_aPosX[p];
+			float y = m_pWorld->m_aPosY[p];
+			if(x > MinX && x < MaxX && y > MinY && y < MaxY)
+				aCandidates[NumCandidates++] = p;
+		}
+
 		// check player collision
 		float Distance = distance(m_Pos, NewPos);
-		int End = Distance+1;
+		int End = NumCandidates ? Distance+1 : 0;
 		vec2 LastPos = m_Pos;
 		for(int i = 0; i < End; i++)
 		{
 			float a = i/Distance;
 			vec2 Pos = mix(m_Pos, NewPos, a);
-			for(int p = 0; p < MAX_CLIENTS; p++)
+			for(int c = 0; c < NumCandidates; c++)
 			{
-				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-				if(!pCharCore || pCharCore == this)
-					continue;
-				float D = distance(Pos, pCharCore->m_Pos);
+				vec2 CharPos = m_pWorld->CharacterPos(aCandidates[c]);
+				float D = distance(Pos, CharPos);
 				if(D < PhysSize && D >= 0.0f)
 				{
 					if(a > 0.0f)
@@ -402,11 +445,12 @@ void CCharacterCore::Move()
 						m_CoreStats.m_NumTilesMoved += distance(m_Pos, LastPos);
 						m_Pos = LastPos;
 					}
-					else if(distance(NewPos, pCharCore->m_Pos) > D)
+					else if(distance(NewPos, CharPos) > D)
 					{
 						m_CoreStats.m_NumTilesMoved += distance(m_Pos, NewPos);
 						m_Pos = NewPos;
 					}
+					SyncPos();
 					return;
 				}
 			}
@@ -416,6 +460,7 @@ void CCharacterCore::Move()
 
 	m_CoreStats.m_NumTilesMoved += distance(m_Pos, NewPos);
 	m_Pos = NewPos;
+	SyncPos();
 }
 
 void CCharacterCore::Write(CNetObj_CharacterCore *pObjCore)
@@ -453,6 +498,7 @@ void CCharacterCore::Read(const CNetObj_CharacterCore *pObjCore)
 	m_Jumped = pObjCore->m_Jumped;
 	m_Direction = pObjCore->m_Direction;
 	m_Angle = pObjCore->m_Angle;
+	SyncPos();
 }
 
 void CCharacterCore::Quantize()
@@ -136,17 +136,35 @@ public:
 	CWorldCore()
 	{
 		mem_zero(m_apCharacters, sizeof(m_apCharacters));
+		mem_zero(m_aPosX, sizeof(m_aPosX));
+		mem_zero(m_aPosY, sizeof(m_aPosY));
 	}
 
+	// adds the core to the world or removes the character when pCore is 0
+	void SetCharacter(int ClientID, class CCharacterCore *pCore);
+	vec2 CharacterPos(int ClientID) const { return vec2(m_aPosX[ClientID], m_aPosY[ClientID]); }
+
 	CTuningParams m_Tuning;
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
+
+	// positions of all characters side by side, the cores keep them up to date so
+	// the loops over all players don't have to visit every core
+	float m_aPosX[MAX_CLIENTS];
+	float m_aPosY[MAX_CLIENTS];
 };
 
 class CCharacterCore
 {
+	friend class CWorldCore;
+
 	CWorldCore *m_pWorld;
 	CCollision *m_pCollision;
+	int m_WorldID;
+
+	void SyncPos();
 public:
+	CCharacterCore() : m_pWorld(0), m_pCollision(0), m_WorldID(-1) {}
+
 	vec2 m_Pos;
 	vec2 m_Vel;
 
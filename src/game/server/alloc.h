@@ -6,6 +6,7 @@
 #include <new>
 
 #include <base/system.h>
+#include <engine/shared/slabpool.h>
 
 #define MACRO_ALLOC_HEAP() \
 	public: \
@@ -59,4 +60,25 @@
 		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
 	}
 
+#define MACRO_ALLOC_SLAB() \
+	public: \
+	void *operator new(size_t Size); \
+	void operator delete(void *p); \
+	private:
+
+#define MACRO_ALLOC_SLAB_IMPL(POOLTYPE, SlabSize) \
+	static CSlabPool ms_SlabPool##POOLTYPE(#POOLTYPE, sizeof(POOLTYPE), SlabSize); \
+	void *POOLTYPE::operator new(size_t Size) \
+	{ \
+		dbg_assert(sizeof(POOLTYPE) == Size, "size error"); \
+		void *p = ms_SlabPool##POOLTYPE.Allocate(); \
+		dbg_assert(p != 0, "out of memory"); \
+		mem_zero(p, Size); \
+		return p; \
+	} \
+	void POOLTYPE::operator delete(void *p) \
+	{ \
+		ms_SlabPool##POOLTYPE.Free(p); \
+	}
+
 #endif
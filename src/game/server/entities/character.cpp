@@ -3,6 +3,7 @@
 #include <engine/shared/config.h>
 
 #include <generated/server_data.h>
+#include <game/checksum.h>
 #include <game/server/gamecontext.h>
 #include <game/server/gamecontroller.h>
 #include <game/server/player.h>
@@ -13,6 +14,9 @@
 
 #include "../fng2define.h"
 
+// empty world for the dead reckoning cores, they must not see other players
+static CWorldCore s_ReckoningWorld;
+
 //input count
 struct CInputCount
 {
@@ -81,11 +85,13 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 	m_Core.Reset();
 	m_Core.Init(&GameWorld()->m_Core, GameServer()->Collision());
 	m_Core.m_Pos = m_Pos;
-	GameWorld()->m_Core.m_apCharacters[m_pPlayer->GetCID()] = &m_Core;
+	GameWorld()->m_Core.SetCharacter(m_pPlayer->GetCID(), &m_Core);
 
 	m_ReckoningTick = 0;
 	mem_zero(&m_SendCore, sizeof(m_SendCore));
 	mem_zero(&m_ReckoningCore, sizeof(m_ReckoningCore));
+	mem_zero(&m_ReckoningObj, sizeof(m_ReckoningObj));
+	m_ReckoningResting = false;
 
 	GameWorld()->InsertEntity(this);
 	m_Alive = true;
@@ -110,7 +116,7 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 
 void CCharacter::Destroy()
 {
-	GameWorld()->m_Core.m_apCharacters[m_pPlayer->GetCID()] = 0;
+	GameWorld()->m_Core.SetCharacter(m_pPlayer->GetCID(), 0);
 	m_Alive = false;
 }
 
@@ -560,11 +566,9 @@ void CCharacter::Tick()
 	}
 
 
-	int TileFlag = 0;
-	if ((TileFlag |= GameServer()->Collision()->GetCollisionAt(m_Pos.x + GetProximityRadius() / 3.f, m_Pos.y - GetProximityRadius() / 3.f))& (CCollision::COLFLAG_SPIKE_NORMAL | CCollision::COLFLAG_SPIKE_RED | CCollision::COLFLAG_SPIKE_BLUE | CCollision::COLFLAG_SPIKE_GOLD | CCollision::COLFLAG_SPIKE_GREEN | CCollision::COLFLAG_SPIKE_PURPLE) ||
-		(TileFlag |= GameServer()->Collision()->GetCollisionAt(m_Pos.x + GetProximityRadius() / 3.f, m_Pos.y + GetProximityRadius() / 3.f))& (CCollision::COLFLAG_SPIKE_NORMAL | CCollision::COLFLAG_SPIKE_RED | CCollision::COLFLAG_SPIKE_BLUE | CCollision::COLFLAG_SPIKE_GOLD | CCollision::COLFLAG_SPIKE_GREEN | CCollision::COLFLAG_SPIKE_PURPLE) ||
-		(TileFlag |= GameServer()->Collision()->GetCollisionAt(m_Pos.x - GetProximityRadius() / 3.f, m_Pos.y - GetProximityRadius() / 3.f))& (CCollision::COLFLAG_SPIKE_NORMAL | CCollision::COLFLAG_SPIKE_RED | CCollision::COLFLAG_SPIKE_BLUE | CCollision::COLFLAG_SPIKE_GOLD | CCollision::COLFLAG_SPIKE_GREEN | CCollision::COLFLAG_SPIKE_PURPLE) ||
-		(TileFlag |= GameServer()->Collision()->GetCollisionAt(m_Pos.x - GetProximityRadius() / 3.f, m_Pos.y + GetProximityRadius() / 3.f))& (CCollision::COLFLAG_SPIKE_NORMAL | CCollision::COLFLAG_SPIKE_RED | CCollision::COLFLAG_SPIKE_BLUE | CCollision::COLFLAG_SPIKE_GOLD | CCollision::COLFLAG_SPIKE_GREEN | CCollision::COLFLAG_SPIKE_PURPLE))
+	float SpikeSize = GetProximityRadius()/3.f*2.f;
+	int TileFlag = GameServer()->Collision()->GetCollisionBox(m_Pos, vec2(SpikeSize, SpikeSize));
+	if(TileFlag&(CCollision::COLFLAG_SPIKE_NORMAL | CCollision::COLFLAG_SPIKE_RED | CCollision::COLFLAG_SPIKE_BLUE | CCollision::COLFLAG_SPIKE_GOLD | CCollision::COLFLAG_SPIKE_GREEN | CCollision::COLFLAG_SPIKE_PURPLE))
 	{
 		DieSpikes(m_Killer.m_KillerID, TileFlag);
 	}
@@ -616,13 +620,23 @@ void CCharacter::Tick()
 
 void CCharacter::TickDefered()
 {
-	// advance the dummy
+	// advance the dummy. it runs without input and other players, so its next
+	// state only depends on the quantized one. once a tick leaves it unchanged
+	// it stays like that until it gets reset
+	GameWorld()->m_NumReckoningChecks++;
+	if(!m_ReckoningResting)
 	{
-		CWorldCore TempWorld;
-		m_ReckoningCore.Init(&TempWorld, GameServer()->Collision());
+		m_ReckoningCore.Init(&s_ReckoningWorld, GameServer()->Collision());
 		m_ReckoningCore.Tick(false);
 		m_ReckoningCore.Move();
 		m_ReckoningCore.Quantize();
+		GameWorld()->m_NumReckoningSimulations++;
+
+		CNetObj_CharacterCore Predicted;
+		mem_zero(&Predicted, sizeof(Predicted));
+		m_ReckoningCore.Write(&Predicted);
+		m_ReckoningResting = mem_comp(&Predicted, &m_ReckoningObj, sizeof(Predicted)) == 0;
+		m_ReckoningObj = Predicted;
 	}
 
 	//lastsentcore
@@ -635,7 +649,7 @@ void CCharacter::TickDefered()
 	bool StuckAfterMove = GameServer()->Collision()->TestBox(m_Core.m_Pos, vec2(28.0f, 28.0f));
 	m_Core.Quantize();
 	bool StuckAfterQuant = GameServer()->Collision()->TestBox(m_Core.m_Pos, vec2(28.0f, 28.0f));
-	m_Pos = m_Core.m_Pos;
+	SetPos(m_Core.m_Pos);
 
 	if(!StuckBefore && (StuckAfterMove || StuckAfterQuant))
 	{
@@ -667,8 +681,7 @@ void CCharacter::TickDefered()
 
 	if(m_pPlayer->GetTeam() == TEAM_SPECTATORS)
 	{
-		m_Pos.x = m_Input.m_TargetX;
-		m_Pos.y = m_Input.m_TargetY;
+		SetPos(vec2(m_Input.m_TargetX, m_Input.m_TargetY));
 	}
 	else if(m_Core.m_Death)
 	{
@@ -678,19 +691,19 @@ void CCharacter::TickDefered()
 
 	// update the m_SendCore if needed
 	{
-		CNetObj_Character Predicted;
-		CNetObj_Character Current;
-		mem_zero(&Predicted, sizeof(Predicted));
+		CNetObj_CharacterCore Current;
 		mem_zero(&Current, sizeof(Current));
-		m_ReckoningCore.Write(&Predicted);
 		m_Core.Write(&Current);
 
 		// only allow dead reackoning for a top of 3 seconds
-		if(m_ReckoningTick+Server()->TickSpeed()*3 < Server()->Tick() || mem_comp(&Predicted, &Current, sizeof(CNetObj_Character)) != 0)
+		if(m_ReckoningTick+Server()->TickSpeed()*3 < Server()->Tick() || mem_comp(&m_ReckoningObj, &Current, sizeof(Current)) != 0)
 		{
 			m_ReckoningTick = Server()->Tick();
 			m_SendCore = m_Core;
 			m_ReckoningCore = m_Core;
+			m_ReckoningObj = Current;
+			m_ReckoningResting = false;
+			GameWorld()->m_NumReckoningResends++;
 		}
 	}
 
@@ -788,7 +801,7 @@ void CCharacter::Die(int Killer, int Weapon)
 	m_pPlayer->m_DieTick = Server()->Tick();
 
 	GameWorld()->RemoveEntity(this);
-	GameWorld()->m_Core.m_apCharacters[m_pPlayer->GetCID()] = 0;
+	GameWorld()->m_Core.SetCharacter(m_pPlayer->GetCID(), 0);
 	GameServer()->CreateDeath(m_Pos, m_pPlayer->GetCID());
 }
 
@@ -1015,8 +1028,7 @@ void CCharacter::TakeHammerHit(CCharacter* pFrom)
 
 void CCharacter::Snap(int SnappingClient)
 {
-	float Distance = INFINITY;
-	if(NetworkClipped(SnappingClient, Distance))
+	if(NetworkClipped(SnappingClient))
 		return;
 
 	CNetObj_Character *pCharacter = static_cast<CNetObj_Character *>(Server()->SnapNewItem(NETOBJTYPE_CHARACTER, m_pPlayer->GetCID(), sizeof(CNetObj_Character)));
@@ -1081,29 +1093,24 @@ void CCharacter::Snap(int SnappingClient)
 	}
 }
 
-int CCharacter::NetworkClipped(int SnappingClient, float& Distance)
-{
-	return NetworkClipped(SnappingClient, Distance, m_Pos);
-}
-
-int CCharacter::NetworkClipped(int SnappingClient, float& Distance, vec2 CheckPos)
+void CCharacter::PostSnap()
 {
-	if (SnappingClient == -1)
-		return 0;
-
-	float dx = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.x - CheckPos.x;
-	float dy = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.y - CheckPos.y;
-
-	if (absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-		return 1;
-	
-	Distance = distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos);
-	if (distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
-		return 1;
-	return 0;
+	m_TriggeredEvents = 0;
 }
 
-void CCharacter::PostSnap()
+void CCharacter::AddChecksum(CChecksum *pChecksum)
 {
-	m_TriggeredEvents = 0;
+	CEntity::AddChecksum(pChecksum);
+
+	CNetObj_CharacterCore Core;
+	mem_zero(&Core, sizeof(Core));
+	m_Core.Write(&Core);
+	pChecksum->AddInts((const int *)&Core, sizeof(Core)/sizeof(int));
+
+	pChecksum->AddInt(m_Health);
+	pChecksum->AddInt(m_Armor);
+	pChecksum->AddInt(m_ActiveWeapon);
+	for(int i = 0; i < NUM_WEAPONS; i++)
+		pChecksum->AddInt(m_aWeapons[i].m_Got ? m_aWeapons[i].m_Ammo : -2);
+	pChecksum->AddInt(IsFrozen());
 }
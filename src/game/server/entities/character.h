@@ -31,6 +31,7 @@ public:
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
 	virtual void PostSnap();
+	virtual void AddChecksum(class CChecksum *pChecksum);
 
 	bool IsGrounded();
 
@@ -76,9 +77,6 @@ public:
 	void SetKiller(int pKillerID, unsigned int pHookTicks);
 
 private:
-	int NetworkClipped(int SnappingClient, float& Distance);
-	int NetworkClipped(int SnappingClient, float& Distance, vec2 CheckPos);
-
 	// player controlling this character
 	class CPlayer *m_pPlayer;
 
@@ -147,6 +145,8 @@ private:
 	int m_ReckoningTick; // tick that we are performing dead reckoning From
 	CCharacterCore m_SendCore; // core that we should send
 	CCharacterCore m_ReckoningCore; // the dead reckoning core
+	CNetObj_CharacterCore m_ReckoningObj; // the dead reckoning core as it was last written
+	bool m_ReckoningResting; // advancing the dead reckoning core doesn't change it anymore
 
 };
 
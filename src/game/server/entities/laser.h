@@ -7,6 +7,8 @@
 
 class CLaser : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CLaser(CGameWorld *pGameWorld, vec2 Pos, vec2 Direction, float StartEnergy, int Owner);
 
@@ -7,6 +7,8 @@
 #include "character.h"
 #include "pickup.h"
 
+MACRO_ALLOC_SLAB_IMPL(CPickup, 32)
+
 CPickup::CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_PICKUP, Pos, PickupPhysSize)
 {
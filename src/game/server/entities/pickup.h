@@ -9,6 +9,8 @@ const int PickupPhysSize = 14;
 
 class CPickup : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos);
 
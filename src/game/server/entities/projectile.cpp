@@ -6,6 +6,8 @@
 #include "character.h"
 #include "projectile.h"
 
+MACRO_ALLOC_SLAB_IMPL(CProjectile, 128)
+
 CProjectile::CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE, Pos)
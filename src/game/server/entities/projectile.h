@@ -11,6 +11,8 @@ enum
 
 class CProjectile : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon);
@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <game/checksum.h>
+
 #include "entity.h"
 #include "gamecontext.h"
 #include "player.h"
@@ -19,6 +21,9 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRad
 
 	m_MarkedForDestroy = false;
 	m_Pos = Pos;
+
+	m_VisibleMask = 0;
+	m_VisibilityStamp = 0;
 }
 
 CEntity::~CEntity()
@@ -27,8 +32,21 @@ CEntity::~CEntity()
 	Server()->SnapFreeID(m_ID);
 }
 
+void CEntity::AddChecksum(CChecksum *pChecksum)
+{
+	pChecksum->AddInt(m_ObjType);
+	pChecksum->AddFloat(m_Pos.x);
+	pChecksum->AddFloat(m_Pos.y);
+}
+
 int CEntity::NetworkClipped(int SnappingClient)
 {
+	if(SnappingClient == -1)
+		return 0;
+
+	// entities created after the visibility pass are checked directly
+	if(m_VisibilityStamp == GameWorld()->SnapStamp())
+		return !CmaskIsSet(m_VisibleMask, SnappingClient);
 	return NetworkClipped(SnappingClient, m_Pos);
 }
 
@@ -37,15 +55,7 @@ int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos)
 	if(SnappingClient == -1)
 		return 0;
 
-	float dx = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.x-CheckPos.x;
-	float dy = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.y-CheckPos.y;
-
-	if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-		return 1;
-
-	if(distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
-		return 1;
-	return 0;
+	return !CGameWorld::InView(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos);
 }
 
 bool CEntity::GameLayerClipped(vec2 CheckPos)
@@ -25,6 +25,7 @@ private:
 
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
+	CSpatialGrid<CEntity>::CNode m_GridNode;
 
 	int m_ID;
 	int m_ObjType;
@@ -38,18 +39,26 @@ private:
 	/* State */
 	bool m_MarkedForDestroy;
 
+	// clients that see the entity, valid while m_VisibilityStamp is the world's snap stamp
+	int64 m_VisibleMask;
+	int m_VisibilityStamp;
+
 protected:
 	/* State */
 
 	/*
 		Variable: m_Pos
-			Contains the current posititon of the entity.
+			Contains the current posititon of the entity. Use SetPos
+			to move an entity that is in the world.
 	*/
 	vec2 m_Pos;
 
 	/* Getters */
 	int GetID() const					{ return m_ID; }
 
+	/* Setters */
+	void SetPos(vec2 Pos)				{ m_Pos = Pos; m_pGameWorld->MoveEntity(this); }
+
 public:
 	/* Constructor */
 	CEntity(CGameWorld *pGameWorld, int Objtype, vec2 Pos, int ProximityRadius=0);
@@ -121,10 +130,18 @@ public:
 
 	virtual void PostSnap() {}
 
+	/*
+		Function: AddChecksum
+			Adds the state of the entity to the checksum of the game
+			state that input recordings are verified with.
+	*/
+	virtual void AddChecksum(class CChecksum *pChecksum);
+
 	/*
 		Function: networkclipped(int snapping_client)
 			Performs a series of test to see if a client can see the
-			entity.
+			entity. Without a position the visibility computed by the
+			world before the snapshot is used.
 
 		Arguments:
 			SnappingClient - ID of the client which snapshot is
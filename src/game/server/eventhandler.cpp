@@ -1,60 +1,209 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <engine/server.h>
+#include <game/clientviews.h>
+#include <generated/protocol.h>
+
 #include "eventhandler.h"
-#include "gamecontext.h"
-#include "player.h"
 
 //////////////////////////////////////////////////
 // Event handler
 //////////////////////////////////////////////////
 CEventHandler::CEventHandler()
 {
-	m_pGameServer = 0;
+	m_pServer = 0;
+	m_paEvents = 0;
+	m_paCells = 0;
+	m_paCellHash = 0;
+	m_CellHashSize = 0;
+	m_pData = 0;
+	m_EventCapacity = 0;
+	m_DataCapacity = 0;
+	m_PeakEvents = 0;
+	m_NumOverflows = 0;
+	Grow(MIN_EVENTS, MIN_EVENTS*64);
 	Clear();
 }
 
-void CEventHandler::SetGameServer(CGameContext *pGameServer)
+CEventHandler::~CEventHandler()
+{
+	mem_free(m_paEvents);
+	mem_free(m_paCells);
+	mem_free(m_paCellHash);
+	mem_free(m_pData);
+}
+
+void CEventHandler::SetServer(IServer *pServer)
+{
+	m_pServer = pServer;
+}
+
+bool CEventHandler::Grow(int NumEvents, int DataSize)
 {
-	m_pGameServer = pGameServer;
+	if(NumEvents > MAX_EVENTS || DataSize > MAX_DATASIZE)
+		return false;
+
+	if(NumEvents > m_EventCapacity)
+	{
+		int Capacity = max(m_EventCapacity*2, NumEvents);
+		Capacity = min(Capacity, (int)MAX_EVENTS);
+		CEvent *paEvents = (CEvent *)mem_alloc(sizeof(CEvent)*Capacity, 1);
+		CCell *paCells = (CCell *)mem_alloc(sizeof(CCell)*Capacity, 1);
+		if(m_paEvents)
+		{
+			mem_copy(paEvents, m_paEvents, sizeof(CEvent)*m_NumEvents);
+			mem_free(m_paEvents);
+			mem_free(m_paCells);
+			mem_free(m_paCellHash);
+		}
+		m_paEvents = paEvents;
+		m_paCells = paCells;
+		m_EventCapacity = Capacity;
+
+		// at most half full
+		m_CellHashSize = 1;
+		while(m_CellHashSize < Capacity*2)
+			m_CellHashSize *= 2;
+		m_paCellHash = (int *)mem_alloc(sizeof(int)*m_CellHashSize, 1);
+	}
+
+	if(DataSize > m_DataCapacity)
+	{
+		int Capacity = max(m_DataCapacity*2, DataSize);
+		Capacity = min(Capacity, (int)MAX_DATASIZE);
+		char *pData = (char *)mem_alloc(Capacity, 1);
+		if(m_pData)
+		{
+			mem_copy(pData, m_pData, m_CurrentOffset);
+			mem_free(m_pData);
+		}
+		m_pData = pData;
+		m_DataCapacity = Capacity;
+	}
+	return true;
 }
 
 void *CEventHandler::Create(int Type, int Size, int64 Mask)
 {
-	if(m_NumEvents == MAX_EVENTS)
-		return 0;
-	if(m_CurrentOffset+Size >= MAX_DATASIZE)
-		return 0;
+	if(m_NumEvents == m_EventCapacity || m_CurrentOffset+Size > m_DataCapacity)
+	{
+		if(!Grow(m_NumEvents+1, m_CurrentOffset+Size))
+		{
+			m_NumOverflows++;
+			return 0;
+		}
+	}
 
-	void *p = &m_aData[m_CurrentOffset];
-	m_aOffsets[m_NumEvents] = m_CurrentOffset;
-	m_aTypes[m_NumEvents] = Type;
-	m_aSizes[m_NumEvents] = Size;
-	m_aClientMasks[m_NumEvents] = Mask;
+	void *p = &m_pData[m_CurrentOffset];
+	CEvent *pEvent = &m_paEvents[m_NumEvents];
+	pEvent->m_Offset = m_CurrentOffset;
+	pEvent->m_Type = Type;
+	pEvent->m_Size = Size;
+	pEvent->m_ClientMask = Mask;
+	pEvent->m_NextInCell = -1;
 	m_CurrentOffset += Size;
 	m_NumEvents++;
+	m_PeakEvents = max(m_PeakEvents, m_NumEvents);
 	return p;
 }
 
 void CEventHandler::Clear()
 {
 	m_NumEvents = 0;
+	m_NumCells = 0;
 	m_CurrentOffset = 0;
 }
 
+int CEventHandler::FindCell(int X, int Y)
+{
+	int Slot = ((unsigned)X*73856093u ^ (unsigned)Y*19349663u)&(m_CellHashSize-1);
+	while(m_paCellHash[Slot])
+	{
+		int c = m_paCellHash[Slot]-1;
+		if(m_paCells[c].m_X == X && m_paCells[c].m_Y == Y)
+			return c;
+		Slot = (Slot+1)&(m_CellHashSize-1);
+	}
+
+	int c = m_NumCells++;
+	m_paCells[c].m_X = X;
+	m_paCells[c].m_Y = Y;
+	m_paCells[c].m_FirstEvent = -1;
+	m_paCellHash[Slot] = c+1;
+	return c;
+}
+
+void CEventHandler::UpdateVisibility(const CClientViews *pViews)
+{
+	// the position is filled in after Create, so the cells are only known now
+	m_NumCells = 0;
+	mem_zero(m_paCellHash, sizeof(int)*m_CellHashSize);
+	for(int i = m_NumEvents-1; i >= 0; i--)
+	{
+		const CNetEvent_Common *pData = (const CNetEvent_Common *)&m_pData[m_paEvents[i].m_Offset];
+		int X = pData->m_X/CELL_SIZE - (pData->m_X < 0);
+		int Y = pData->m_Y/CELL_SIZE - (pData->m_Y < 0);
+
+		int c = FindCell(X, Y);
+		m_paEvents[i].m_NextInCell = m_paCells[c].m_FirstEvent;
+		m_paCells[c].m_FirstEvent = i;
+	}
+
+	for(int c = 0; c < m_NumCells; c++)
+	{
+		CCell *pCell = &m_paCells[c];
+		vec2 Min(pCell->m_X*(float)CELL_SIZE, pCell->m_Y*(float)CELL_SIZE);
+		pCell->m_ClientMask = pViews->ClientsInRange(Min, Min+vec2(CELL_SIZE, CELL_SIZE), 1500.0f);
+
+		for(int i = pCell->m_FirstEvent; i >= 0; i = m_paEvents[i].m_NextInCell)
+		{
+			CEvent *pEvent = &m_paEvents[i];
+			const CNetEvent_Common *pData = (const CNetEvent_Common *)&m_pData[pEvent->m_Offset];
+			pEvent->m_ClientMask &= pViews->ClientsInRange(vec2(pData->m_X, pData->m_Y), 1500.0f, pCell->m_ClientMask);
+		}
+	}
+}
+
+int CEventHandler::VisibleEvents(int SnappingClient, int *pEvents) const
+{
+	if(SnappingClient == -1)
+	{
+		for(int i = 0; i < m_NumEvents; i++)
+			pEvents[i] = i;
+		return m_NumEvents;
+	}
+
+	int Num = 0;
+	const int64 Client = (int64)1<<SnappingClient;
+	for(int c = 0; c < m_NumCells; c++)
+	{
+		if(!(m_paCells[c].m_ClientMask&Client))
+			continue;
+
+		for(int i = m_paCells[c].m_FirstEvent; i >= 0; i = m_paEvents[i].m_NextInCell)
+		{
+			if(m_paEvents[i].m_ClientMask&Client)
+				pEvents[Num++] = i;
+		}
+	}
+	return Num;
+}
+
 void CEventHandler::Snap(int SnappingClient)
 {
-	for(int i = 0; i < m_NumEvents; i++)
+	int aEvents[MAX_EVENTS];
+	int Num = VisibleEvents(SnappingClient, aEvents);
+	for(int k = 0; k < Num; k++)
 	{
-		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
+		const CEvent *pEvent = &m_paEvents[aEvents[k]];
+		void *d = Server()->SnapNewItem(pEvent->m_Type, aEvents[k], pEvent->m_Size);
+		if(!d)
 		{
-			CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
-			{
-				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
-				if(d)
-					mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
-			}
+			m_NumOverflows++;
+			continue;
 		}
+		mem_copy(d, &m_pData[pEvent->m_Offset], pEvent->m_Size);
 	}
 }
@@ -3,30 +3,90 @@
 #ifndef GAME_SERVER_EVENTHANDLER_H
 #define GAME_SERVER_EVENTHANDLER_H
 
-//
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
+/*
+	Class: CEventHandler
+		Events of the current tick. The storage grows when a tick has more
+		events than before, up to the share of a snapshot left over by the
+		players and entities. Before the
+		snapshot the events are grouped by cell, so every client only looks
+		at the cells it is close to.
+*/
 class CEventHandler
 {
-	static const int MAX_EVENTS = 128;
-	static const int MAX_DATASIZE = 128*64;
+public:
+	enum
+	{
+		// every client snaps up to 4 items (player, spectator and demo info, character),
+		// the rest is kept for entities and game data
+		MAX_EVENTS=CSnapshotBuilder::MAX_ITEMS-MAX_CLIENTS*4-256,
+		MAX_DATASIZE=MAX_EVENTS*64,
+		MIN_EVENTS=128,
+		CELL_SIZE=1024,
+	};
+
+private:
+	struct CEvent
+	{
+		int m_Type;
+		int m_Offset;
+		int m_Size;
+		int64 m_ClientMask;
+		int m_NextInCell;
+	};
+
+	struct CCell
+	{
+		int m_X;
+		int m_Y;
+		int m_FirstEvent;
+		// clients close enough to see some of the events in the cell
+		int64 m_ClientMask;
+	};
 
-	int m_aTypes[MAX_EVENTS]; // TODO: remove some of these arrays
-	int m_aOffsets[MAX_EVENTS];
-	int m_aSizes[MAX_EVENTS];
-	int64 m_aClientMasks[MAX_EVENTS];
-	char m_aData[MAX_DATASIZE];
+	CEvent *m_paEvents;
+	CCell *m_paCells;
+	// cell index+1 by cell position with linear probing, 0 is free. m_CellHashSize is a power of two
+	int *m_paCellHash;
+	int m_CellHashSize;
+	char *m_pData;
+	int m_EventCapacity;
+	int m_DataCapacity;
 
-	class CGameContext *m_pGameServer;
+	class IServer *m_pServer;
 
 	int m_CurrentOffset;
 	int m_NumEvents;
+	int m_NumCells;
+
+	int m_PeakEvents;
+	int m_NumOverflows;
+
+	bool Grow(int NumEvents, int DataSize);
+	int FindCell(int X, int Y);
+
 public:
-	CGameContext *GameServer() const { return m_pGameServer; }
-	void SetGameServer(CGameContext *pGameServer);
+	class IServer *Server() const { return m_pServer; }
+	void SetServer(class IServer *pServer);
 
 	CEventHandler();
+	~CEventHandler();
 	void *Create(int Type, int Size, int64 Mask = -1);
 	void Clear();
+	// groups the events by cell and limits them to the clients close enough to see them
+	void UpdateVisibility(const class CClientViews *pViews);
+	// indices of the events the client gets in its snapshot, all of them for -1
+	int VisibleEvents(int SnappingClient, int *pEvents) const;
 	void Snap(int SnappingClient);
+
+	int NumEvents() const { return m_NumEvents; }
+	int PeakEvents() const { return m_PeakEvents; }
+	int Capacity() const { return m_EventCapacity; }
+	// events dropped because the storage or a client's snapshot had no room left
+	int NumOverflows() const { return m_NumOverflows; }
 };
 
 #endif
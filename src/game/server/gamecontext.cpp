@@ -7,6 +7,7 @@
 #include <engine/map.h>
 
 #include <generated/server_data.h>
+#include <game/checksum.h>
 #include <game/collision.h>
 #include <game/gamecore.h>
 #include <game/version.h>
@@ -24,7 +25,6 @@
 #include "laser_text.h"
 
 #include <vector>
-#include <time.h>
 
 #include "gamecontext.h"
 #include "player.h"
@@ -75,7 +75,12 @@ void CGameContext::Construct(int Resetting)
 	m_pVoteOptionFirst = 0;
 	m_pVoteOptionLast = 0;
 	m_NumVoteOptions = 0;
+	m_VoteOptionMsgsValid = false;
+	m_CommandMsgsValid = false;
 	m_LockTeams = 0;
+	m_RoundStatsLine = -1;
+	m_RoundStatsMask = 0;
+	m_VoteTally.Reset();
 
 	if(Resetting==NO_RESET)
 		m_pVoteOptionHeap = new CHeap();
@@ -322,6 +327,16 @@ void CGameContext::SendChatTarget(int To, const char *pText)
 	Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, To);
 }
 
+void CGameContext::SendChatMask(int64 Mask, const char *pText)
+{
+	CNetMsg_Sv_Chat Msg;
+	Msg.m_Mode = CHAT_ALL;
+	Msg.m_ClientID = -1;
+	Msg.m_TargetID = -1;
+	Msg.m_pMessage = pText;
+	Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL, Mask);
+}
+
 void CGameContext::SendChat(int ChatterClientID, int Mode, int To, const char *pText)
 {
 	char aBuf[256];
@@ -351,17 +366,15 @@ void CGameContext::SendChat(int ChatterClientID, int Mode, int To, const char *p
 		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, -1);
 	else if(Mode == CHAT_TEAM)
 	{
-		// pack one for the recording only
-		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_NOSEND, -1);
-
 		To = m_apPlayers[ChatterClientID]->GetTeam();
 
-		// send to the clients
+		int64 Mask = 0;
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
 			if(m_apPlayers[i] && m_apPlayers[i]->GetTeam() == To)
-				Server()->SendPackMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_NORECORD, i);
+				Mask |= CmaskOne(i);
 		}
+		Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL, Mask);
 	}
 	else // Mode == CHAT_WHISPER
 	{
@@ -413,7 +426,7 @@ void CGameContext::SendSettings(int ClientID)
 	Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
-void CGameContext::SendSkinChange(int ClientID, int TargetID)
+void CGameContext::SendSkinChange(int ClientID, int64 TargetMask)
 {
 	CNetMsg_Sv_SkinChange Msg;
 	Msg.m_ClientID = ClientID;
@@ -423,7 +436,7 @@ void CGameContext::SendSkinChange(int ClientID, int TargetID)
 		Msg.m_aUseCustomColors[p] = m_apPlayers[ClientID]->m_TeeInfos.m_aUseCustomColors[p];
 		Msg.m_aSkinPartColors[p] = m_apPlayers[ClientID]->m_TeeInfos.m_aSkinPartColors[p];
 	}
-	Server()->SendPackMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_NORECORD, TargetID);
+	Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL|MSGFLAG_NORECORD, TargetMask);
 }
 
 void CGameContext::SendGameMsg(int GameMsgID, int ClientID)
@@ -468,6 +481,7 @@ void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char
 			m_apPlayers[i]->m_VotePos = 0;
 		}
 	}
+	m_VoteTally.ClearVotes();
 
 	// start vote
 	m_VoteCloseTime = time_get() + time_freq()*VOTE_TIME;
@@ -547,6 +561,11 @@ void CGameContext::AbortVoteOnTeamChange(int ClientID)
 		m_VoteCloseTime = -1;
 }
 
+void CGameContext::UpdateVoterTeam(int ClientID)
+{
+	m_VoteTally.SetSpectator(ClientID, m_apPlayers[ClientID]->GetTeam() == TEAM_SPECTATORS);
+}
+
 
 void CGameContext::CheckPureTuning()
 {
@@ -640,6 +659,9 @@ void CGameContext::OnTick()
 		}
 	}
 
+	TickRoundStats();
+	SyncPlayerLists();
+
 	// update voting
 	if(m_VoteCloseTime)
 	{
@@ -648,44 +670,8 @@ void CGameContext::OnTick()
 			EndVote(VOTE_END_ABORT, false);
 		else
 		{
-			int Total = 0, Yes = 0, No = 0;
-			if(m_VoteUpdate)
-			{
-				// count votes
-				char aaBuf[MAX_CLIENTS][NETADDR_MAXSTRSIZE] = {{0}};
-				for(int i = 0; i < MAX_CLIENTS; i++)
-					if(m_apPlayers[i])
-						Server()->GetClientAddr(i, aaBuf[i], NETADDR_MAXSTRSIZE);
-				bool aVoteChecked[MAX_CLIENTS] = {0};
-				for(int i = 0; i < MAX_CLIENTS; i++)
-				{
-					if(!m_apPlayers[i] || m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS || aVoteChecked[i])	// don't count in votes by spectators
-						continue;
-
-					int ActVote = m_apPlayers[i]->m_Vote;
-					int ActVotePos = m_apPlayers[i]->m_VotePos;
-
-					// check for more players with the same ip (only use the vote of the one who voted first)
-					for(int j = i+1; j < MAX_CLIENTS; ++j)
-					{
-						if(!m_apPlayers[j] || aVoteChecked[j] || str_comp(aaBuf[j], aaBuf[i]))
-							continue;
-
-						aVoteChecked[j] = true;
-						if(m_apPlayers[j]->m_Vote && (!ActVote || ActVotePos > m_apPlayers[j]->m_VotePos))
-						{
-							ActVote = m_apPlayers[j]->m_Vote;
-							ActVotePos = m_apPlayers[j]->m_VotePos;
-						}
-					}
-
-					Total++;
-					if(ActVote > 0)
-						Yes++;
-					else if(ActVote < 0)
-						No++;
-				}
-			}
+			// the votes are counted when they change
+			int Total = m_VoteTally.Total(), Yes = m_VoteTally.Yes(), No = m_VoteTally.No();
 
 			if(m_VoteEnforce == VOTE_ENFORCE_YES || (m_VoteUpdate && Yes >= Total/2+1))
 			{
@@ -763,6 +749,9 @@ void CGameContext::OnClientEnter(int ClientID)
 
 	SendPlayerCommands(ClientID);
 
+	NETADDR Addr;
+	Server()->GetClientAddr(ClientID, &Addr);
+	m_VoteTally.SetAddr(ClientID, &Addr);
 	m_VoteUpdate = true;
 
 	// update client infos (others before local)
@@ -837,6 +826,12 @@ void CGameContext::OnClientConnected(int ClientID, bool Dummy, bool AsSpec)
 
 	m_apPlayers[ClientID] = new(ClientID) CPlayer(this, ClientID, Dummy, AsSpec);
 
+	// not ingame yet, so it shares the empty address with the other connecting players
+	NETADDR Addr;
+	mem_zero(&Addr, sizeof(Addr));
+	UpdateVoterTeam(ClientID);
+	m_VoteTally.SetAddr(ClientID, &Addr);
+
 	if(Dummy)
 		return;
 
@@ -855,6 +850,7 @@ void CGameContext::OnClientTeamChange(int ClientID)
 {
 	if(m_apPlayers[ClientID]->GetTeam() == TEAM_SPECTATORS)
 		AbortVoteOnTeamChange(ClientID);
+	UpdateVoterTeam(ClientID);
 
 	// mark client's projectile has team projectile
 	CProjectile *p = (CProjectile *)m_World.FindFirst(CGameWorld::ENTTYPE_PROJECTILE);
@@ -872,6 +868,7 @@ bool CGameContext::OnClientDrop(int ClientID, const char *pReason, bool Force)
 
 	AbortVoteOnDisconnect(ClientID);
 	m_pController->OnPlayerDisconnect(m_apPlayers[ClientID]);
+	m_RoundStatsMask &= ~CmaskOne(ClientID);
 
 	// update clients on drop
 	if(Server()->ClientIngame(ClientID))
@@ -904,6 +901,7 @@ bool CGameContext::OnClientDrop(int ClientID, const char *pReason, bool Force)
 	delete m_apPlayers[ClientID];
 	m_apPlayers[ClientID] = 0;
 
+	m_VoteTally.Remove(ClientID);
 	m_VoteUpdate = true;
 
 	return true;
@@ -1130,6 +1128,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 				StartVote(aDesc, aCmd, pReason);
 				pPlayer->m_Vote = 1;
 				pPlayer->m_VotePos = m_VotePos = 1;
+				m_VoteTally.SetVote(ClientID, pPlayer->m_Vote, pPlayer->m_VotePos);
 				pPlayer->m_LastVoteCall = Now;
 			}
 		}
@@ -1146,6 +1145,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 
 				pPlayer->m_Vote = pMsg->m_Vote;
 				pPlayer->m_VotePos = ++m_VotePos;
+				m_VoteTally.SetVote(ClientID, pPlayer->m_Vote, pPlayer->m_VotePos);
 				m_VoteUpdate = true;
 			}
 			else if(m_VoteCreator == pPlayer->GetCID())
@@ -1255,13 +1255,15 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 			}
 
 			// update all clients
+			int64 Mask = 0;
 			for(int i = 0; i < MAX_CLIENTS; ++i)
 			{
-				if(!m_apPlayers[i] || (!Server()->ClientIngame(i) && !m_apPlayers[i]->IsDummy()) || Server()->GetClientVersion(i) < MIN_SKINCHANGE_CLIENTVERSION)
+				if(!m_apPlayers[i] || !Server()->ClientIngame(i) || Server()->GetClientVersion(i) < MIN_SKINCHANGE_CLIENTVERSION)
 					continue;
 
-				SendSkinChange(pPlayer->GetCID(), i);
+				Mask |= CmaskOne(i);
 			}
+			SendSkinChange(pPlayer->GetCID(), Mask);
 
 			m_pController->OnPlayerInfoChange(pPlayer);
 		}
@@ -1296,27 +1298,10 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 
 			m_pController->OnPlayerInfoChange(pPlayer);
 
-			// send vote options
+			// send vote options, the list follows over the next ticks
 			CNetMsg_Sv_VoteClearOptions ClearMsg;
 			Server()->SendPackMsg(&ClearMsg, MSGFLAG_VITAL, ClientID);
-
-			CVoteOptionServer *pCurrent = m_pVoteOptionFirst;
-			while(pCurrent)
-			{
-				// count options for actual packet
-				int NumOptions = 0;
-				for(CVoteOptionServer *p = pCurrent; p && NumOptions < MAX_VOTE_OPTION_ADD; p = p->m_pNext, ++NumOptions);
-
-				// pack and send vote list packet
-				CMsgPacker Msg(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
-				Msg.AddInt(NumOptions);
-				while(pCurrent && NumOptions--)
-				{
-					Msg.AddString(pCurrent->m_aDescription, VOTE_DESC_LENGTH);
-					pCurrent = pCurrent->m_pNext;
-				}
-				Server()->SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
-			}
+			pPlayer->m_SendVoteIndex = 0;
 
 			// send tuning parameters to client
 			SendTuningParams(ClientID);
@@ -1333,18 +1318,13 @@ sServerCommand* CGameContext::FindCommand(const char* pCmd)
 {
 	if(!pCmd)
 		return NULL;
-	sServerCommand* pFindCmd = m_FirstServerCommand;
-	while(pFindCmd)
-	{
-		if(str_comp_nocase_whitespace(pFindCmd->m_Cmd, pCmd) == 0)
-			return pFindCmd;
-		pFindCmd = pFindCmd->m_NextCommand;
-	}
-	return NULL;
+	return static_cast<sServerCommand *>(m_ServerCommandHash.Find(pCmd));
 }
 
 void CGameContext::AddServerCommandSorted(sServerCommand* pCmd)
 {
+	m_ServerCommandHash.Add(pCmd->m_Cmd, pCmd);
+
 	if(!m_FirstServerCommand)
 	{
 		m_FirstServerCommand = pCmd;
@@ -1377,25 +1357,99 @@ void CGameContext::AddServerCommandSorted(sServerCommand* pCmd)
 
 void CGameContext::SendPlayerCommands(int ClientID)
 {
-	sServerCommand* pItCmd = m_FirstServerCommand;
-	while(pItCmd)
+	// sent with the vote options
+	m_apPlayers[ClientID]->m_SendCommandIndex = 0;
+}
+
+void CGameContext::OnVoteOptionsChange()
+{
+	m_VoteOptionMsgsValid = false;
+
+	// clients that didn't get the whole list yet start over, the change
+	// was sent to everybody else already
+	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		char aName[128];
-		char aHelpText[128];
-		char aArgsFormat[128];
+		if(!m_apPlayers[i] || m_apPlayers[i]->m_SendVoteIndex < 0)
+			continue;
+		CNetMsg_Sv_VoteClearOptions ClearMsg;
+		Server()->SendPackMsg(&ClearMsg, MSGFLAG_VITAL, i);
+		m_apPlayers[i]->m_SendVoteIndex = 0;
+	}
+}
 
-		str_format(aName, sizeof(aName), "%s", pItCmd->m_Cmd);
-		str_format(aHelpText, sizeof(aHelpText), "%s", pItCmd->m_Desc);
-		str_format(aArgsFormat, sizeof(aArgsFormat), "%s", (pItCmd->m_ArgFormat) ? pItCmd->m_ArgFormat : "");
+void CGameContext::SyncPlayerLists()
+{
+	if(!m_VoteOptionMsgsValid)
+	{
+		m_VoteOptionMsgs.Clear();
+		CVoteOptionServer *pCurrent = m_pVoteOptionFirst;
+		while(pCurrent)
+		{
+			// count options for actual packet
+			int NumOptions = 0;
+			for(CVoteOptionServer *p = pCurrent; p && NumOptions < MAX_VOTE_OPTION_ADD; p = p->m_pNext, ++NumOptions);
+
+			// pack vote list packet
+			CMsgPacker Msg(NETMSGTYPE_SV_VOTEOPTIONLISTADD);
+			Msg.AddInt(NumOptions);
+			while(pCurrent && NumOptions--)
+			{
+				Msg.AddString(pCurrent->m_aDescription, VOTE_DESC_LENGTH);
+				pCurrent = pCurrent->m_pNext;
+			}
+			m_VoteOptionMsgs.Add(&Msg);
+		}
+		m_VoteOptionMsgsValid = true;
+	}
 
-		CNetMsg_Sv_CommandInfo Msg;
-		Msg.m_pName = aName;
-		Msg.m_HelpText = aHelpText;
-		Msg.m_ArgsFormat = aArgsFormat;
+	if(!m_CommandMsgsValid)
+	{
+		m_CommandMsgs.Clear();
+		for(sServerCommand* pItCmd = m_FirstServerCommand; pItCmd; pItCmd = pItCmd->m_NextCommand)
+		{
+			CNetMsg_Sv_CommandInfo Info;
+			Info.m_pName = pItCmd->m_Cmd;
+			Info.m_HelpText = pItCmd->m_Desc;
+			Info.m_ArgsFormat = pItCmd->m_ArgFormat ? pItCmd->m_ArgFormat : "";
+
+			CMsgPacker Msg(Info.MsgID(), false);
+			if(!Info.Pack(&Msg))
+				m_CommandMsgs.Add(&Msg);
+		}
+		m_CommandMsgsValid = true;
+	}
 
-		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, ClientID);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CPlayer *pPlayer = m_apPlayers[i];
+		if(!pPlayer || (pPlayer->m_SendCommandIndex < 0 && pPlayer->m_SendVoteIndex < 0))
+			continue;
 
-		pItCmd = pItCmd->m_NextCommand;
+		int Budget = Server()->ListSyncBudget(i);
+		while(Budget > 0 && pPlayer->m_SendCommandIndex >= 0)
+		{
+			int Index = pPlayer->m_SendCommandIndex;
+			if(Index >= m_CommandMsgs.Num())
+			{
+				pPlayer->m_SendCommandIndex = -1;
+				break;
+			}
+			Server()->SendMsgRaw(m_CommandMsgs.Data(Index), m_CommandMsgs.Size(Index), MSGFLAG_VITAL, i);
+			Budget -= m_CommandMsgs.Size(Index);
+			pPlayer->m_SendCommandIndex++;
+		}
+		while(Budget > 0 && pPlayer->m_SendVoteIndex >= 0)
+		{
+			int Index = pPlayer->m_SendVoteIndex;
+			if(Index >= m_VoteOptionMsgs.Num())
+			{
+				pPlayer->m_SendVoteIndex = -1;
+				break;
+			}
+			Server()->SendMsgRaw(m_VoteOptionMsgs.Data(Index), m_VoteOptionMsgs.Size(Index), MSGFLAG_VITAL, i);
+			Budget -= m_VoteOptionMsgs.Size(Index);
+			pPlayer->m_SendVoteIndex++;
+		}
 	}
 }
 
@@ -1418,6 +1472,7 @@ void CGameContext::AddServerCommand(const char* pCmd, const char* pDesc, const c
 {
 	if(!pCmd)
 		return;
+	m_CommandMsgsValid = false;
 	sServerCommand* pFindCmd = FindCommand(pCmd);
 	if(!pFindCmd)
 	{
@@ -1501,6 +1556,13 @@ void CGameContext::CmdMe(CGameContext* pContext, int pClientID, const char** pAr
 	}
 }
 
+void CGameContext::CmdEffects(CGameContext* pContext, int pClientID, const char** pArgs, int ArgNum)
+{
+	CPlayer* pPlayer = pContext->m_apPlayers[pClientID];
+	pPlayer->m_NoEffects = !pPlayer->m_NoEffects;
+	pContext->SendChatTarget(pClientID, pPlayer->m_NoEffects ? "Laser text popups disabled" : "Laser text popups enabled");
+}
+
 void CGameContext::CmdHelp(CGameContext* pContext, int pClientID, const char** pArgs, int ArgNum)
 {
 	if (ArgNum != 0)
@@ -1603,6 +1665,38 @@ void CGameContext::ConTuneDump(IConsole::IResult *pResult, void *pUserData)
 	}
 }
 
+void CGameContext::ConDumpEntityPools(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	char aBuf[256];
+	for(const CSlabPool *pPool = CSlabPool::First(); pPool; pPool = pPool->Next())
+	{
+		str_format(aBuf, sizeof(aBuf), "%s used=%d peak=%d allocs=%d slabs=%d slotsize=%d", pPool->Name(),
+			pPool->NumUsed(), pPool->PeakUsed(), pPool->NumAllocs(), pPool->NumSlabs(), pPool->SlotSize());
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "entities", aBuf);
+	}
+}
+
+void CGameContext::ConDumpReckoning(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	const CGameWorld *pWorld = &pSelf->m_World;
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "checks=%d simulated=%d resends=%d resend_rate=%.1f%%", pWorld->m_NumReckoningChecks,
+		pWorld->m_NumReckoningSimulations, pWorld->m_NumReckoningResends,
+		pWorld->m_NumReckoningChecks ? pWorld->m_NumReckoningResends*100.0f/pWorld->m_NumReckoningChecks : 0.0f);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "reckoning", aBuf);
+}
+
+void CGameContext::ConDumpEvents(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "capacity=%d peak=%d overflows=%d", pSelf->m_Events.Capacity(),
+		pSelf->m_Events.PeakEvents(), pSelf->m_Events.NumOverflows());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "events", aBuf);
+}
+
 void CGameContext::ConPause(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
@@ -1786,6 +1880,7 @@ void CGameContext::ConAddVote(IConsole::IResult *pResult, void *pUserData)
 	CNetMsg_Sv_VoteOptionAdd OptionMsg;
 	OptionMsg.m_pDescription = pOption->m_aDescription;
 	pSelf->Server()->SendPackMsg(&OptionMsg, MSGFLAG_VITAL, -1);
+	pSelf->OnVoteOptionsChange();
 }
 
 void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
@@ -1851,6 +1946,7 @@ void CGameContext::ConRemoveVote(IConsole::IResult *pResult, void *pUserData)
 	pSelf->m_pVoteOptionFirst = pVoteOptionFirst;
 	pSelf->m_pVoteOptionLast = pVoteOptionLast;
 	pSelf->m_NumVoteOptions = NumVoteOptions;
+	pSelf->OnVoteOptionsChange();
 }
 
 void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
@@ -1864,6 +1960,7 @@ void CGameContext::ConClearVotes(IConsole::IResult *pResult, void *pUserData)
 	pSelf->m_pVoteOptionFirst = 0;
 	pSelf->m_pVoteOptionLast = 0;
 	pSelf->m_NumVoteOptions = 0;
+	pSelf->OnVoteOptionsChange();
 }
 
 void CGameContext::ConVote(IConsole::IResult *pResult, void *pUserData)
@@ -1905,6 +2002,16 @@ void CGameContext::ConchainSettingUpdate(IConsole::IResult *pResult, void *pUser
 	}
 }
 
+void CGameContext::ConchainCollisionUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+	{
+		CGameContext *pSelf = (CGameContext *)pUserData;
+		pSelf->m_Collision.SetMoveBoxMode(g_Config.m_SvSweptCollision ? CCollision::MOVEBOX_SWEPT : CCollision::MOVEBOX_STEPPED);
+	}
+}
+
 void CGameContext::ConchainGameinfoUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	pfnCallback(pResult, pCallbackUserData);
@@ -1924,6 +2031,9 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("tune", "si", CFGFLAG_SERVER, ConTuneParam, this, "Tune variable to value");
 	Console()->Register("tune_reset", "", CFGFLAG_SERVER, ConTuneReset, this, "Reset tuning");
 	Console()->Register("tune_dump", "", CFGFLAG_SERVER, ConTuneDump, this, "Dump tuning");
+	Console()->Register("dump_entity_pools", "", CFGFLAG_SERVER, ConDumpEntityPools, this, "Dump entity allocation counters");
+	Console()->Register("dump_reckoning", "", CFGFLAG_SERVER, ConDumpReckoning, this, "Dump how often the character cores got resent");
+	Console()->Register("dump_events", "", CFGFLAG_SERVER, ConDumpEvents, this, "Dump the event storage and how many events got dropped");
 
 	Console()->Register("pause", "?i", CFGFLAG_SERVER|CFGFLAG_STORE, ConPause, this, "Pause/unpause game");
 	Console()->Register("change_map", "?r", CFGFLAG_SERVER|CFGFLAG_STORE, ConChangeMap, this, "Change map");
@@ -1949,13 +2059,14 @@ void CGameContext::OnInit()
 	m_pServer = Kernel()->RequestInterface<IServer>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 	m_World.SetGameServer(this);
-	m_Events.SetGameServer(this);
+	m_Events.SetServer(Server());
 
 	AddServerCommand("stats", "show the stats of the current game", 0, CmdStats);
 	AddServerCommand("s", "show the stats of the current game", 0, CmdStats);
 	AddServerCommand("help", "show the cmd list or get more information to any command", "<command>", CmdHelp);
 	AddServerCommand("cmdlist", "show the cmd list", 0, CmdHelp);
 	AddServerCommand("me", "sending message to chat", 0, CmdMe);
+	AddServerCommand("effects", "toggle the laser text popups", 0, CmdEffects);
 	if(g_Config.m_SvEmoteWheel || g_Config.m_SvEmotionalTees)
 		AddServerCommand("emote", "enable custom emotes", "<emote type> <time in seconds>", CmdEmote);
 
@@ -1967,6 +2078,7 @@ void CGameContext::OnInit()
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	m_Collision.SetMoveBoxMode(g_Config.m_SvSweptCollision ? CCollision::MOVEBOX_SWEPT : CCollision::MOVEBOX_STEPPED);
 
 	// select gametype
 	if (str_comp(g_Config.m_SvGametype, "fng2") == 0)
@@ -2013,6 +2125,8 @@ void CGameContext::OnInit()
 	Console()->Chain("sv_teambalance_time", ConchainSettingUpdate, this);
 	Console()->Chain("sv_player_slots", ConchainSettingUpdate, this);
 
+	Console()->Chain("sv_swept_collision", ConchainCollisionUpdate, this);
+
 	Console()->Chain("sv_scorelimit", ConchainGameinfoUpdate, this);
 	Console()->Chain("sv_timelimit", ConchainGameinfoUpdate, this);
 	Console()->Chain("sv_matches_per_map", ConchainGameinfoUpdate, this);
@@ -2055,15 +2169,21 @@ void CGameContext::OnSnap(int ClientID)
 
 	m_World.Snap(ClientID);
 	m_pController->Snap(ClientID);
-	m_Events.Snap(ClientID);
 
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
 		if(m_apPlayers[i])
 			m_apPlayers[i]->Snap(ClientID);
 	}
+
+	// last, so a busy tick can't take the room of the player infos
+	m_Events.Snap(ClientID);
+}
+void CGameContext::OnPreSnap()
+{
+	m_World.UpdateVisibility();
+	m_Events.UpdateVisibility(m_World.Views());
 }
-void CGameContext::OnPreSnap() {}
 void CGameContext::OnPostSnap()
 {
 	m_World.PostSnap();
@@ -2085,6 +2205,23 @@ bool CGameContext::IsClientSpectator(int ClientID) const
 	return m_apPlayers[ClientID] && m_apPlayers[ClientID]->GetTeam() == TEAM_SPECTATORS;
 }
 
+unsigned CGameContext::GameStateChecksum()
+{
+	CChecksum Checksum;
+	Checksum.AddInt(Server()->Tick());
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_apPlayers[i])
+			continue;
+		Checksum.AddInt(i);
+		Checksum.AddInt(m_apPlayers[i]->GetTeam());
+		Checksum.AddInt(m_apPlayers[i]->m_Score);
+	}
+	m_World.AddChecksum(&Checksum);
+	m_pController->AddChecksum(&Checksum);
+	return Checksum.Hash();
+}
+
 const char *CGameContext::GameType() const { return m_pController && m_pController->GetGameType() ? m_pController->GetGameType() : ""; }
 const char *CGameContext::Version() const { return g_Config.m_SvEmoteWheel ? GAME_VERSION_PLUS : GAME_VERSION; }
 const char *CGameContext::NetVersion() const { return GAME_NETVERSION; }
@@ -2093,50 +2230,89 @@ const char *CGameContext::NetVersionHashReal() const { return GAME_NETVERSION_HA
 
 void CGameContext::SendRoundStats()
 {
+	// the lines are sent over the next ticks, a burst of them at once floods the clients
+	m_RoundStatsMask = 0;
+	for(int i = 0; i < MAX_CLIENTS; ++i)
+	{
+		if(m_apPlayers[i] && m_apPlayers[i]->GetTeam() != TEAM_SPECTATORS)
+			m_RoundStatsMask |= CmaskOne(i);
+	}
+	m_RoundStatsLine = 0;
+}
+
+void CGameContext::TickRoundStats()
+{
+	if(m_RoundStatsLine < 0)
+		return;
+
 	char aBuff[300];
+	for(int n = 0; n < ROUNDSTATS_LINES_PER_TICK && m_RoundStatsLine < ROUNDSTATS_LINES; n++, m_RoundStatsLine++)
+	{
+		// frame lines are the same for everybody and get packed once
+		const char *pShared = 0;
+		switch(m_RoundStatsLine)
+		{
+		case 0: pShared = "╔═════════ Statistics ═════════"; break;
+		case 3: pShared = "╠══════════ Spikes ══════════"; break;
+		case 6: pShared = "╠═══════════ Misc ══════════"; break;
+		case 8: pShared = "╚══════════════════════════"; break;
+		case 9: pShared = "Press F1 to view stats now!!"; break;
+		}
+		if(pShared)
+		{
+			if(m_RoundStatsMask)
+				SendChatMask(m_RoundStatsMask, pShared);
+			continue;
+		}
+
+		for(int i = 0; i < MAX_CLIENTS; ++i)
+		{
+			CPlayer* p = m_apPlayers[i];
+			if(!p || !CmaskIsSet(m_RoundStatsMask, i))
+				continue;
+
+			switch(m_RoundStatsLine)
+			{
+			case 1:
+				str_format(aBuff, 300, "║Kills(weapon): %d | Hits(By opponent's weapon): %d", p->m_Stats.m_Kills, p->m_Stats.m_Hits);
+				break;
+			case 2:
+				str_format(aBuff, 300, "║K/D: %4.2f | Shots: %d | Kills/Shots: %3.1f%%", (p->m_Stats.m_Hits != 0) ? (float)((float)p->m_Stats.m_Kills / (float)p->m_Stats.m_Hits) : (float)p->m_Stats.m_Kills,
+					p->m_Stats.m_Shots, ((float)p->m_Stats.m_Kills / (float)(p->m_Stats.m_Shots == 0 ? 1: p->m_Stats.m_Shots)) * 100.f);
+				break;
+			case 4:
+				str_format(aBuff, 300, "║Kills(normal/team/golden/false spikes): %d/%d/%d/%d", p->m_Stats.m_GrabsNormal, p->m_Stats.m_GrabsTeam, p->m_Stats.m_GrabsGold, p->m_Stats.m_GrabsFalse);
+				break;
+			case 5:
+				str_format(aBuff, 300, "║Spike deaths(while frozen): %d", p->m_Stats.m_Deaths);
+				break;
+			case 7:
+				str_format(aBuff, 300, "║Teammates hammered/unfrozen: %d / %d", p->m_Stats.m_UnfreezingHammerHits, p->m_Stats.m_Unfreezes);
+				break;
+			}
+			SendChatTarget(i, aBuff);
+		}
+	}
+
+	if(m_RoundStatsLine >= ROUNDSTATS_LINES)
+	{
+		m_RoundStatsLine = -1;
+		SendRoundStatsSummary();
+	}
+}
+
+void CGameContext::SendRoundStatsSummary()
+{
 	float BestKD = 0;
 	float BestAccuracy = 0;
 	int64_t BestKDPlayerIDs(0);
 	int64_t BestAccuarcyPlayerIDs(0);
-	
+
 	for (int i = 0; i < MAX_CLIENTS; ++i)
 	{
 		CPlayer* p = m_apPlayers[i];
 		if (!p || p->GetTeam() == TEAM_SPECTATORS)
 			continue;
-		SendChatTarget(i, "╔═════════ Statistics ═════════");
-		SendChatTarget(i, "║");
-
-		str_format(aBuff, 300, "║Kills(weapon): %d", p->m_Stats.m_Kills);
-		SendChatTarget(i, aBuff);
-		str_format(aBuff, 300, "║Hits(By opponent's weapon): %d", p->m_Stats.m_Hits);
-		SendChatTarget(i, aBuff);
-		SendChatTarget(i, "║");
-		str_format(aBuff, 300, "║Kills/Deaths: %4.2f", (p->m_Stats.m_Hits != 0) ? (float)((float)p->m_Stats.m_Kills / (float)p->m_Stats.m_Hits) : (float)p->m_Stats.m_Kills);
-		SendChatTarget(i, aBuff);		
-		str_format(aBuff, 300, "║Shots | Kills/Shots: %d | %3.1f%%\n", p->m_Stats.m_Shots, ((float)p->m_Stats.m_Kills / (float)(p->m_Stats.m_Shots == 0 ? 1: p->m_Stats.m_Shots)) * 100.f);
-		SendChatTarget(i, aBuff);
-		SendChatTarget(i, "║");
-		SendChatTarget(i, "╠══════════ Spikes ══════════");
-		SendChatTarget(i, "║");
-		str_format(aBuff, 300, "║Kills(normal spikes): %d", p->m_Stats.m_GrabsNormal);
-		SendChatTarget(i, aBuff);
-		str_format(aBuff, 300, "║Kills(team spikes): %d", p->m_Stats.m_GrabsTeam);
-		SendChatTarget(i, aBuff);
-		str_format(aBuff, 300, "║Kills(golden spikes): %d", p->m_Stats.m_GrabsGold);
-		SendChatTarget(i, aBuff);
-		str_format(aBuff, 300, "║Kills(false spikes): %d", p->m_Stats.m_GrabsFalse);
-		SendChatTarget(i, aBuff);
-		str_format(aBuff, 300, "║Spike deaths(while frozen): %d", p->m_Stats.m_Deaths);
-		SendChatTarget(i, aBuff);
-		SendChatTarget(i, "║");
-		SendChatTarget(i, "╠═══════════ Misc ══════════");
-		SendChatTarget(i, "║");
-		str_format(aBuff, 300, "║Teammates hammered/unfrozen: %d / %d", p->m_Stats.m_UnfreezingHammerHits, p->m_Stats.m_Unfreezes);
-		SendChatTarget(i, aBuff);
-		SendChatTarget(i, "║");
-		SendChatTarget(i, "╚══════════════════════════");
-		SendChatTarget(i, "Press F1 to view stats now!!");
 
 		float KDRatio = ((p->m_Stats.m_Hits != 0) ? (float)((float)p->m_Stats.m_Kills / (float)p->m_Stats.m_Hits) : (float)p->m_Stats.m_Kills);
 		if (BestKD < KDRatio)
@@ -2249,7 +2425,6 @@ void CGameContext::SendRoundStats()
 
 void CGameContext::SendRandomTrivia()
 {	
-	srand (time(NULL));
 	int r = rand()%8;
 	
 	bool TriviaSent = false;
@@ -5,12 +5,14 @@
 
 #include <engine/console.h>
 #include <engine/server.h>
+#include <engine/shared/commandhash.h>
 
 #include <game/layers.h>
 #include <game/voting.h>
 
 #include "eventhandler.h"
 #include "gameworld.h"
+#include "votetally.h"
 
 #include <stdint.h>
 
@@ -84,6 +86,9 @@ class CGameContext : public IGameServer
 	static void ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static void ConTuneReset(IConsole::IResult *pResult, void *pUserData);
 	static void ConTuneDump(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpEntityPools(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpReckoning(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpEvents(IConsole::IResult *pResult, void *pUserData);
 	static void ConPause(IConsole::IResult *pResult, void *pUserData);
 	static void ConChangeMap(IConsole::IResult *pResult, void *pUserData);
 	static void ConRestart(IConsole::IResult *pResult, void *pUserData);
@@ -101,6 +106,7 @@ class CGameContext : public IGameServer
 	static void ConVote(IConsole::IResult *pResult, void *pUserData);
 	static void ConchainSpecialMotdupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainSettingUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConchainCollisionUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainGameinfoUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 
 	CGameContext(int Resetting);
@@ -109,6 +115,14 @@ class CGameContext : public IGameServer
 	sServerCommand* FindCommand(const char* pCmd);
 	void AddServerCommandSorted(sServerCommand* pCmd);
 	void SendPlayerCommands(int ClientID);
+
+	// lists every client gets on join, packed once and sent a bit every tick
+	CPackedMsgList m_VoteOptionMsgs;
+	bool m_VoteOptionMsgsValid;
+	CPackedMsgList m_CommandMsgs;
+	bool m_CommandMsgsValid;
+	void OnVoteOptionsChange();
+	void SyncPlayerLists();
 	bool OnPlayerCommand(int ClientID, const char *pCommandName, const char *pCommandArgs);
 
 	bool m_Resetting;
@@ -122,6 +136,7 @@ public:
 	~CGameContext();
 
 	sServerCommand* m_FirstServerCommand;
+	CCommandHash m_ServerCommandHash;
 	void AddServerCommand(const char* pCmd, const char* pDesc, const char* pArgFormat, ServerCommandExecuteFunc pFunc);
 	bool ExecuteServerCommand(int pClientID, const char* pLine);
 	
@@ -129,6 +144,7 @@ public:
 	static void CmdHelp(CGameContext* pContext, int pClientID, const char** pArgs, int ArgNum);
 	static void CmdEmote(CGameContext* pContext, int pClientID, const char** pArgs, int ArgNum);
 	static void CmdMe(CGameContext* pContext, int pClientID, const char** pArgs, int ArgNum);
+	static void CmdEffects(CGameContext* pContext, int pClientID, const char** pArgs, int ArgNum);
 
 	void Clear();
 
@@ -151,6 +167,8 @@ public:
 	void SendVoteStatus(int ClientID, int Total, int Yes, int No);
 	void AbortVoteOnDisconnect(int ClientID);
 	void AbortVoteOnTeamChange(int ClientID);
+	// for team changes that don't go through OnClientTeamChange
+	void UpdateVoterTeam(int ClientID);
 
 	int m_VoteCreator;
 	int m_VoteType;
@@ -195,13 +213,14 @@ public:
 
 	// network
 	void SendChatTarget(int To, const char *pText);
+	void SendChatMask(int64 Mask, const char *pText);
 	void SendChat(int ChatterClientID, int Mode, int To, const char *pText);
 	void SendBroadcast(const char *pText, int ClientID);
 	void SendEmoticon(int ClientID, int Emoticon);
 	void SendWeaponPickup(int ClientID, int Weapon);
 	void SendMotd(int ClientID);
 	void SendSettings(int ClientID);
-	void SendSkinChange(int ClientID, int TargetID);
+	void SendSkinChange(int ClientID, int64 TargetMask);
 
 	void SendGameMsg(int GameMsgID, int ClientID);
 	void SendGameMsg(int GameMsgID, int ParaI1, int ClientID);
@@ -239,6 +258,8 @@ public:
 	virtual bool IsClientPlayer(int ClientID) const;
 	virtual bool IsClientSpectator(int ClientID) const;
 
+	virtual unsigned GameStateChecksum();
+
 	virtual const char *GameType() const;
 	virtual const char *Version() const;
 	virtual const char *NetVersion() const;
@@ -247,6 +268,21 @@ public:
 
 	void SendRoundStats();
 	void SendRandomTrivia();
+
+private:
+	// the round statistics are sent a few lines per tick
+	enum
+	{
+		ROUNDSTATS_LINES=10,
+		ROUNDSTATS_LINES_PER_TICK=2,
+	};
+	int m_RoundStatsLine;
+	int64 m_RoundStatsMask;
+	void TickRoundStats();
+	void SendRoundStatsSummary();
+
+	// the votes are counted when they change
+	CVoteTally m_VoteTally;
 };
 
 inline int64 CmaskAll() { return -1; }
@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <engine/shared/config.h>
 
+#include <game/checksum.h>
 #include <game/mapitems.h>
 
 #include "entities/character.h"
@@ -15,6 +16,7 @@ IGameController::IGameController(CGameContext *pGameServer)
 {
 	m_pGameServer = pGameServer;
 	m_pServer = m_pGameServer->Server();
+	m_SnapStamp = -1;
 
 	// balancing
 	m_aTeamSize[TEAM_RED] = 0;
@@ -50,6 +52,9 @@ IGameController::IGameController(CGameContext *pGameServer)
 	m_aNumSpawnPoints[0] = 0;
 	m_aNumSpawnPoints[1] = 0;
 	m_aNumSpawnPoints[2] = 0;
+	m_SpawnDangerTick = -1;
+	m_NumSpawnDangers = 0;
+	mem_zero(m_aaaSpawnDangerTick, sizeof(m_aaaSpawnDangerTick));
 
 	// commands
 	CommandsManager()->OnInit();
@@ -277,13 +282,13 @@ bool IGameController::OnEntity(int Index, vec2 Pos)
 	switch(Index)
 	{
 	case ENTITY_SPAWN:
-		m_aaSpawnPoints[0][m_aNumSpawnPoints[0]++] = Pos;
+		AddSpawnPoint(0, Pos);
 		break;
 	case ENTITY_SPAWN_RED:
-		m_aaSpawnPoints[1][m_aNumSpawnPoints[1]++] = Pos;
+		AddSpawnPoint(1, Pos);
 		break;
 	case ENTITY_SPAWN_BLUE:
-		m_aaSpawnPoints[2][m_aNumSpawnPoints[2]++] = Pos;
+		AddSpawnPoint(2, Pos);
 		break;
 	case ENTITY_ARMOR_1:
 		Type = PICKUP_ARMOR;
@@ -677,12 +682,17 @@ void IGameController::SwapTeamscore()
 }
 
 // general
-void IGameController::Snap(int SnappingClient)
+void IGameController::AddChecksum(CChecksum *pChecksum) const
 {
-	CNetObj_GameData *pGameData = static_cast<CNetObj_GameData *>(Server()->SnapNewItem(NETOBJTYPE_GAMEDATA, 0, sizeof(CNetObj_GameData)));
-	if(!pGameData)
-		return;
+	pChecksum->AddInt(m_GameState);
+	pChecksum->AddInt(m_GameStateTimer);
+	pChecksum->AddInt(m_GameStartTick);
+	pChecksum->AddInts(m_aTeamscore, NUM_TEAMS);
+}
 
+void IGameController::UpdateSnapData()
+{
+	CNetObj_GameData *pGameData = &m_SnapGameData;
 	pGameData->m_GameStartTick = m_GameStartTick;
 	pGameData->m_GameStateFlags = 0;
 	pGameData->m_GameStateEndTick = 0; // no timer/infinite = 0, on end = GameEndTick, otherwise = GameStateEndTick
@@ -719,14 +729,30 @@ void IGameController::Snap(int SnappingClient)
 	if(m_SuddenDeath)
 		pGameData->m_GameStateFlags |= GAMESTATEFLAG_SUDDENDEATH;
 
+	m_SnapGameDataTeam.m_TeamscoreRed = m_aTeamscore[TEAM_RED];
+	m_SnapGameDataTeam.m_TeamscoreBlue = m_aTeamscore[TEAM_BLUE];
+}
+
+void IGameController::Snap(int SnappingClient)
+{
+	// the game data is the same for every client
+	if(m_SnapStamp != GameServer()->m_World.SnapStamp())
+	{
+		UpdateSnapData();
+		m_SnapStamp = GameServer()->m_World.SnapStamp();
+	}
+
+	CNetObj_GameData *pGameData = static_cast<CNetObj_GameData *>(Server()->SnapNewItem(NETOBJTYPE_GAMEDATA, 0, sizeof(CNetObj_GameData)));
+	if(!pGameData)
+		return;
+	mem_copy(pGameData, &m_SnapGameData, sizeof(CNetObj_GameData));
+
 	if(IsTeamplay())
 	{
 		CNetObj_GameDataTeam *pGameDataTeam = static_cast<CNetObj_GameDataTeam *>(Server()->SnapNewItem(NETOBJTYPE_GAMEDATATEAM, 0, sizeof(CNetObj_GameDataTeam)));
 		if(!pGameDataTeam)
 			return;
-
-		pGameDataTeam->m_TeamscoreRed = m_aTeamscore[TEAM_RED];
-		pGameDataTeam->m_TeamscoreBlue = m_aTeamscore[TEAM_BLUE];
+		mem_copy(pGameDataTeam, &m_SnapGameDataTeam, sizeof(CNetObj_GameDataTeam));
 	}
 
 	// demo recording
@@ -906,14 +932,23 @@ void IGameController::UpdateGameInfo(int ClientID)
 
 	if(ClientID == -1)
 	{
+		// older clients don't know the race flag
+		int64 Mask = 0;
+		int64 MaskNoRace = 0;
 		for(int i = 0; i < MAX_CLIENTS; ++i)
 		{
 			if(!GameServer()->m_apPlayers[i] || !Server()->ClientIngame(i))
 				continue;
 
-			CNetMsg_Sv_GameInfo *pInfoMsg = (Server()->GetClientVersion(i) < CGameContext::MIN_RACE_CLIENTVERSION) ? &GameInfoMsgNoRace : &GameInfoMsg;
-			Server()->SendPackMsg(pInfoMsg, MSGFLAG_VITAL|MSGFLAG_NORECORD, i);
+			if(Server()->GetClientVersion(i) < CGameContext::MIN_RACE_CLIENTVERSION)
+				MaskNoRace |= CmaskOne(i);
+			else
+				Mask |= CmaskOne(i);
 		}
+		if(Mask)
+			Server()->SendPackMsgMask(&GameInfoMsg, MSGFLAG_VITAL|MSGFLAG_NORECORD, Mask);
+		if(MaskNoRace)
+			Server()->SendPackMsgMask(&GameInfoMsgNoRace, MSGFLAG_VITAL|MSGFLAG_NORECORD, MaskNoRace);
 	}
 	else
 	{
@@ -1019,6 +1054,8 @@ bool IGameController::CanSpawn(int Team, vec2 *pOutPos) const
 
 	CSpawnEval Eval;
 	Eval.m_RandomSpawn = IsSurvival();
+	if(!Eval.m_RandomSpawn)
+		UpdateSpawnDangers();
 
 	if(IsTeamplay())
 	{
@@ -1044,22 +1081,90 @@ bool IGameController::CanSpawn(int Team, vec2 *pOutPos) const
 	return Eval.m_Got;
 }
 
-float IGameController::EvaluateSpawnPos(CSpawnEval *pEval, vec2 Pos) const
+static const vec2 s_aSpawnOffsets[5] = { vec2(0.0f, 0.0f), vec2(-32.0f, 0.0f), vec2(0.0f, -32.0f), vec2(32.0f, 0.0f), vec2(0.0f, 32.0f) };	// start, left, up, right, down
+
+static int DangerTeam(int Team)
+{
+	return Team == TEAM_RED || Team == TEAM_BLUE ? Team : 2;
+}
+
+void IGameController::AddSpawnPoint(int Type, vec2 Pos)
 {
-	float Score = 0.0f;
+	if(m_aNumSpawnPoints[Type] >= MAX_SPAWNPOINTS)
+		return;
+
+	// the map doesn't change, so the offsets only have to be checked once
+	int Solid = 0;
+	for(int i = 0; i < NUM_SPAWNOFFSETS; i++)
+		if(GameServer()->Collision()->CheckPoint(Pos+s_aSpawnOffsets[i]))
+			Solid |= 1<<i;
+
+	m_aaSpawnSolid[Type][m_aNumSpawnPoints[Type]] = Solid;
+	m_aaSpawnPoints[Type][m_aNumSpawnPoints[Type]++] = Pos;
+}
+
+void IGameController::UpdateSpawnDangers() const
+{
+	if(m_SpawnDangerTick == Server()->Tick())
+		return;
+
+	m_SpawnDangerTick = Server()->Tick();
+	m_NumSpawnDangers = 0;
 	CCharacter *pC = static_cast<CCharacter *>(GameServer()->m_World.FindFirst(CGameWorld::ENTTYPE_CHARACTER));
-	for(; pC; pC = (CCharacter *)pC->TypeNext())
+	for(; pC && m_NumSpawnDangers < MAX_CLIENTS; pC = (CCharacter *)pC->TypeNext())
 	{
-		// team mates are not as dangerous as enemies
-		float Scoremod = 1.0f;
-		if(pEval->m_FriendlyTeam != -1 && pC->GetPlayer()->GetTeam() == pEval->m_FriendlyTeam)
-			Scoremod = 0.5f;
+		m_aSpawnDangerPos[m_NumSpawnDangers] = pC->GetPos();
+		m_aSpawnDangerTeam[m_NumSpawnDangers] = pC->GetPlayer()->GetTeam();
+		m_NumSpawnDangers++;
+	}
+}
+
+void IGameController::OnSpawnTaken(int Team, vec2 Pos)
+{
+	if(m_SpawnDangerTick != Server()->Tick() || m_NumSpawnDangers >= MAX_CLIENTS)
+		return;
+
+	m_aSpawnDangerPos[m_NumSpawnDangers] = Pos;
+	m_aSpawnDangerTeam[m_NumSpawnDangers] = Team;
+	m_NumSpawnDangers++;
 
-		float d = distance(Pos, pC->GetPos());
-		Score += Scoremod * (d == 0 ? 1000000000.0f : 1.0f/d);
+	// add the new character to the positions already summed up this tick
+	for(int Type = 0; Type < 3; Type++)
+		for(int i = 0; i < m_aNumSpawnPoints[Type]; i++)
+			for(int o = 0; o < NUM_SPAWNOFFSETS; o++)
+			{
+				if(m_aaaSpawnDangerTick[Type][i][o] != m_SpawnDangerTick)
+					continue;
+				float d = distance(m_aaSpawnPoints[Type][i]+s_aSpawnOffsets[o], Pos);
+				float Danger = d == 0 ? 1000000000.0f : 1.0f/d;
+				float *pDanger = m_aaaaSpawnDanger[Type][i][o];
+				for(int t = 0; t < NUM_DANGERTEAMS; t++)
+					pDanger[t] += (t == DangerTeam(Team) ? 0.5f : 1.0f) * Danger;
+			}
+}
+
+float IGameController::EvaluateSpawnPos(CSpawnEval *pEval, int Type, int Index, int Offset) const
+{
+	float *pDanger = m_aaaaSpawnDanger[Type][Index][Offset];
+	if(m_aaaSpawnDangerTick[Type][Index][Offset] != m_SpawnDangerTick)
+	{
+		m_aaaSpawnDangerTick[Type][Index][Offset] = m_SpawnDangerTick;
+		for(int t = 0; t < NUM_DANGERTEAMS; t++)
+			pDanger[t] = 0.0f;
+
+		vec2 Pos = m_aaSpawnPoints[Type][Index]+s_aSpawnOffsets[Offset];
+		for(int c = 0; c < m_NumSpawnDangers; c++)
+		{
+			// team mates are not as dangerous as enemies
+			float d = distance(Pos, m_aSpawnDangerPos[c]);
+			float Danger = d == 0 ? 1000000000.0f : 1.0f/d;
+			int Team = DangerTeam(m_aSpawnDangerTeam[c]);
+			for(int t = 0; t < NUM_DANGERTEAMS; t++)
+				pDanger[t] += (t == Team ? 0.5f : 1.0f) * Danger;
+		}
 	}
 
-	return Score;
+	return pDanger[DangerTeam(pEval->m_FriendlyTeam)];
 }
 
 void IGameController::EvaluateSpawnType(CSpawnEval *pEval, int Type) const
@@ -1070,14 +1175,17 @@ void IGameController::EvaluateSpawnType(CSpawnEval *pEval, int Type) const
 		// check if the position is occupado
 		CCharacter *aEnts[MAX_CLIENTS];
 		int Num = GameServer()->m_World.FindEntities(m_aaSpawnPoints[Type][i], 64, (CEntity**)aEnts, MAX_CLIENTS, CGameWorld::ENTTYPE_CHARACTER);
-		vec2 Positions[5] = { vec2(0.0f, 0.0f), vec2(-32.0f, 0.0f), vec2(0.0f, -32.0f), vec2(32.0f, 0.0f), vec2(0.0f, 32.0f) };	// start, left, up, right, down
 		int Result = -1;
-		for(int Index = 0; Index < 5 && Result == -1; ++Index)
+		for(int Index = 0; Index < NUM_SPAWNOFFSETS && Result == -1; ++Index)
 		{
 			Result = Index;
+			if(Num && m_aaSpawnSolid[Type][i]&(1<<Index))
+			{
+				Result = -1;
+				continue;
+			}
 			for(int c = 0; c < Num; ++c)
-				if(GameServer()->Collision()->CheckPoint(m_aaSpawnPoints[Type][i]+Positions[Index]) ||
-					distance(aEnts[c]->GetPos(), m_aaSpawnPoints[Type][i]+Positions[Index]) <= aEnts[c]->GetProximityRadius())
+				if(distance(aEnts[c]->GetPos(), m_aaSpawnPoints[Type][i]+s_aSpawnOffsets[Index]) <= aEnts[c]->GetProximityRadius())
 				{
 					Result = -1;
 					break;
@@ -1086,8 +1194,8 @@ void IGameController::EvaluateSpawnType(CSpawnEval *pEval, int Type) const
 		if(Result == -1)
 			continue;	// try next spawn point
 
-		vec2 P = m_aaSpawnPoints[Type][i]+Positions[Result];
-		float S = pEval->m_RandomSpawn ? random_int() : EvaluateSpawnPos(pEval, P);
+		vec2 P = m_aaSpawnPoints[Type][i]+s_aSpawnOffsets[Result];
+		float S = pEval->m_RandomSpawn ? random_int() : EvaluateSpawnPos(pEval, Type, i, Result);
 		if(!pEval->m_Got || pEval->m_Score > S)
 		{
 			pEval->m_Got = true;
@@ -1148,7 +1256,6 @@ int IGameController::ClampTeam(int Team) const
 
 void IGameController::ShuffleTeams()
 {
-	srand (time(NULL));
 	int64_t TeamPlayers[2];
 	int64_t TeamPlayersAfterShuffle[2];
 	do
@@ -1298,6 +1405,7 @@ void IGameController::CChatCommands::AddCommand(const char *pName, const char *p
 
 			m_aCommands[i].m_pfnCallback = pfnCallback;
 			m_aCommands[i].m_Used = true;
+			m_Hash.Add(m_aCommands[i].m_aName, &m_aCommands[i]);
 			break;
 		}
 	}
@@ -1317,20 +1425,14 @@ void IGameController::CChatCommands::RemoveCommand(const char *pName)
 
 	if(pCommand)
 	{
+		m_Hash.Remove(pCommand->m_aName, pCommand);
 		mem_zero(pCommand, sizeof(CChatCommand));
 	}
 }
 
 IGameController::CChatCommand *IGameController::CChatCommands::GetCommand(const char *pName)
 {
-	for(int i = 0; i < MAX_COMMANDS; i++)
-	{
-		if(m_aCommands[i].m_Used && str_comp(m_aCommands[i].m_aName, pName) == 0)
-		{
-			return &m_aCommands[i];
-		}
-	}
-	return 0;
+	return static_cast<CChatCommand *>(m_Hash.Find(pName));
 }
 
 void IGameController::CChatCommands::OnPlayerConnect(IServer *pServer, CPlayer *pPlayer)
@@ -6,6 +6,9 @@
 #include <base/vmath.h>
 #include <base/tl/array.h>
 
+#include <engine/shared/commandhash.h>
+#include <engine/shared/protocol.h>
+
 #include <generated/protocol.h>
 
 /*
@@ -83,12 +86,39 @@ class IGameController
 		int m_FriendlyTeam;
 		float m_Score;
 	};
-	vec2 m_aaSpawnPoints[3][64];
+	enum
+	{
+		MAX_SPAWNPOINTS=64,
+		NUM_SPAWNOFFSETS=5,
+		// friendly team red, blue or none
+		NUM_DANGERTEAMS=3,
+	};
+	vec2 m_aaSpawnPoints[3][MAX_SPAWNPOINTS];
 	int m_aNumSpawnPoints[3];
-	
-	float EvaluateSpawnPos(CSpawnEval *pEval, vec2 Pos) const;
+	// offsets that are inside the map, one bit per offset
+	int m_aaSpawnSolid[3][MAX_SPAWNPOINTS];
+
+	void AddSpawnPoint(int Type, vec2 Pos);
+
+	// characters as they were when the first spawn of the tick was evaluated,
+	// the danger of a spawn position is summed up once per tick over them
+	mutable int m_SpawnDangerTick;
+	mutable int m_NumSpawnDangers;
+	mutable vec2 m_aSpawnDangerPos[MAX_CLIENTS];
+	mutable int m_aSpawnDangerTeam[MAX_CLIENTS];
+	mutable int m_aaaSpawnDangerTick[3][MAX_SPAWNPOINTS][NUM_SPAWNOFFSETS];
+	mutable float m_aaaaSpawnDanger[3][MAX_SPAWNPOINTS][NUM_SPAWNOFFSETS][NUM_DANGERTEAMS];
+
+	void UpdateSpawnDangers() const;
+	float EvaluateSpawnPos(CSpawnEval *pEval, int Type, int Index, int Offset) const;
 	void EvaluateSpawnType(CSpawnEval *pEval, int Type) const;
 
+	// game data of the current snapshot, the same for every client
+	CNetObj_GameData m_SnapGameData;
+	CNetObj_GameDataTeam m_SnapGameDataTeam;
+	int m_SnapStamp;
+	void UpdateSnapData();
+
 protected:
 	CGameContext *GameServer() const { return m_pGameServer; }
 	IServer *Server() const { return m_pServer; }
@@ -141,6 +171,7 @@ protected:
 		};
 
 		CChatCommand m_aCommands[MAX_COMMANDS];
+		CCommandHash m_Hash;
 	public:
 		CChatCommands();
 
@@ -230,6 +261,7 @@ public:
 	// general
 	virtual void Snap(int SnappingClient);
 	virtual void Tick();
+	void AddChecksum(class CChecksum *pChecksum) const;
 
 	// info
 	void CheckGameInfo();
@@ -251,6 +283,8 @@ public:
 
 	//spawn
 	bool CanSpawn(int Team, vec2 *pPos) const;
+	// a character spawned after the spawn dangers of the tick were collected
+	void OnSpawnTaken(int Team, vec2 Pos);
 	bool GetStartRespawnState() const;
 
 	// team
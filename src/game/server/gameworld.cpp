@@ -1,11 +1,16 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <engine/shared/config.h>
+
+#include <game/checksum.h>
+
 #include "entities/character.h"
 #include "entity.h"
 #include "gamecontext.h"
 #include "gamecontroller.h"
 #include "gameworld.h"
+#include "player.h"
 
 
 //////////////////////////////////////////////////
@@ -18,8 +23,16 @@ CGameWorld::CGameWorld()
 
 	m_Paused = false;
 	m_ResetRequested = false;
+	m_NumReckoningChecks = 0;
+	m_NumReckoningSimulations = 0;
+	m_NumReckoningResends = 0;
+	m_LaserTextBudget = 0;
+	m_SnapStamp = 0;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
 		m_apFirstEntityTypes[i] = 0;
+		m_aMaxProximityRadius[i] = 0.0f;
+	}
 }
 
 CGameWorld::~CGameWorld()
@@ -46,20 +59,7 @@ int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max,
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
-	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type];	pEnt; pEnt = pEnt->m_pNextTypeEntity)
-	{
-		if(distance(pEnt->m_Pos, Pos) < Radius+pEnt->m_ProximityRadius)
-		{
-			if(ppEnts)
-				ppEnts[Num] = pEnt;
-			Num++;
-			if(Num == Max)
-				break;
-		}
-	}
-
-	return Num;
+	return m_aGrids[Type].Find(Pos, Radius, m_aMaxProximityRadius[Type], ppEnts, Max);
 }
 
 void CGameWorld::InsertEntity(CEntity *pEnt)
@@ -75,6 +75,14 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	m_aGrids[pEnt->m_ObjType].Insert(&pEnt->m_GridNode, pEnt, pEnt->m_Pos);
+	m_aMaxProximityRadius[pEnt->m_ObjType] = max(m_aMaxProximityRadius[pEnt->m_ObjType], pEnt->m_ProximityRadius);
+}
+
+void CGameWorld::MoveEntity(CEntity *pEnt)
+{
+	m_aGrids[pEnt->m_ObjType].Move(&pEnt->m_GridNode, pEnt->m_Pos);
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
@@ -102,11 +110,15 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+
+	m_aGrids[pEnt->m_ObjType].Remove(&pEnt->m_GridNode);
 }
 
 //
 void CGameWorld::Snap(int SnappingClient)
 {
+	m_LaserTextBudget = g_Config.m_SvLaserTextBudget;
+
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 		{
@@ -127,6 +139,33 @@ void CGameWorld::PostSnap()
 		}
 }
 
+void CGameWorld::UpdateVisibility()
+{
+	m_SnapStamp++;
+
+	m_Views.Clear();
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CPlayer *pPlayer = GameServer()->m_apPlayers[i];
+		if(pPlayer)
+			m_Views.Add(i, pPlayer->m_ViewPos);
+	}
+
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		{
+			pEnt->m_VisibleMask = m_Views.ClientsInView(pEnt->m_Pos);
+			pEnt->m_VisibilityStamp = m_SnapStamp;
+		}
+}
+
+void CGameWorld::AddChecksum(CChecksum *pChecksum)
+{
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+			pEnt->AddChecksum(pChecksum);
+}
+
 void CGameWorld::Reset()
 {
 	// reset all entities
@@ -184,6 +223,12 @@ void CGameWorld::Tick()
 				pEnt->TickDefered();
 				pEnt = m_pNextTraverseEntity;
 			}
+
+#ifdef CONF_DEBUG
+		for(int i = 0; i < NUM_ENTTYPES; i++)
+			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+				dbg_assert(m_aGrids[i].IsCurrent(&pEnt->m_GridNode, pEnt->m_Pos), "entity moved without SetPos");
+#endif
 	}
 	else if(GameServer()->m_pController->IsGamePaused())
 	{
@@ -204,56 +249,14 @@ void CGameWorld::Tick()
 // TODO: should be more general
 CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2& NewPos, CEntity *pNotThis)
 {
-	// Find other players
-	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
-	CCharacter *pClosest = 0;
-
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
- 	{
-		if(p == pNotThis)
-			continue;
-
-		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
-		float Len = distance(p->m_Pos, IntersectPos);
-		if(Len < p->m_ProximityRadius+Radius)
-		{
-			Len = distance(Pos0, IntersectPos);
-			if(Len < ClosestLen)
-			{
-				NewPos = IntersectPos;
-				ClosestLen = Len;
-				pClosest = p;
-			}
-		}
-	}
-
-	return pClosest;
+	return (CCharacter *)m_aGrids[ENTTYPE_CHARACTER].Intersect(Pos0, Pos1, Radius, m_aMaxProximityRadius[ENTTYPE_CHARACTER], &NewPos, pNotThis);
 }
 
 
 CEntity *CGameWorld::ClosestEntity(vec2 Pos, float Radius, int Type, CEntity *pNotThis)
 {
-	// Find other players
-	float ClosestRange = Radius*2;
-	CEntity *pClosest = 0;
-
-	CEntity *p = FindFirst(Type);
-	for(; p; p = p->TypeNext())
- 	{
-		if(p == pNotThis)
-			continue;
-
-		float Len = distance(Pos, p->m_Pos);
-		if(Len < p->m_ProximityRadius+Radius)
-		{
-			if(Len < ClosestRange)
-			{
-				ClosestRange = Len;
-				pClosest = p;
-			}
-		}
-	}
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
 
-	return pClosest;
+	return m_aGrids[Type].Closest(Pos, Radius, m_aMaxProximityRadius[Type], pNotThis);
 }
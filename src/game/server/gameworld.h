@@ -3,7 +3,9 @@
 #ifndef GAME_SERVER_GAMEWORLD_H
 #define GAME_SERVER_GAMEWORLD_H
 
+#include <game/clientviews.h>
 #include <game/gamecore.h>
+#include <game/spatialgrid.h>
 
 class CEntity;
 class CCharacter;
@@ -33,9 +35,19 @@ private:
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// entities by position, queries look up the cells around them
+	CSpatialGrid<CEntity> m_aGrids[NUM_ENTTYPES];
+	float m_aMaxProximityRadius[NUM_ENTTYPES];
+
 	class CGameContext *m_pGameServer;
 	class IServer *m_pServer;
 
+	// counts the snapshots, things cached for a snapshot compare against it
+	int m_SnapStamp;
+
+	// view positions of the players for the current snapshot
+	CClientViews m_Views;
+
 public:
 	class CGameContext *GameServer() { return m_pGameServer; }
 	class IServer *Server() { return m_pServer; }
@@ -44,6 +56,14 @@ public:
 	bool m_Paused;
 	CWorldCore m_Core;
 
+	// dead reckoning counters, to see how often the character cores get resent
+	int m_NumReckoningChecks;
+	int m_NumReckoningSimulations;
+	int m_NumReckoningResends;
+
+	// laser text lasers left for the snapshot being built
+	int m_LaserTextBudget;
+
 	CGameWorld();
 	~CGameWorld();
 
@@ -64,7 +84,9 @@ public:
 			type - Type of the entities to find.
 
 		Returns:
-			Number of entities found and added to the ents array.
+			Number of entities found and added to the ents array. They
+			come in the order of the entity list, newest first. With
+			more entities than max, the newest ones are returned.
 	*/
 	int FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type);
 
@@ -80,6 +102,7 @@ public:
 
 		Returns:
 			Returns a pointer to the closest CEntity or NULL if no CEntity is close enough.
+			Of entities at the same distance the one first in the entity list wins.
 	*/
 	CEntity *ClosestEntity(vec2 Pos, float Radius, int Type, CEntity *pNotThis);
 
@@ -96,6 +119,7 @@ public:
 
 		Returns:
 			Returns a pointer to the closest hit or NULL of there is no intersection.
+			Of hits at the same distance the one first in the entity list wins.
 	*/
 	class CCharacter *IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, class CEntity *pNotThis = 0);
 
@@ -117,6 +141,16 @@ public:
 	*/
 	void RemoveEntity(CEntity *pEntity);
 
+	/*
+		Function: move_entity
+			Updates the position of an entity in the spatial index,
+			called by CEntity::SetPos.
+
+		Arguments:
+			entity - Entity that moved
+	*/
+	void MoveEntity(CEntity *pEntity);
+
 	/*
 		Function: destroy_entity
 			Destroys an entity in the world.
@@ -139,6 +173,20 @@ public:
 	
 	void PostSnap();
 
+	/*
+		Function: UpdateVisibility
+			Works out once per snapshot which clients see which
+			entities, snaps then only test a bit per client.
+	*/
+	void UpdateVisibility();
+	int SnapStamp() const { return m_SnapStamp; }
+	const CClientViews *Views() const { return &m_Views; }
+
+	static bool InView(vec2 ViewPos, vec2 Pos) { return CClientViews::InView(ViewPos, Pos); }
+
+	// adds all entities to the checksum of the game state
+	void AddChecksum(class CChecksum *pChecksum);
+
 	/*
 		Function: tick
 			Calls tick on all the entities in the world to progress
@@ -1,9 +1,12 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <engine/shared/config.h>
 #include <game/server/gamecontext.h>
+#include <game/server/player.h>
 #include "laser_text.h"
 #include "gameworld.h"
-#include <string.h>
+
+MACRO_ALLOC_SLAB_IMPL(CLaserText, 16)
 
 static const bool asciiTable[256][5][3] = {
 	{ {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0} }, // ascii 0
@@ -264,79 +267,170 @@ static const bool asciiTable[256][5][3] = {
 	{ {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0} }  // ascii 255
 };
 
-CLaserText::CLaserText(CGameWorld *pGameWorld, vec2 Pos, int Owner, int pAliveTicks, char* pText, int pTextLen)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER, Pos, 0)
+// a stroke is a laser from one point of the glyph to a neighbour
+struct CLaserStroke
 {
-	m_Pos = Pos;
-	m_Owner = Owner;
-	GameWorld()->InsertEntity(this);
-	
-	m_CurTicks = Server()->Tick();
-	m_StartTick = Server()->Tick();
-	m_AliveTicks = pAliveTicks;
-	
-	m_TextLen = pTextLen;
-	m_Text = new char[pTextLen];
-	memcpy(m_Text, pText, pTextLen);	
-	
-	m_CharNum = 0;
-
-	for(int i = 0; i < m_TextLen; ++i){
-		for(int n = 0; n < 5; ++n){
-			for(int j = 0; j < 3; ++j){
-				if(asciiTable[(unsigned char)m_Text[i]][n][j]){
-					++m_CharNum;
+	unsigned char m_X;
+	unsigned char m_Y;
+	unsigned char m_FromX;
+	unsigned char m_FromY;
+};
+
+struct CLaserGlyph
+{
+	int m_NumStrokes;
+	CLaserStroke m_aStrokes[CLaserText::GLYPH_HEIGHT*CLaserText::GLYPH_WIDTH];
+};
+
+static CLaserGlyph s_aGlyphs[256];
+static bool s_GlyphsBuilt = false;
+
+static int NeighboursVert(const bool aCharVert[3], int VertOff)
+{
+	int Neighbours = 0;
+	if(VertOff > 0 && aCharVert[VertOff-1])
+		++Neighbours;
+	if(VertOff < 2 && aCharVert[VertOff+1])
+		++Neighbours;
+	return Neighbours;
+}
+
+static int NeighboursHor(const bool aaCharHor[5][3], int HorOff, int VertOff)
+{
+	int Neighbours = 0;
+	if(HorOff > 0 && aaCharHor[HorOff-1][VertOff])
+		++Neighbours;
+	if(HorOff < 4 && aaCharHor[HorOff+1][VertOff])
+		++Neighbours;
+	return Neighbours;
+}
+
+// every point of the glyph gets a stroke to a neighbour, points that another stroke
+// ends at already are forced to continue it, otherwise the best connected one is taken
+static void BuildGlyph(const bool aaPoints[5][3], CLaserGlyph *pGlyph)
+{
+	unsigned short aaTail[5][3];
+	int aaNeighbourCount[5][3];
+
+	for(int n = 0; n < 5; ++n)
+	{
+		for(int j = 0; j < 3; ++j)
+		{
+			if(aaPoints[n][j])
+			{
+				aaNeighbourCount[n][j] = NeighboursVert(aaPoints[n], j) + NeighboursHor(aaPoints, n, j);
+				aaTail[n][j] = 0;
+			}
+			else
+				aaTail[n][j] = (unsigned short)-1;
+		}
+	}
+
+	static const int s_aaDirs[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+	pGlyph->m_NumStrokes = 0;
+	for(int n = 0; n < 5; ++n)
+	{
+		for(int j = 0; j < 3; ++j)
+		{
+			if(!aaPoints[n][j])
+				continue;
+
+			int x = j, y = n;
+			int MaxNeighbour = 0;
+			bool ForceLine = false;
+
+			for(int d = 0; d < 4 && !ForceLine; d++)
+			{
+				int nx = j+s_aaDirs[d][0];
+				int ny = n+s_aaDirs[d][1];
+				if(nx < 0 || nx > 2 || ny < 0 || ny > 4 || !aaPoints[ny][nx])
+					continue;
+
+				if(aaTail[ny][nx] != 0)
+				{
+					if(aaTail[ny][nx] != (n << 8 | j))
+					{
+						ForceLine = true;
+						aaTail[n][j] = (ny << 8 | nx);
+						x = nx;
+						y = ny;
+					}
+				}
+				else if(aaNeighbourCount[ny][nx] > MaxNeighbour)
+				{
+					MaxNeighbour = aaNeighbourCount[ny][nx];
+					x = nx;
+					y = ny;
 				}
 			}
+
+			if(!ForceLine)
+				aaTail[n][j] = (y << 8 | x);
+
+			CLaserStroke *pStroke = &pGlyph->m_aStrokes[pGlyph->m_NumStrokes++];
+			pStroke->m_X = j;
+			pStroke->m_Y = n;
+			pStroke->m_FromX = x;
+			pStroke->m_FromY = y;
 		}
 	}
-	
-	m_Chars = new CLaserChar*[m_CharNum];
+}
 
+static void BuildGlyphs()
+{
+	if(s_GlyphsBuilt)
+		return;
+	for(int i = 0; i < 256; i++)
+		BuildGlyph(asciiTable[i], &s_aGlyphs[i]);
+	s_GlyphsBuilt = true;
+}
+
+CLaserText::CLaserText(CGameWorld *pGameWorld, vec2 Pos, int Owner, int pAliveTicks, char* pText, int pTextLen)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER, Pos, 0)
+{
 	m_PosOffsetCharPoints = 15.0;
 	m_PosOffsetChars = m_PosOffsetCharPoints * 3.5;
-			
-	int charCount = 0;
-	for(int i = 0; i < m_TextLen; ++i){
-		makeLaser(m_Text[i], i, charCount);
-	}
+	Init(Owner, pAliveTicks, pText, pTextLen);
 }
 
 CLaserText::CLaserText(CGameWorld *pGameWorld, vec2 Pos, int Owner, int pAliveTicks, char* pText, int pTextLen, float pCharPointOffset, float pCharOffsetFactor)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER, Pos)
 {
-	m_Pos = Pos;
+	m_PosOffsetCharPoints = pCharPointOffset;
+	m_PosOffsetChars = m_PosOffsetCharPoints * pCharOffsetFactor;
+	Init(Owner, pAliveTicks, pText, pTextLen);
+}
+
+CLaserText::~CLaserText()
+{
+	for(int i = 0; i < m_NumStrokes; ++i)
+		Server()->SnapFreeID(m_aStrokeIDs[i]);
+}
+
+void CLaserText::Init(int Owner, int AliveTicks, const char *pText, int TextLen)
+{
+	BuildGlyphs();
+
 	m_Owner = Owner;
 	GameWorld()->InsertEntity(this);
-	
+
 	m_CurTicks = Server()->Tick();
 	m_StartTick = Server()->Tick();
-	m_AliveTicks = pAliveTicks;
-	
-	m_TextLen = pTextLen;
-	m_Text = new char[pTextLen];
-	memcpy(m_Text, pText, pTextLen);	
-	
-	m_CharNum = 0;
-
-	for(int i = 0; i < m_TextLen; ++i){
-		for(int n = 0; n < 5; ++n){
-			for(int j = 0; j < 3; ++j){
-				if(asciiTable[(unsigned char)m_Text[i]][n][j]){
-					++m_CharNum;
-				}
-			}
-		}
-	}
-	
-	m_Chars = new CLaserChar*[m_CharNum];
+	m_AliveTicks = AliveTicks;
 
-	m_PosOffsetCharPoints = pCharPointOffset;
-	m_PosOffsetChars = m_PosOffsetCharPoints * pCharOffsetFactor;
-			
-	int charCount = 0;
-	for(int i = 0; i < m_TextLen; ++i){
-		makeLaser(m_Text[i], i, charCount);
+	if(TextLen > MAX_TEXT_LENGTH)
+		TextLen = MAX_TEXT_LENGTH;
+
+	// the strokes only need snap ids, their positions come from the glyph table
+	m_TextLength = TextLen;
+	m_NumStrokes = 0;
+	for(int i = 0; i < TextLen; ++i)
+	{
+		m_aText[i] = pText[i];
+		int NumStrokes = s_aGlyphs[(unsigned char)pText[i]].m_NumStrokes;
+		for(int s = 0; s < NumStrokes; ++s)
+			m_aStrokeIDs[m_NumStrokes++] = Server()->SnapNewID();
 	}
 }
 
@@ -354,150 +448,81 @@ void CLaserText::TickPaused()
 {
 }
 
-inline char NeighboursVert(const bool pCharVert[3], int pVertOff){
-	char neighbours = 0;
-	if(pVertOff > 0){
-		if(pCharVert[pVertOff - 1]) ++neighbours;
-	}
-	if(pVertOff < 2){
-		if(pCharVert[pVertOff + 1]) ++neighbours;
-	}	
-	
-	return neighbours;
-}
+void CLaserText::SnapLine()
+{
+	// the whole text as one laser through its middle
+	CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_aStrokeIDs[0], sizeof(CNetObj_Laser)));
+	if(!pObj)
+		return;
 
-inline char NeighboursHor(const bool pCharHor[5][3], int pHorOff, int pVertOff){
-	char neighbours = 0;
-	if(pHorOff > 0){
-		if(pCharHor[pHorOff - 1][pVertOff]) ++neighbours;
-	}
-	if(pHorOff < 4){
-		if(pCharHor[pHorOff + 1][pVertOff]) ++neighbours;
-	}	
-	
-	return neighbours;
+	float Y = m_Pos.y + (GLYPH_HEIGHT-1) / 2 * m_PosOffsetCharPoints;
+	pObj->m_X = m_Pos.x + (m_TextLength-1) * m_PosOffsetChars + (GLYPH_WIDTH-1) * m_PosOffsetCharPoints;
+	pObj->m_Y = Y;
+	pObj->m_FromX = m_Pos.x;
+	pObj->m_FromY = Y;
+	pObj->m_StartTick = Server()->Tick();
 }
 
-void CLaserText::makeLaser(char pChar, int pCharOffset, int& charCount){
-	unsigned short tail[5][3];
-	char neighbourCount[5][3];
-	
-	for(int n = 0; n < 5; ++n){
-		for(int j = 0; j < 3; ++j){
-			if(asciiTable[(unsigned char)pChar][n][j]){
-				neighbourCount[n][j] = 0;
-				neighbourCount[n][j] += NeighboursVert(asciiTable[(unsigned char)pChar][n], j);
-				neighbourCount[n][j] += NeighboursHor(asciiTable[(unsigned char)pChar], n, j);
-				tail[n][j] = 0;
-			} else tail[n][j] = (unsigned short)-1;
-		}
-	}
-	
-	for(int n = 0; n < 5; ++n){
-		for(int j = 0; j < 3; ++j){
-			if(asciiTable[(unsigned char)pChar][n][j]){
-				//additional x, y offset to draw a line
-				int x = j, y = n;
-				int maxNeighbour = 0;
-				//forced line draw
-				bool forceLine = false;
-				
-				if(j > 0){
-					if(asciiTable[(unsigned char)pChar][n][j - 1]){
-						if(tail[n][j - 1] != 0){
-							if(tail[n][j - 1] != (n << 8 | j)){
-								forceLine = true;
-								tail[n][j] = (n << 8 | (j - 1));
-								x = j - 1;
-								y = n;
-							}
-						} else if(neighbourCount[n][j - 1] > maxNeighbour){
-							maxNeighbour = neighbourCount[n][j - 1];
-							x = j - 1;
-							y = n;
-						}
-					}
-				}
-				if(!forceLine && j < 2){
-					if(asciiTable[(unsigned char)pChar][n][j + 1]){
-						if(tail[n][j + 1] != 0){
-							if(tail[n][j + 1] != (n << 8 | j)){
-								forceLine = true;
-								tail[n][j] = (n << 8 | (j + 1));
-								x = j + 1;
-								y = n;
-							}
-						} else if(neighbourCount[n][j + 1] > maxNeighbour){
-							maxNeighbour = neighbourCount[n][j + 1];
-							x = j + 1;
-							y = n;
-						}
-					}
-				}	
-				if(!forceLine && n > 0){
-					if(asciiTable[(unsigned char)pChar][n - 1][j]){
-						if(tail[n - 1][j] != 0){
-							if(tail[n - 1][j] != (n << 8 | j)){
-								forceLine = true;
-								tail[n][j] = ((n-1) << 8 | (j));
-								x = j;
-								y = n - 1;
-							}
-						} else if(neighbourCount[n - 1][j] > maxNeighbour){
-							maxNeighbour = neighbourCount[n - 1][j];
-							x = j;
-							y = n - 1;
-						}
-					}
-				}
-				if(!forceLine && n < 4){
-					if(asciiTable[(unsigned char)pChar][n + 1][j]){
-						if(tail[n + 1][j] != 0){
-							if(tail[n + 1][j] != (n << 8 | j)){
-								forceLine = true;
-								tail[n][j] = ((n+1) << 8 | (j));
-								x = j;
-								y = n + 1;
-							}
-						} else if(neighbourCount[n + 1][j] > maxNeighbour){
-							maxNeighbour = neighbourCount[n + 1][j];
-							x = j;
-							y = n + 1;
-						}
-					}
-				}	
-				
-				if(!forceLine){
-					tail[n][j] = (y << 8 | x);
-				}
-				
-				vec2 LaserCharPos(m_Pos.x + pCharOffset * m_PosOffsetChars + j * m_PosOffsetCharPoints, m_Pos.y + n * m_PosOffsetCharPoints);
-				CLaserChar* pObj = (m_Chars[charCount] = new CLaserChar(GameWorld(), LaserCharPos));
+void CLaserText::Snap(int SnappingClient)
+{
+	if(!m_NumStrokes)
+		return;
+
+	// demos get the full text
+	bool Full = true;
+	if(SnappingClient != -1)
+	{
+		if(GameServer()->m_apPlayers[SnappingClient]->m_NoEffects)
+			return;
+
+		vec2 Center = m_Pos + vec2(((m_TextLength-1) * m_PosOffsetChars + (GLYPH_WIDTH-1) * m_PosOffsetCharPoints) / 2,
+			(GLYPH_HEIGHT-1) * m_PosOffsetCharPoints / 2);
+		if(NetworkClipped(SnappingClient, Center))
+			return;
 
-				pObj->m_FromPos.x = m_Pos.x + pCharOffset * m_PosOffsetChars + x * m_PosOffsetCharPoints;
-				pObj->m_FromPos.y = m_Pos.y + y * m_PosOffsetCharPoints;
+		if(g_Config.m_SvLaserTextLodDistance && distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, Center) > g_Config.m_SvLaserTextLodDistance)
+			Full = false;
 
-				++charCount;
-			}	
+		// the newest texts come first, the older ones get collapsed when there are many
+		if(g_Config.m_SvLaserTextBudget)
+		{
+			if(Full && GameWorld()->m_LaserTextBudget >= m_NumStrokes)
+			{
+				GameWorld()->m_LaserTextBudget -= m_NumStrokes;
+			}
+			else if(GameWorld()->m_LaserTextBudget > 0)
+			{
+				GameWorld()->m_LaserTextBudget--;
+				Full = false;
+			}
+			else
+				return;
 		}
 	}
-}
 
-void CLaserText::Snap(int SnappingClient)
-{
-	if(NetworkClipped(SnappingClient))
+	if(!Full)
+	{
+		SnapLine();
 		return;
-	
-	for(int i = 0; i < m_CharNum; ++i){
-		CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_Chars[i]->GetIDWrap(), sizeof(CNetObj_Laser)));
-		if(!pObj)
-			return;
+	}
+
+	int StrokeIndex = 0;
+	for(int c = 0; c < m_TextLength; ++c)
+	{
+		const CLaserGlyph *pGlyph = &s_aGlyphs[(unsigned char)m_aText[c]];
+		float CharX = m_Pos.x + c * m_PosOffsetChars;
+		for(int i = 0; i < pGlyph->m_NumStrokes; ++i)
+		{
+			CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_aStrokeIDs[StrokeIndex++], sizeof(CNetObj_Laser)));
+			if(!pObj)
+				return;
 
-		pObj->m_X = m_Chars[i]->GetPos().x;
-		pObj->m_Y = m_Chars[i]->GetPos().y;
-		pObj->m_FromX = m_Chars[i]->m_FromPos.x;
-		pObj->m_FromY = m_Chars[i]->m_FromPos.y;
-		pObj->m_StartTick = Server()->Tick();		
+			const CLaserStroke *pStroke = &pGlyph->m_aStrokes[i];
+			pObj->m_X = CharX + pStroke->m_X * m_PosOffsetCharPoints;
+			pObj->m_Y = m_Pos.y + pStroke->m_Y * m_PosOffsetCharPoints;
+			pObj->m_FromX = CharX + pStroke->m_FromX * m_PosOffsetCharPoints;
+			pObj->m_FromY = m_Pos.y + pStroke->m_FromY * m_PosOffsetCharPoints;
+			pObj->m_StartTick = Server()->Tick();
+		}
 	}
 }
-
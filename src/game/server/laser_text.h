@@ -1,31 +1,28 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
-#ifndef GAME_SERVER_ENTITIES_LASER_H
-#define GAME_SERVER_ENTITIES_LASER_H
+#ifndef GAME_SERVER_LASER_TEXT_H
+#define GAME_SERVER_LASER_TEXT_H
 
 #include <game/server/entity.h>
 
-class CLaserChar : public CEntity {
-public:
-	CLaserChar(CGameWorld *pGameWorld, vec2 Pos) : CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER, Pos, 0) {
-	}
-public:
-	int GetIDWrap() { return GetID(); }
-	vec2 m_FromPos;
-};
-
 class CLaserText : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
+	enum
+	{
+		// longer texts get cut
+		MAX_TEXT_LENGTH=16,
+		GLYPH_WIDTH=3,
+		GLYPH_HEIGHT=5,
+		MAX_STROKES=MAX_TEXT_LENGTH*GLYPH_HEIGHT*GLYPH_WIDTH,
+	};
+
+
 	CLaserText(CGameWorld *pGameWorld, vec2 Pos, int Owner, int pAliveTicks, char* pText, int pTextLen);
 	CLaserText(CGameWorld *pGameWorld, vec2 Pos, int Owner, int pAliveTicks, char* pText, int pTextLen, float pCharPointOffset, float pCharOffsetFactor);
-	virtual ~CLaserText(){ 
-		delete[] m_Text; 
-		for(int i = 0; i < m_CharNum; ++i) {
-			delete (CLaserChar*)m_Chars[i];
-		}
-		delete[] m_Chars;
-	}
+	virtual ~CLaserText();
 
 	virtual void Reset();
 	virtual void Tick();
@@ -36,19 +33,22 @@ private:
 	float m_PosOffsetCharPoints;
 	float m_PosOffsetChars;
 
-	void makeLaser(char pChar, int pCharOffset, int& charCount);
+	void Init(int Owner, int AliveTicks, const char *pText, int TextLen);
+	// cheap stand in for distant texts and when there are too many
+	void SnapLine();
 
 	int m_Owner;
-	
+
 	int m_AliveTicks;
 	int m_CurTicks;
 	int m_StartTick;
-	
-	char* m_Text;
-	int m_TextLen;
-	
-	CLaserChar** m_Chars;
-	int m_CharNum;
+
+	char m_aText[MAX_TEXT_LENGTH];
+	int m_TextLength;
+
+	// one snap id per laser of the text
+	int m_aStrokeIDs[MAX_STROKES];
+	int m_NumStrokes;
 };
 
 #endif
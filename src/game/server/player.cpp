@@ -33,6 +33,10 @@ CPlayer::CPlayer(CGameContext *pGameServer, int ClientID, bool Dummy, bool AsSpe
 	m_IsReadyToPlay = !GameServer()->m_pController->IsPlayerReadyMode();
 	m_RespawnDisabled = GameServer()->m_pController->GetStartRespawnState();
 	m_DeadSpecMode = false;
+	m_NoEffects = false;
+	m_SnapInfoStamp = -1;
+	m_SendVoteIndex = -1;
+	m_SendCommandIndex = -1;
 	m_Spawning = 0;
 
 	//fng2
@@ -161,18 +165,25 @@ void CPlayer::Snap(int SnappingClient)
 	if(!pPlayerInfo)
 		return;
 
-	pPlayerInfo->m_PlayerFlags = m_PlayerFlags&PLAYERFLAG_CHATTING;
-	if(Server()->IsAuthed(m_ClientID))
-		pPlayerInfo->m_PlayerFlags |= PLAYERFLAG_ADMIN;
-	if(!GameServer()->m_pController->IsPlayerReadyMode() || m_IsReadyToPlay)
-		pPlayerInfo->m_PlayerFlags |= PLAYERFLAG_READY;
-	if(m_RespawnDisabled && (!GetCharacter() || !GetCharacter()->IsAlive()))
-		pPlayerInfo->m_PlayerFlags |= PLAYERFLAG_DEAD;
+	if(m_SnapInfoStamp != GameServer()->m_World.SnapStamp())
+	{
+		m_SnapInfo.m_PlayerFlags = m_PlayerFlags&PLAYERFLAG_CHATTING;
+		if(Server()->IsAuthed(m_ClientID))
+			m_SnapInfo.m_PlayerFlags |= PLAYERFLAG_ADMIN;
+		if(!GameServer()->m_pController->IsPlayerReadyMode() || m_IsReadyToPlay)
+			m_SnapInfo.m_PlayerFlags |= PLAYERFLAG_READY;
+		if(m_RespawnDisabled && (!GetCharacter() || !GetCharacter()->IsAlive()))
+			m_SnapInfo.m_PlayerFlags |= PLAYERFLAG_DEAD;
+		m_SnapInfo.m_Latency = 0;
+		m_SnapInfo.m_Score = m_Score;
+		m_SnapInfoStamp = GameServer()->m_World.SnapStamp();
+	}
+
+	// only the watching flag and the latency depend on the snapping client
+	mem_copy(pPlayerInfo, &m_SnapInfo, sizeof(CNetObj_PlayerInfo));
 	if(SnappingClient != -1 && (m_Team == TEAM_SPECTATORS || m_DeadSpecMode) && (SnappingClient == m_SpectatorID))
 		pPlayerInfo->m_PlayerFlags |= PLAYERFLAG_WATCHING;
-
 	pPlayerInfo->m_Latency = SnappingClient == -1 ? m_Latency.m_Min : GameServer()->m_apPlayers[SnappingClient]->m_aActLatency[m_ClientID];
-	pPlayerInfo->m_Score = m_Score;
 
 	if(m_ClientID == SnappingClient && (m_Team == TEAM_SPECTATORS || m_DeadSpecMode))
 	{
@@ -502,6 +513,7 @@ void CPlayer::SetTeamSilent(int Team)
 	m_DeadSpecMode = false;
 
 	GameServer()->m_pController->OnPlayerInfoChange(GameServer()->m_apPlayers[m_ClientID]);
+	GameServer()->UpdateVoterTeam(m_ClientID);
 
 	if(Team == TEAM_SPECTATORS)
 	{
@@ -532,6 +544,7 @@ void CPlayer::TryRespawn()
 	m_Spawning = false;
 	m_pCharacter = new(m_ClientID) CCharacter(&GameServer()->m_World);
 	m_pCharacter->Spawn(this, SpawnPos);
+	GameServer()->m_pController->OnSpawnTaken(m_Team, SpawnPos);
 	GameServer()->CreatePlayerSpawn(SpawnPos);
 }
 
@@ -106,9 +106,19 @@ public:
 
 	bool m_RespawnDisabled;
 
+	// doesn't want laser text popups
+	bool m_NoEffects;
+
+	// player info as every client gets it, built on the first snap of a snapshot
+	CNetObj_PlayerInfo m_SnapInfo;
+	int m_SnapInfoStamp;
+
 	//
 	int m_Vote;
 	int m_VotePos;
+	// next message of the vote option and command lists to send, -1 when done
+	int m_SendVoteIndex;
+	int m_SendCommandIndex;
 	//
 	int m_LastVoteCall;
 	int m_LastVoteTry;
@@ -0,0 +1,160 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "votetally.h"
+
+static bool SameVoterAddr(const NETADDR *pA, const NETADDR *pB)
+{
+	return pA->type == pB->type && mem_comp(pA->ip, pB->ip, sizeof(pA->ip)) == 0;
+}
+
+CVoteTally::CVoteTally()
+{
+	Reset();
+}
+
+void CVoteTally::Reset()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		mem_zero(&m_aVoters[i], sizeof(m_aVoters[i]));
+		m_aVoters[i].m_Group = -1;
+		m_aGroupCounted[i] = false;
+		m_aGroupBallot[i] = 0;
+	}
+	m_Total = 0;
+	m_Yes = 0;
+	m_No = 0;
+}
+
+void CVoteTally::SetAddr(int ClientID, const NETADDR *pAddr)
+{
+	// leave the old group, it might get a new lowest client id
+	CVoter *pVoter = &m_aVoters[ClientID];
+	if(pVoter->m_Group >= 0)
+	{
+		Untally(pVoter->m_Group);
+		pVoter->m_Group = -1;
+		Regroup(&pVoter->m_Addr);
+	}
+
+	pVoter->m_Addr = *pAddr;
+	pVoter->m_Group = ClientID;
+	Regroup(pAddr);
+}
+
+void CVoteTally::Remove(int ClientID)
+{
+	CVoter *pVoter = &m_aVoters[ClientID];
+	if(pVoter->m_Group >= 0)
+	{
+		Untally(pVoter->m_Group);
+		pVoter->m_Group = -1;
+		Regroup(&pVoter->m_Addr);
+	}
+
+	// the next client in the slot starts without a vote
+	pVoter->m_Spectator = false;
+	pVoter->m_Vote = 0;
+	pVoter->m_VotePos = 0;
+}
+
+void CVoteTally::SetSpectator(int ClientID, bool Spectator)
+{
+	m_aVoters[ClientID].m_Spectator = Spectator;
+	Retally(ClientID);
+}
+
+void CVoteTally::SetVote(int ClientID, int Vote, int VotePos)
+{
+	m_aVoters[ClientID].m_Vote = Vote;
+	m_aVoters[ClientID].m_VotePos = VotePos;
+	Retally(ClientID);
+}
+
+void CVoteTally::ClearVotes()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aVoters[i].m_Vote = 0;
+		m_aVoters[i].m_VotePos = 0;
+	}
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_aVoters[i].m_Group == i)
+		{
+			Untally(i);
+			Tally(i);
+		}
+	}
+}
+
+void CVoteTally::Regroup(const NETADDR *pAddr)
+{
+	int Group = -1;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_aVoters[i].m_Group < 0 || !SameVoterAddr(&m_aVoters[i].m_Addr, pAddr))
+			continue;
+		Untally(m_aVoters[i].m_Group);
+		if(Group < 0)
+			Group = i;
+		m_aVoters[i].m_Group = Group;
+	}
+	if(Group >= 0)
+		Tally(Group);
+}
+
+void CVoteTally::Tally(int Group)
+{
+	int Ballot = 0;
+	int BallotPos = 0;
+	bool Counted = false;
+	for(int i = Group; i < MAX_CLIENTS; i++)
+	{
+		const CVoter *pVoter = &m_aVoters[i];
+		if(pVoter->m_Group != Group)
+			continue;
+		if(!Counted)
+		{
+			if(pVoter->m_Spectator)
+				continue;
+			Counted = true;
+		}
+		if(pVoter->m_Vote && (!Ballot || BallotPos > pVoter->m_VotePos))
+		{
+			Ballot = pVoter->m_Vote;
+			BallotPos = pVoter->m_VotePos;
+		}
+	}
+
+	m_aGroupCounted[Group] = Counted;
+	m_aGroupBallot[Group] = Ballot;
+	if(!Counted)
+		return;
+	m_Total++;
+	if(Ballot > 0)
+		m_Yes++;
+	else if(Ballot < 0)
+		m_No++;
+}
+
+void CVoteTally::Untally(int Group)
+{
+	if(!m_aGroupCounted[Group])
+		return;
+	m_aGroupCounted[Group] = false;
+	m_Total--;
+	if(m_aGroupBallot[Group] > 0)
+		m_Yes--;
+	else if(m_aGroupBallot[Group] < 0)
+		m_No--;
+}
+
+void CVoteTally::Retally(int ClientID)
+{
+	int Group = m_aVoters[ClientID].m_Group;
+	if(Group < 0)
+		return;
+	Untally(Group);
+	Tally(Group);
+}
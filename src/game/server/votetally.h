@@ -0,0 +1,57 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SERVER_VOTETALLY_H
+#define GAME_SERVER_VOTETALLY_H
+
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+
+/*
+	Class: CVoteTally
+		Counts the votes when they change. Clients with the same address
+		are grouped under the lowest client id. The lowest client of a group
+		that isn't a spectator stands for it, and the first vote from that
+		client or one with a higher id counts for the group.
+*/
+class CVoteTally
+{
+	struct CVoter
+	{
+		NETADDR m_Addr;
+		// lowest client id with the same address, -1 for free slots
+		int m_Group;
+		bool m_Spectator;
+		int m_Vote;
+		int m_VotePos;
+	};
+
+	CVoter m_aVoters[MAX_CLIENTS];
+	bool m_aGroupCounted[MAX_CLIENTS];
+	int m_aGroupBallot[MAX_CLIENTS];
+	int m_Total;
+	int m_Yes;
+	int m_No;
+
+	void Regroup(const NETADDR *pAddr);
+	void Tally(int Group);
+	void Untally(int Group);
+	void Retally(int ClientID);
+
+public:
+	CVoteTally();
+	void Reset();
+
+	// the client joins or gets a new address, without the port
+	void SetAddr(int ClientID, const NETADDR *pAddr);
+	void Remove(int ClientID);
+	void SetSpectator(int ClientID, bool Spectator);
+	void SetVote(int ClientID, int Vote, int VotePos);
+	// a new vote starts
+	void ClearVotes();
+
+	int Total() const { return m_Total; }
+	int Yes() const { return m_Yes; }
+	int No() const { return m_No; }
+};
+
+#endif
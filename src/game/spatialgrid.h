@@ -0,0 +1,336 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SPATIALGRID_H
+#define GAME_SPATIALGRID_H
+
+#include <base/math.h>
+#include <base/system.h>
+#include <base/vmath.h>
+
+/*
+	Class: CSpatialGrid
+		Uniform grid hashed into a fixed number of buckets. Items embed a
+		<CNode> and are moved between buckets when their cell changes, so
+		queries only look at the cells around the queried area.
+
+		Items provide GetPos() and GetProximityRadius(). The searches
+		return the same items in the same order as walking a list that
+		gets new items put in front, like the entity lists of the world.
+*/
+template<class T>
+class CSpatialGrid
+{
+public:
+	enum
+	{
+		CELL_SIZE=256,
+		NUM_BUCKETS=1024,
+		// larger queries walk all buckets instead
+		MAX_QUERY_CELLS=64,
+		// results Find can sort
+		MAX_FOUND=256,
+	};
+
+	class CNode
+	{
+		friend class CSpatialGrid;
+
+		T *m_pItem;
+		CNode *m_pPrev;
+		CNode *m_pNext;
+		int m_X;
+		int m_Y;
+		// insertion order, newer items have higher numbers
+		unsigned m_Seq;
+		bool m_Linked;
+
+	public:
+		CNode() : m_pItem(0), m_pPrev(0), m_pNext(0), m_X(0), m_Y(0), m_Seq(0), m_Linked(false) {}
+		bool IsLinked() const { return m_Linked; }
+	};
+
+	/*
+		Class: CQuery
+			Walks all items in the cells overlapping a box. Items outside the
+			box can be returned too, callers do the exact check.
+	*/
+	class CQuery
+	{
+		const CSpatialGrid *m_pGrid;
+		const CNode *m_pCur;
+		int m_X0, m_X1, m_Y1;
+		int m_X, m_Y;
+		bool m_All;
+
+	public:
+		CQuery(const CSpatialGrid *pGrid, vec2 Min, vec2 Max)
+		{
+			m_pGrid = pGrid;
+			m_X0 = Coord(Min.x);
+			m_X1 = Coord(Max.x);
+			m_Y = Coord(Min.y);
+			m_Y1 = Coord(Max.y);
+			m_All = (m_X1-m_X0+1)*(m_Y1-m_Y+1) > MAX_QUERY_CELLS;
+			if(m_All)
+			{
+				m_X = 0;
+				m_pCur = m_pGrid->m_apBuckets[0];
+			}
+			else
+			{
+				m_X = m_X0;
+				m_pCur = m_pGrid->m_apBuckets[Bucket(m_X, m_Y)];
+			}
+		}
+
+		const CNode *NextNode()
+		{
+			while(1)
+			{
+				while(m_pCur)
+				{
+					const CNode *pNode = m_pCur;
+					m_pCur = pNode->m_pNext;
+					// buckets are shared by several cells
+					if(m_All || (pNode->m_X == m_X && pNode->m_Y == m_Y))
+						return pNode;
+				}
+
+				if(m_All)
+				{
+					if(++m_X >= NUM_BUCKETS)
+						return 0;
+					m_pCur = m_pGrid->m_apBuckets[m_X];
+				}
+				else
+				{
+					if(++m_X > m_X1)
+					{
+						m_X = m_X0;
+						if(++m_Y > m_Y1)
+							return 0;
+					}
+					m_pCur = m_pGrid->m_apBuckets[Bucket(m_X, m_Y)];
+				}
+			}
+		}
+
+		T *Next()
+		{
+			const CNode *pNode = NextNode();
+			return pNode ? pNode->m_pItem : 0;
+		}
+	};
+
+private:
+	CNode *m_apBuckets[NUM_BUCKETS];
+	unsigned m_NextSeq;
+
+	// wraps around, items alive at the same time are never 2^31 inserts apart
+	static bool Newer(unsigned Seq, unsigned Other)
+	{
+		return (int)(Seq-Other) > 0;
+	}
+
+	static int Coord(float Value)
+	{
+		// keeps broken positions from overflowing
+		return (int)floorf(clamp(Value, -1.0e7f, 1.0e7f)/CELL_SIZE);
+	}
+
+	static int Bucket(int X, int Y)
+	{
+		return ((unsigned)X*73856093u ^ (unsigned)Y*19349663u)%NUM_BUCKETS;
+	}
+
+	void Link(CNode *pNode)
+	{
+		CNode **ppBucket = &m_apBuckets[Bucket(pNode->m_X, pNode->m_Y)];
+		pNode->m_pPrev = 0;
+		pNode->m_pNext = *ppBucket;
+		if(*ppBucket)
+			(*ppBucket)->m_pPrev = pNode;
+		*ppBucket = pNode;
+	}
+
+	void Unlink(CNode *pNode)
+	{
+		if(pNode->m_pPrev)
+			pNode->m_pPrev->m_pNext = pNode->m_pNext;
+		else
+			m_apBuckets[Bucket(pNode->m_X, pNode->m_Y)] = pNode->m_pNext;
+		if(pNode->m_pNext)
+			pNode->m_pNext->m_pPrev = pNode->m_pPrev;
+		pNode->m_pPrev = 0;
+		pNode->m_pNext = 0;
+	}
+
+public:
+	CSpatialGrid()
+	{
+		for(int i = 0; i < NUM_BUCKETS; i++)
+			m_apBuckets[i] = 0;
+		m_NextSeq = 0;
+	}
+
+	void Insert(CNode *pNode, T *pItem, vec2 Pos)
+	{
+		if(pNode->m_Linked)
+			Remove(pNode);
+		pNode->m_pItem = pItem;
+		pNode->m_X = Coord(Pos.x);
+		pNode->m_Y = Coord(Pos.y);
+		pNode->m_Seq = m_NextSeq++;
+		pNode->m_Linked = true;
+		Link(pNode);
+	}
+
+	void Remove(CNode *pNode)
+	{
+		if(!pNode->m_Linked)
+			return;
+		Unlink(pNode);
+		pNode->m_Linked = false;
+	}
+
+	void Move(CNode *pNode, vec2 Pos)
+	{
+		if(!pNode->m_Linked)
+			return;
+		int X = Coord(Pos.x);
+		int Y = Coord(Pos.y);
+		if(X == pNode->m_X && Y == pNode->m_Y)
+			return;
+		Unlink(pNode);
+		pNode->m_X = X;
+		pNode->m_Y = Y;
+		Link(pNode);
+	}
+
+	// whether the node is in the cell of the position
+	bool IsCurrent(const CNode *pNode, vec2 Pos) const
+	{
+		return !pNode->m_Linked || (pNode->m_X == Coord(Pos.x) && pNode->m_Y == Coord(Pos.y));
+	}
+
+	/*
+		Function: Find
+			Finds the items closer than Radius to a position, newest first.
+			When more than Max items are close, the newest Max of them are
+			returned. Without ppItems the count stops at Max.
+
+		Arguments:
+			MaxItemRadius - Largest proximity radius of the items.
+	*/
+	int Find(vec2 Pos, float Radius, float MaxItemRadius, T **ppItems, int Max) const
+	{
+		dbg_assert(Max <= MAX_FOUND, "too many results for the spatial grid");
+		if(Max <= 0)
+			return 0;
+
+		unsigned aSeqs[MAX_FOUND];
+		int Num = 0;
+		vec2 Reach = vec2(Radius+MaxItemRadius, Radius+MaxItemRadius);
+		CQuery Query(this, Pos-Reach, Pos+Reach);
+		for(const CNode *pNode = Query.NextNode(); pNode; pNode = Query.NextNode())
+		{
+			T *pItem = pNode->m_pItem;
+			if(distance(pItem->GetPos(), Pos) >= Radius+pItem->GetProximityRadius())
+				continue;
+
+			if(!ppItems)
+			{
+				if(++Num == Max)
+					break;
+				continue;
+			}
+
+			// insertion sort, the oldest result drops out when full
+			int i;
+			if(Num < Max)
+				i = Num++;
+			else if(Newer(pNode->m_Seq, aSeqs[Max-1]))
+				i = Max-1;
+			else
+				continue;
+			for(; i > 0 && Newer(pNode->m_Seq, aSeqs[i-1]); i--)
+			{
+				aSeqs[i] = aSeqs[i-1];
+				ppItems[i] = ppItems[i-1];
+			}
+			aSeqs[i] = pNode->m_Seq;
+			ppItems[i] = pItem;
+		}
+		return Num;
+	}
+
+	/*
+		Function: Closest
+			Finds the closest item whose proximity radius reaches into
+			Radius around a position. Of items at the same distance the
+			newest wins.
+	*/
+	T *Closest(vec2 Pos, float Radius, float MaxItemRadius, const T *pNotThis) const
+	{
+		float ClosestRange = Radius*2;
+		const CNode *pClosest = 0;
+
+		vec2 Reach = vec2(Radius+MaxItemRadius, Radius+MaxItemRadius);
+		CQuery Query(this, Pos-Reach, Pos+Reach);
+		for(const CNode *pNode = Query.NextNode(); pNode; pNode = Query.NextNode())
+		{
+			T *pItem = pNode->m_pItem;
+			if(pItem == pNotThis)
+				continue;
+
+			float Len = distance(Pos, pItem->GetPos());
+			if(Len < pItem->GetProximityRadius()+Radius &&
+				(Len < ClosestRange || (pClosest && Len == ClosestRange && Newer(pNode->m_Seq, pClosest->m_Seq))))
+			{
+				ClosestRange = Len;
+				pClosest = pNode;
+			}
+		}
+		return pClosest ? pClosest->m_pItem : 0;
+	}
+
+	/*
+		Function: Intersect
+			Finds the item closest to Pos0 that the line touches. Of items
+			hit at the same distance the newest wins.
+
+		Arguments:
+			pNewPos - Set to the point on the line next to the hit item.
+	*/
+	T *Intersect(vec2 Pos0, vec2 Pos1, float Radius, float MaxItemRadius, vec2 *pNewPos, const T *pNotThis) const
+	{
+		float ClosestLen = distance(Pos0, Pos1) * 100.0f;
+		const CNode *pClosest = 0;
+
+		float Reach = Radius+MaxItemRadius;
+		vec2 Min = vec2(min(Pos0.x, Pos1.x)-Reach, min(Pos0.y, Pos1.y)-Reach);
+		vec2 Max = vec2(max(Pos0.x, Pos1.x)+Reach, max(Pos0.y, Pos1.y)+Reach);
+		CQuery Query(this, Min, Max);
+		for(const CNode *pNode = Query.NextNode(); pNode; pNode = Query.NextNode())
+		{
+			T *pItem = pNode->m_pItem;
+			if(pItem == pNotThis)
+				continue;
+
+			vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, pItem->GetPos());
+			if(distance(pItem->GetPos(), IntersectPos) >= pItem->GetProximityRadius()+Radius)
+				continue;
+
+			float Len = distance(Pos0, IntersectPos);
+			if(Len < ClosestLen || (pClosest && Len == ClosestLen && Newer(pNode->m_Seq, pClosest->m_Seq)))
+			{
+				*pNewPos = IntersectPos;
+				ClosestLen = Len;
+				pClosest = pNode;
+			}
+		}
+		return pClosest ? pClosest->m_pItem : 0;
+	}
+};
+
+#endif
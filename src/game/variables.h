@@ -115,6 +115,7 @@ MACRO_CONFIG_STR(SvGametype, sv_gametype, 32, "fng2", CFGFLAG_SAVE|CFGFLAG_SERVE
 MACRO_CONFIG_INT(SvTournamentMode, sv_tournament_mode, 0, 0, 2, CFGFLAG_SAVE|CFGFLAG_SERVER, "Tournament mode. When enabled, players joins the server as spectator (2=additional restricted spectator chat)")
 MACRO_CONFIG_INT(SvPlayerReadyMode, sv_player_ready_mode, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "When enabled, players can pause/unpause the game and start the game on warmup via their ready state")
 MACRO_CONFIG_INT(SvSpamprotection, sv_spamprotection, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Spam protection")
+MACRO_CONFIG_INT(SvSweptCollision, sv_swept_collision, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Move tees and flags from tile border to tile border instead of in unit steps (0 keeps the old movement)")
 
 MACRO_CONFIG_INT(SvRespawnDelayTDM, sv_respawn_delay_tdm, 3, 0, 10, CFGFLAG_SAVE|CFGFLAG_SERVER, "Time needed to respawn after death in tdm gametype")
 
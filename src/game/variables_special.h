@@ -40,4 +40,7 @@ MACRO_CONFIG_INT(SvKillTakeOverTime, sv_kill_take_over_time, 250, -1, 1250, CFGF
 MACRO_CONFIG_INT(SvGrenadeDamageToHit, sv_grenade_damage_to_hit, 4, 0, 6, CFGFLAG_SERVER, "The damage that needs to be dealed with the grenade to freeze the opponent. 0: all shots will kill, x: damage that must be dealed to freeze the opponent")
 
 
+MACRO_CONFIG_INT(SvLaserTextLodDistance, sv_laser_text_lod_distance, 700, 0, 1100, CFGFLAG_SERVER, "Laser texts farther away from a player's view than this are sent as a single line. 0: always full")
+MACRO_CONFIG_INT(SvLaserTextBudget, sv_laser_text_budget, 120, 0, 1000, CFGFLAG_SERVER, "Lasers of laser texts sent to a player per snapshot, texts over it are sent as a single line or not at all. 0: unlimited")
+
 MACRO_CONFIG_INT(SvTrivia, sv_trivia, 1, 0, 1, CFGFLAG_SERVER, "Send trivia at round end.")
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/collision.h>
+
+#include "testmap.h"
+
+// the sampling IntersectLine used before the tile walk
+static int IntersectLineSampled(const CCollision *pCollision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance+1);
+	vec2 Last = Pos0;
+
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i/float(End);
+		vec2 Pos = mix(Pos0, Pos1, a);
+		if(pCollision->CheckPoint(Pos.x, Pos.y))
+		{
+			if(pOutCollision)
+				*pOutCollision = Pos;
+			if(pOutBeforeCollision)
+				*pOutBeforeCollision = Last;
+			return pCollision->GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	if(pOutCollision)
+		*pOutCollision = Pos1;
+	if(pOutBeforeCollision)
+		*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+class CRandomMap
+{
+public:
+	CTestMap *m_pMap;
+	unsigned m_Seed;
+
+	int Random(int Max)
+	{
+		m_Seed = m_Seed*1103515245+12345;
+		return (m_Seed>>8)%Max;
+	}
+
+	float RandomFloat(float Min, float Max)
+	{
+		return Min+Random(1<<20)/float(1<<20)*(Max-Min);
+	}
+
+	CRandomMap(int Width, int Height, int Density, bool Spikes=false)
+	{
+		m_Seed = 1;
+		m_pMap = new CTestMap(Width, Height);
+		for(int y = 0; y < Height; y++)
+			for(int x = 0; x < Width; x++)
+				if(Random(100) < Density)
+				{
+					static const int s_aTiles[] = {TILE_SOLID, TILE_SOLID, TILE_NOHOOK, TILE_DEATH};
+					static const int s_aSpikes[] = {CCollision::TILE_SPIKE_NORMAL, CCollision::TILE_SPIKE_RED, CCollision::TILE_SPIKE_BLUE,
+						CCollision::TILE_SPIKE_GOLD, CCollision::TILE_SPIKE_GREEN, CCollision::TILE_SPIKE_PURPLE};
+					if(Spikes && Random(2))
+						m_pMap->SetTile(x, y, s_aSpikes[Random(6)]);
+					else
+						m_pMap->SetTile(x, y, s_aTiles[Random(4)]);
+				}
+		m_pMap->InitCollision();
+	}
+
+	~CRandomMap()
+	{
+		delete m_pMap;
+	}
+
+	// mostly inside the map, some outside of it and some on tile borders
+	vec2 RandomPos()
+	{
+		float MaxX = m_pMap->Width()*32.0f;
+		float MaxY = m_pMap->Height()*32.0f;
+		vec2 Pos(RandomFloat(-100.0f, MaxX+100.0f), RandomFloat(-100.0f, MaxY+100.0f));
+		if(Random(8) == 0)
+			Pos.x = Random(m_pMap->Width())*32-0.5f;
+		if(Random(8) == 0)
+			Pos.y = Random(m_pMap->Height())*32+0.5f;
+		return Pos;
+	}
+};
+
+// the lookup on the converted game layer used before the flag map
+static int GetTileReference(CTestMap *pMap, int x, int y)
+{
+	const CTile *pTiles = (const CTile *)pMap->GetData(0);
+	int Nx = clamp(x/32, 0, pMap->Width()-1);
+	int Ny = clamp(y/32, 0, pMap->Height()-1);
+	const CTile *pTile = &pTiles[Ny*pMap->Width()+Nx];
+	if(pTile->m_Reserved)
+		return pTile->m_Index << CCollision::COLFLAG_SPIKE_SHIFT;
+	return pTile->m_Index > 128 ? 0 : pTile->m_Index;
+}
+
+TEST(Collision, FlagMap)
+{
+	CRandomMap Map(40, 30, 30, true);
+	const CCollision *pCollision = &Map.m_pMap->m_Collision;
+	for(int i = 0; i < 100000; i++)
+	{
+		int x, y;
+		if(Map.Random(10) == 0)
+		{
+			// far outside of the border too
+			x = Map.Random(40*32*4)-40*32*2;
+			y = Map.Random(30*32*4)-30*32*2;
+		}
+		else
+		{
+			x = Map.Random(40*32+600)-300;
+			y = Map.Random(30*32+600)-300;
+		}
+		ASSERT_EQ(pCollision->GetCollisionAt(x, y), GetTileReference(Map.m_pMap, x, y));
+	}
+}
+
+TEST(Collision, CollisionBox)
+{
+	CRandomMap Map(40, 30, 30, true);
+	const CCollision *pCollision = &Map.m_pMap->m_Collision;
+	for(int i = 0; i < 20000; i++)
+	{
+		// the spike check of the characters, smaller than a tile
+		vec2 Pos = Map.RandomPos();
+		float Offset = 28.0f/3.0f;
+		int Corners = pCollision->GetCollisionAt(Pos.x+Offset, Pos.y-Offset) | pCollision->GetCollisionAt(Pos.x+Offset, Pos.y+Offset) |
+			pCollision->GetCollisionAt(Pos.x-Offset, Pos.y-Offset) | pCollision->GetCollisionAt(Pos.x-Offset, Pos.y+Offset);
+		ASSERT_EQ(pCollision->GetCollisionBox(Pos, vec2(Offset*2.0f, Offset*2.0f)), Corners);
+
+		// larger boxes cover the tiles between the corners
+		vec2 Size(Map.RandomFloat(0.0f, 200.0f), Map.RandomFloat(0.0f, 200.0f));
+		int Flags = 0;
+		for(float y = Pos.y-Size.y/2; y < Pos.y+Size.y/2+16.0f; y += 16.0f)
+			for(float x = Pos.x-Size.x/2; x < Pos.x+Size.x/2+16.0f; x += 16.0f)
+				Flags |= pCollision->GetCollisionAt(min(x, Pos.x+Size.x/2), min(y, Pos.y+Size.y/2));
+		ASSERT_EQ(pCollision->GetCollisionBox(Pos, Size), Flags);
+	}
+}
+
+TEST(Collision, IntersectLineEquivalence)
+{
+	for(int Density = 0; Density <= 40; Density += 10)
+	{
+		CRandomMap Map(40, 30, Density);
+		const CCollision *pCollision = &Map.m_pMap->m_Collision;
+		for(int i = 0; i < 20000; i++)
+		{
+			vec2 Pos0 = Map.RandomPos();
+			vec2 Pos1;
+			switch(Map.Random(5))
+			{
+			case 0: Pos1 = Pos0; break;
+			case 1: Pos1 = vec2(Map.RandomPos().x, Pos0.y); break;
+			case 2: Pos1 = vec2(Pos0.x, Map.RandomPos().y); break;
+			case 3: Pos1 = Pos0+vec2(Map.RandomFloat(-40.0f, 40.0f), Map.RandomFloat(-40.0f, 40.0f)); break;
+			default: Pos1 = Map.RandomPos();
+			}
+
+			vec2 Collision, BeforeCollision;
+			vec2 RefCollision, RefBeforeCollision;
+			int Hit = pCollision->IntersectLine(Pos0, Pos1, &Collision, &BeforeCollision);
+			int RefHit = IntersectLineSampled(pCollision, Pos0, Pos1, &RefCollision, &RefBeforeCollision);
+			ASSERT_EQ(Hit, RefHit);
+			ASSERT_EQ(Collision.x, RefCollision.x);
+			ASSERT_EQ(Collision.y, RefCollision.y);
+			ASSERT_EQ(BeforeCollision.x, RefBeforeCollision.x);
+			ASSERT_EQ(BeforeCollision.y, RefBeforeCollision.y);
+		}
+	}
+}
+
+TEST(Collision, MoveBoxFuzz)
+{
+	const vec2 Size(28.0f, 28.0f);
+	int Total = 0, Close = 0, SameDeath = 0;
+	for(int Density = 5; Density <= 35; Density += 10)
+	{
+		CRandomMap Map(40, 30, Density);
+		const CCollision *pCollision = &Map.m_pMap->m_Collision;
+		for(int i = 0; i < 20000; i++)
+		{
+			vec2 Pos = Map.RandomPos();
+			if(pCollision->TestBox(Pos, Size))
+				continue;
+			float MaxVel = Map.Random(10) == 0 ? 300.0f : 40.0f;
+			vec2 Vel(Map.RandomFloat(-MaxVel, MaxVel), Map.RandomFloat(-MaxVel, MaxVel));
+			float Elasticity = Map.Random(2) ? 0.5f : 0.0f;
+
+			vec2 StepPos = Pos, StepVel = Vel, SweptPos = Pos, SweptVel = Vel;
+			bool StepDeath, SweptDeath;
+			pCollision->MoveBoxStepped(&StepPos, &StepVel, Size, Elasticity, &StepDeath);
+			pCollision->MoveBoxSwept(&SweptPos, &SweptVel, Size, Elasticity, &SweptDeath);
+
+			// never ends up in the ground
+			ASSERT_FALSE(pCollision->TestBox(SweptPos, Size));
+			Total++;
+			// the stepping stops up to a unit in front of walls
+			Close += distance(StepPos, SweptPos) < 1.5f;
+			SameDeath += StepDeath == SweptDeath;
+		}
+	}
+
+	// bounces off corners at high speed can go different ways
+	EXPECT_GT(Total, 40000);
+	EXPECT_GE(Close, Total*99/100);
+	EXPECT_GE(SameDeath, Total*99/100);
+}
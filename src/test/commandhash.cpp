@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/commandhash.h>
+
+TEST(CommandHash, Find)
+{
+	CCommandHash Hash;
+	int aCommands[3];
+	Hash.Add("sv_map", &aCommands[0]);
+	Hash.Add("Kick", &aCommands[1]);
+	Hash.Add("kick", &aCommands[2]);
+	EXPECT_EQ(Hash.Num(), 3);
+
+	EXPECT_EQ(Hash.Find("SV_MAP"), &aCommands[0]);
+	EXPECT_EQ(Hash.Find("sv_ma"), (void *)0);
+	EXPECT_EQ(Hash.Find("sv_map_"), (void *)0);
+	// the name ends at the first whitespace
+	EXPECT_EQ(Hash.Find("sv_map dm1"), &aCommands[0]);
+
+	// commands sharing a name come latest first
+	int Index = Hash.First("KICK");
+	ASSERT_GE(Index, 0);
+	EXPECT_EQ(Hash.Get(Index), &aCommands[2]);
+	Index = Hash.Next(Index);
+	ASSERT_GE(Index, 0);
+	EXPECT_EQ(Hash.Get(Index), &aCommands[1]);
+	EXPECT_EQ(Hash.Next(Index), -1);
+
+	Hash.Remove("kick", &aCommands[2]);
+	EXPECT_EQ(Hash.Find("kick"), &aCommands[1]);
+	EXPECT_EQ(Hash.Num(), 2);
+}
+
+TEST(CommandHash, Grow)
+{
+	CCommandHash Hash;
+	char aaNames[1000][16];
+	for(int i = 0; i < 1000; i++)
+	{
+		str_format(aaNames[i], sizeof(aaNames[i]), "cmd%d", i);
+		Hash.Add(aaNames[i], aaNames[i]);
+	}
+	for(int i = 0; i < 1000; i++)
+		EXPECT_EQ(Hash.Find(aaNames[i]), aaNames[i]);
+
+	// removed entries get reused
+	for(int i = 0; i < 1000; i += 2)
+		Hash.Remove(aaNames[i], aaNames[i]);
+	EXPECT_EQ(Hash.Find("cmd10"), (void *)0);
+	EXPECT_EQ(Hash.Find("cmd11"), aaNames[11]);
+	Hash.Add(aaNames[10], aaNames[10]);
+	EXPECT_EQ(Hash.Find("cmd10"), aaNames[10]);
+
+	Hash.Clear();
+	EXPECT_EQ(Hash.Num(), 0);
+	EXPECT_EQ(Hash.Find("cmd11"), (void *)0);
+}
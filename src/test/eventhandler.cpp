@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/server.h>
+#include <engine/shared/snapshot.h>
+#include <game/clientviews.h>
+#include <game/server/eventhandler.h>
+#include <generated/protocol.h>
+
+static bool CreateExplosion(CEventHandler *pEvents, int X, int Y, int64 Mask = -1)
+{
+	CNetEvent_Explosion *pEvent = (CNetEvent_Explosion *)pEvents->Create(NETEVENTTYPE_EXPLOSION, sizeof(CNetEvent_Explosion), Mask);
+	if(!pEvent)
+		return false;
+	pEvent->m_X = X;
+	pEvent->m_Y = Y;
+	return true;
+}
+
+// snaps into a snapshot builder, like the server does
+class CSnapServer : public IServer
+{
+public:
+	CSnapshotBuilder m_Builder;
+
+	CSnapServer() { m_Builder.Init(); }
+
+	virtual int MaxClients() const { return MAX_CLIENTS; }
+	virtual const char *ClientName(int ClientID) const { return ""; }
+	virtual const char *ClientClan(int ClientID) const { return ""; }
+	virtual int ClientCountry(int ClientID) const { return -1; }
+	virtual bool ClientIngame(int ClientID) const { return false; }
+	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) const { return 0; }
+	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) const { pAddrStr[0] = 0; }
+	virtual void GetClientAddr(int ClientID, NETADDR *pAddr) const { mem_zero(pAddr, sizeof(*pAddr)); }
+	virtual int GetClientVersion(int ClientID) const { return 0; }
+	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) { return 0; }
+	virtual int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask) { return 0; }
+	virtual int SendMsgRaw(const void *pData, int Size, int Flags, int ClientID) { return 0; }
+	virtual int ListSyncBudget(int ClientID) const { return 0; }
+	virtual void SetClientName(int ClientID, char const *pName) {}
+	virtual void SetClientClan(int ClientID, char const *pClan) {}
+	virtual void SetClientCountry(int ClientID, int Country) {}
+	virtual void SetClientScore(int ClientID, int Score) {}
+	virtual void SetClientVersion(int ClientID, int Version) {}
+	virtual void SetClientUnknownFlags(int ClientID, int UnknownFlags) {}
+	virtual int SnapNewID() { return 0; }
+	virtual void SnapFreeID(int ID) {}
+	virtual void *SnapNewItem(int Type, int ID, int Size) { return m_Builder.NewItem(Type, ID, Size); }
+	virtual void SnapSetStaticsize(int ItemType, int Size) {}
+	virtual void SetRconCID(int ClientID) {}
+	virtual bool IsAuthed(int ClientID) const { return false; }
+	virtual bool IsBanned(int ClientID) { return false; }
+	virtual void Kick(int ClientID, const char *pReason) {}
+	virtual void DemoRecorder_HandleAutoStart() {}
+	virtual bool DemoRecorder_IsRecording() { return false; }
+};
+
+TEST(EventHandler, Grow)
+{
+	CEventHandler Events;
+	EXPECT_EQ(Events.Capacity(), (int)CEventHandler::MIN_EVENTS);
+
+	// every second event next to the only client
+	for(int i = 0; i < 300; i++)
+		ASSERT_TRUE(CreateExplosion(&Events, i%2 ? i : 100000+i, 0));
+	EXPECT_EQ(Events.Capacity(), 512);
+	EXPECT_EQ(Events.NumEvents(), 300);
+	EXPECT_EQ(Events.NumOverflows(), 0);
+
+	// the events from before growing were moved along
+	CClientViews Views;
+	Views.Add(7, vec2(0, 0));
+	Events.UpdateVisibility(&Views);
+	int aEvents[CEventHandler::MAX_EVENTS];
+	int Num = Events.VisibleEvents(7, aEvents);
+	int NumOdd = 0;
+	for(int i = 0; i < Num; i++)
+		NumOdd += aEvents[i]%2;
+	EXPECT_EQ(Num, 150);
+	EXPECT_EQ(NumOdd, 150);
+
+	// the storage is kept for the next ticks
+	Events.Clear();
+	EXPECT_EQ(Events.NumEvents(), 0);
+	EXPECT_EQ(Events.Capacity(), 512);
+	EXPECT_EQ(Events.PeakEvents(), 300);
+}
+
+TEST(EventHandler, Overflow)
+{
+	CEventHandler Events;
+	for(int i = 0; i < CEventHandler::MAX_EVENTS; i++)
+		ASSERT_TRUE(CreateExplosion(&Events, i, i));
+	EXPECT_FALSE(CreateExplosion(&Events, 0, 0));
+	EXPECT_FALSE(CreateExplosion(&Events, 0, 0));
+	EXPECT_EQ(Events.NumEvents(), (int)CEventHandler::MAX_EVENTS);
+	EXPECT_EQ(Events.Capacity(), (int)CEventHandler::MAX_EVENTS);
+	EXPECT_EQ(Events.NumOverflows(), 2);
+
+	// running out of data space counts as well
+	Events.Clear();
+	const int Size = 4096;
+	for(int i = 0; i < CEventHandler::MAX_DATASIZE/Size; i++)
+		EXPECT_TRUE(Events.Create(NETEVENTTYPE_EXPLOSION, Size));
+	EXPECT_FALSE(Events.Create(NETEVENTTYPE_EXPLOSION, Size));
+	EXPECT_EQ(Events.NumOverflows(), 3);
+
+	int aEvents[CEventHandler::MAX_EVENTS];
+	EXPECT_EQ(Events.VisibleEvents(-1, aEvents), CEventHandler::MAX_DATASIZE/Size);
+}
+
+TEST(EventHandler, Culling)
+{
+	unsigned Seed = 99;
+	CClientViews Views;
+	vec2 aViewPos[MAX_CLIENTS];
+	bool aPlaying[MAX_CLIENTS] = {0};
+	for(int i = 0; i < MAX_CLIENTS; i += 3)
+	{
+		Seed = Seed*1103515245+12345;
+		aViewPos[i] = vec2((Seed>>8)%20000-2000.0f, (Seed>>16)%8000-1000.0f);
+		aPlaying[i] = true;
+		Views.Add(i, aViewPos[i]);
+	}
+
+	CEventHandler Events;
+	int aX[500], aY[500];
+	int64 aMask[500];
+	for(int i = 0; i < 500; i++)
+	{
+		Seed = Seed*1103515245+12345;
+		aX[i] = (int)((Seed>>8)%20000)-2000;
+		aY[i] = (int)((Seed>>16)%8000)-1000;
+		// some events are only for one client, like damage indicators
+		aMask[i] = i%5 ? -1 : (int64)1<<((Seed>>4)%MAX_CLIENTS);
+		ASSERT_TRUE(CreateExplosion(&Events, aX[i], aY[i], aMask[i]));
+	}
+	Events.UpdateVisibility(&Views);
+
+	int aEvents[CEventHandler::MAX_EVENTS];
+	int NumSeen = 0;
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		bool aVisible[500] = {0};
+		int Num = Events.VisibleEvents(c, aEvents);
+		for(int k = 0; k < Num; k++)
+		{
+			ASSERT_FALSE(aVisible[aEvents[k]]);
+			aVisible[aEvents[k]] = true;
+		}
+
+		// same as checking every event against the view
+		for(int i = 0; i < 500; i++)
+		{
+			bool Expected = false;
+			if(aPlaying[c] && (aMask[i]&((int64)1<<c)))
+			{
+				float dx = aViewPos[c].x-aX[i];
+				float dy = aViewPos[c].y-aY[i];
+				Expected = dx*dx+dy*dy < 1500.0f*1500.0f;
+			}
+			EXPECT_EQ(aVisible[i], Expected);
+		}
+		NumSeen += Num;
+	}
+	// clients see some of the events, most are culled
+	EXPECT_GT(NumSeen, 200);
+	EXPECT_LT(NumSeen, 2000);
+
+	// the server demo gets everything in order
+	EXPECT_EQ(Events.VisibleEvents(-1, aEvents), 500);
+	EXPECT_EQ(aEvents[499], 499);
+}
+
+TEST(EventHandler, SnapshotBudget)
+{
+	CSnapServer *pServer = new CSnapServer();
+	CEventHandler Events;
+	Events.SetServer(pServer);
+	for(int i = 0; i < CEventHandler::MAX_EVENTS; i++)
+		ASSERT_TRUE(CreateExplosion(&Events, i, i));
+	EXPECT_FALSE(CreateExplosion(&Events, 0, 0));
+	EXPECT_EQ(Events.NumOverflows(), 1);
+
+	// a full server with characters and many entities, the events still fit
+	for(int i = 0; i < MAX_CLIENTS*4; i++)
+		ASSERT_TRUE(pServer->SnapNewItem(NETOBJTYPE_PLAYERINFO+i%4, i/4, sizeof(CNetObj_Character)));
+	for(int i = 0; i < 200; i++)
+		ASSERT_TRUE(pServer->SnapNewItem(NETOBJTYPE_LASER, i, sizeof(CNetObj_Laser)));
+	Events.Snap(-1);
+	EXPECT_EQ(Events.NumOverflows(), 1);
+
+	// events the snapshot has no room for are counted
+	pServer->m_Builder.Init();
+	for(int i = 0; i < 1000; i++)
+		ASSERT_TRUE(pServer->SnapNewItem(NETOBJTYPE_LASER, i, sizeof(CNetObj_Laser)));
+	Events.Snap(-1);
+	EXPECT_EQ(Events.NumOverflows(), 1+CEventHandler::MAX_EVENTS-23);
+
+	delete pServer;
+}
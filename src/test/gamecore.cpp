@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/gamecore.h>
+
+#include "testmap.h"
+
+// a closed arena with platforms, a nohook wall and a death pit
+static void BuildArena(CTestMap *pMap)
+{
+	for(int x = 0; x < pMap->Width(); x++)
+	{
+		pMap->SetTile(x, 0, TILE_SOLID);
+		pMap->SetTile(x, pMap->Height()-1, x > 20 && x < 25 ? TILE_DEATH : TILE_SOLID);
+	}
+	for(int y = 0; y < pMap->Height(); y++)
+	{
+		pMap->SetTile(0, y, TILE_SOLID);
+		pMap->SetTile(pMap->Width()-1, y, TILE_NOHOOK);
+	}
+	for(int x = 8; x < 30; x++)
+		pMap->SetTile(x, 12, TILE_SOLID);
+	for(int x = 18; x < 40; x++)
+		pMap->SetTile(x, 20, TILE_NOHOOK);
+	for(int y = 5; y < 15; y++)
+		pMap->SetTile(35, y, TILE_SOLID);
+	pMap->InitCollision();
+}
+
+// runs a crowded fight with pseudo random input through the server tick order and
+// hashes every quantized core after each tick
+static unsigned ReplayChecksum(int NumTicks, bool Kicks, int *pNumCollisions=0, int *pNumPlayerHooks=0)
+{
+	CTestMap *pMap = new CTestMap(50, 30);
+	BuildArena(pMap);
+
+	CWorldCore *pWorld = new CWorldCore();
+	CCharacterCore *pCores = new CCharacterCore[16];
+	for(int i = 0; i < 16; i++)
+	{
+		pCores[i].Reset();
+		mem_zero(&pCores[i].m_Input, sizeof(pCores[i].m_Input));
+		pCores[i].Init(pWorld, &pMap->m_Collision);
+		pCores[i].m_Pos = vec2(200.0f+(i%8)*40.0f, 200.0f+(i/8)*100.0f);
+		pWorld->SetCharacter(i, &pCores[i]);
+	}
+
+	unsigned Seed = 1;
+	unsigned Checksum = 2166136261u;
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+	{
+		for(int i = 0; i < 16; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			CNetObj_PlayerInput *pInput = &pCores[i].m_Input;
+			if(Tick%7 == 0)
+				pInput->m_Direction = (int)((Seed>>16)%3)-1;
+			pInput->m_Jump = (Seed>>8)%5 == 0;
+			if(Tick%11 == i%11)
+				pInput->m_Hook = !pInput->m_Hook;
+			pInput->m_TargetX = (int)((Seed>>12)%400)-200;
+			pInput->m_TargetY = (int)((Seed>>20)%400)-200;
+			// explosions that send tees flying through the crowd
+			if(Kicks && Tick%50 == i)
+				pCores[i].m_Vel += vec2((int)((Seed>>4)%121)-60, (int)((Seed>>10)%121)-60);
+			pCores[i].Tick(true);
+			if(pNumPlayerHooks && pCores[i].m_HookedPlayer != -1)
+				(*pNumPlayerHooks)++;
+		}
+		for(int i = 0; i < 16; i++)
+		{
+			pCores[i].Move();
+			pCores[i].Quantize();
+
+			CNetObj_CharacterCore Core;
+			mem_zero(&Core, sizeof(Core));
+			pCores[i].Write(&Core);
+			const unsigned char *pData = (const unsigned char *)&Core;
+			for(unsigned b = 0; b < sizeof(Core); b++)
+				Checksum = (Checksum^pData[b])*16777619u;
+		}
+	}
+
+	for(int i = 0; i < 16 && pNumCollisions; i++)
+		*pNumCollisions += pCores[i].m_CoreStats.m_NumTeeCollisions;
+
+	delete[] pCores;
+	delete pWorld;
+	delete pMap;
+	return Checksum;
+}
+
+TEST(GameCore, Replay)
+{
+	int NumCollisions = 0, NumPlayerHooks = 0;
+	unsigned Checksum = ReplayChecksum(3000, false, &NumCollisions, &NumPlayerHooks);
+	EXPECT_EQ(Checksum, ReplayChecksum(3000, false));
+	// the replay has to cover player collisions and hooks
+	EXPECT_GT(NumCollisions, 0);
+	EXPECT_GT(NumPlayerHooks, 0);
+	// recorded before the world core stored positions in arrays, the physics must not change
+	EXPECT_EQ(Checksum, 3224025881u);
+}
+
+TEST(GameCore, ReplayFast)
+{
+	// recorded before the broadphase in CCharacterCore::Move
+	EXPECT_EQ(ReplayChecksum(3000, true), 2292774909u);
+}
+
+TEST(GameCore, ReckoningRest)
+{
+	// the dead reckoning skips advancing a core without input once a tick left it unchanged
+	CTestMap *pMap = new CTestMap(50, 30);
+	BuildArena(pMap);
+	CWorldCore *pWorld = new CWorldCore();
+
+	unsigned Seed = 1;
+	int NumResting = 0;
+	for(int i = 0; i < 200; i++)
+	{
+		Seed = Seed*1103515245+12345;
+		CCharacterCore Core;
+		Core.Reset();
+		mem_zero(&Core.m_Input, sizeof(Core.m_Input));
+		Core.Init(pWorld, &pMap->m_Collision);
+		Core.m_Pos = vec2(64.0f+(Seed>>8)%1400, 64.0f+(Seed>>16)%800);
+		Core.m_Vel = vec2((int)((Seed>>4)%41)-20, (int)((Seed>>12)%41)-20);
+		Core.m_Direction = (int)((Seed>>20)%3)-1;
+		Core.Quantize();
+
+		CNetObj_CharacterCore Last;
+		mem_zero(&Last, sizeof(Last));
+		Core.Write(&Last);
+		int RestTick = -1;
+		for(int Tick = 0; Tick < 500; Tick++)
+		{
+			Core.Tick(false);
+			Core.Move();
+			Core.Quantize();
+
+			CNetObj_CharacterCore Obj;
+			mem_zero(&Obj, sizeof(Obj));
+			Core.Write(&Obj);
+			bool Same = mem_comp(&Obj, &Last, sizeof(Obj)) == 0;
+			if(RestTick == -1 && Same)
+			{
+				RestTick = Tick;
+			}
+			else if(RestTick != -1)
+			{
+				ASSERT_TRUE(Same);
+			}
+			Last = Obj;
+		}
+		NumResting += RestTick != -1;
+	}
+	// tees standing on the ground or pushing against a wall
+	EXPECT_GT(NumResting, 50);
+
+	delete pWorld;
+	delete pMap;
+}
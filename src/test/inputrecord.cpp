@@ -0,0 +1,261 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <engine/storage.h>
+#include <engine/shared/inputrecord.h>
+#include <game/gamecore.h>
+
+#include "testmap.h"
+
+TEST(InputRecord, RoundTrip)
+{
+	CTestInfo Info;
+	IStorage *pStorage = CreateTestStorage();
+
+	CInputRecorder Recorder;
+	ASSERT_EQ(Recorder.Start(pStorage, Info.m_aFilename, "dm1", 0xf2159e6e, 0x12345678), 0);
+	EXPECT_TRUE(Recorder.IsRecording());
+
+	int aInput[128] = {0};
+	aInput[0] = -1;
+	aInput[1] = 300;
+	aInput[9] = 7;
+	int aSnapped[3] = {1, (int)0x80000001u, 0};
+	const char aMessage[] = {0x12, 0x34, 0x00, 0x56};
+
+	Recorder.RecordConnect(3, true);
+	Recorder.RecordEnter(3);
+	Recorder.RecordTick(17);
+	Recorder.RecordInput(CInputRecord::PREDICTED_INPUT, 3, aInput, 128);
+	Recorder.RecordGameTick();
+	Recorder.RecordChecksum(0xdeadbeef);
+	Recorder.RecordSnap(aSnapped, 3);
+	Recorder.RecordMessage(3, aMessage, sizeof(aMessage));
+	Recorder.RecordDrop(3, "timeout", false);
+	EXPECT_EQ(Recorder.Stop(), 0);
+
+	CInputRecordPlayer Player;
+	ASSERT_EQ(Player.Load(pStorage, Info.m_aFilename), 0);
+	EXPECT_STREQ(Player.MapName(), "dm1");
+	EXPECT_EQ(Player.MapCrc(), 0xf2159e6eu);
+	EXPECT_EQ(Player.Seed(), 0x12345678u);
+
+	CInputRecord Record;
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::CONNECT);
+	EXPECT_EQ(Record.m_ClientID, 3);
+	EXPECT_EQ(Record.GetInt(0), 1);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::ENTER);
+	EXPECT_EQ(Record.m_Size, 0);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::TICK);
+	EXPECT_EQ(Record.GetInt(0), 17);
+
+	// trailing zeros of the input buffer are left out
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::PREDICTED_INPUT);
+	EXPECT_EQ(Record.NumInts(), 10);
+	EXPECT_EQ(Record.GetInt(0), -1);
+	EXPECT_EQ(Record.GetInt(1), 300);
+	EXPECT_EQ(Record.GetInt(9), 7);
+	EXPECT_EQ(Record.GetInt(10), 0);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::GAMETICK);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::CHECKSUM);
+	EXPECT_EQ((unsigned)Record.GetInt(0), 0xdeadbeefu);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::SNAP);
+	EXPECT_EQ(Record.NumInts(), 3);
+	EXPECT_EQ((unsigned)Record.GetInt(1), 0x80000001u);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::MESSAGE);
+	ASSERT_EQ(Record.m_Size, (int)sizeof(aMessage));
+	EXPECT_EQ(mem_comp(Record.m_aData, aMessage, sizeof(aMessage)), 0);
+
+	ASSERT_TRUE(Player.NextRecord(&Record));
+	EXPECT_EQ(Record.m_Type, CInputRecord::DROP);
+	EXPECT_EQ(Record.GetInt(0), 0);
+	EXPECT_STREQ(Record.GetString(4), "timeout");
+
+	EXPECT_FALSE(Player.NextRecord(&Record));
+	Player.Stop();
+
+	// other files are refused
+	IOHANDLE File = pStorage->OpenFile(Info.m_aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, "not a recording, but long enough to hold a header of one.........", 64);
+	io_close(File);
+	EXPECT_EQ(Player.Load(pStorage, Info.m_aFilename), -1);
+
+	fs_remove(Info.m_aFilename);
+}
+
+// tees on an empty map, driven by the inputs of a recording
+class CReplayGame : public IInputReplayHandler
+{
+	enum
+	{
+		MAX_TEES=4,
+	};
+
+	CTestMap m_Map;
+	CWorldCore m_World;
+	CCharacterCore m_aCores[MAX_TEES];
+	bool m_aConnected[MAX_TEES];
+
+public:
+	int m_NumGameTicks;
+
+	CReplayGame() : m_Map(40, 30)
+	{
+		for(int x = 0; x < m_Map.Width(); x++)
+			m_Map.SetTile(x, m_Map.Height()-1, TILE_SOLID);
+		m_Map.InitCollision();
+		mem_zero(m_aConnected, sizeof(m_aConnected));
+		m_NumGameTicks = 0;
+	}
+
+	void Connect(int ClientID)
+	{
+		m_aCores[ClientID].Reset();
+		mem_zero(&m_aCores[ClientID].m_Input, sizeof(m_aCores[ClientID].m_Input));
+		m_aCores[ClientID].Init(&m_World, &m_Map.m_Collision);
+		m_aCores[ClientID].m_Pos = vec2(300.0f+ClientID*100.0f, 400.0f);
+		m_World.SetCharacter(ClientID, &m_aCores[ClientID]);
+		m_aConnected[ClientID] = true;
+	}
+
+	void SetInput(int ClientID, const int *pData, int Num)
+	{
+		mem_zero(&m_aCores[ClientID].m_Input, sizeof(m_aCores[ClientID].m_Input));
+		mem_copy(&m_aCores[ClientID].m_Input, pData, min(Num*4, (int)sizeof(m_aCores[ClientID].m_Input)));
+	}
+
+	virtual void OnReplayTick(int Tick) {}
+
+	virtual void OnReplayGameTick()
+	{
+		for(int i = 0; i < MAX_TEES; i++)
+			if(m_aConnected[i])
+				m_aCores[i].Tick(true);
+		for(int i = 0; i < MAX_TEES; i++)
+			if(m_aConnected[i])
+			{
+				m_aCores[i].Move();
+				m_aCores[i].Quantize();
+			}
+		m_NumGameTicks++;
+	}
+
+	virtual unsigned ReplayChecksum()
+	{
+		unsigned Checksum = 2166136261u;
+		for(int i = 0; i < MAX_TEES; i++)
+		{
+			if(!m_aConnected[i])
+				continue;
+			CNetObj_CharacterCore Core;
+			mem_zero(&Core, sizeof(Core));
+			m_aCores[i].Write(&Core);
+			const unsigned char *pData = (const unsigned char *)&Core;
+			for(unsigned b = 0; b < sizeof(Core); b++)
+				Checksum = (Checksum^pData[b])*16777619u;
+		}
+		return Checksum;
+	}
+
+	virtual void OnReplayRecord(CInputRecord *pRecord)
+	{
+		if(pRecord->m_ClientID >= MAX_TEES)
+			return;
+		if(pRecord->m_Type == CInputRecord::CONNECT)
+			Connect(pRecord->m_ClientID);
+		else if(pRecord->m_Type == CInputRecord::PREDICTED_INPUT)
+		{
+			int aInput[CInputRecord::MAX_DATA_SIZE/4];
+			for(int i = 0; i < pRecord->NumInts(); i++)
+				aInput[i] = pRecord->GetInt(i);
+			SetInput(pRecord->m_ClientID, aInput, pRecord->NumInts());
+		}
+	}
+};
+
+// plays a short game and records it, the input of one tee is recorded wrong at BadTick
+static void RecordGame(IStorage *pStorage, const char *pFilename, int NumTicks, int BadTick)
+{
+	CReplayGame *pGame = new CReplayGame();
+	CInputRecorder Recorder;
+	ASSERT_EQ(Recorder.Start(pStorage, pFilename, "test", 0, 1), 0);
+	for(int i = 0; i < 3; i++)
+	{
+		pGame->Connect(i);
+		Recorder.RecordConnect(i, false);
+		Recorder.RecordEnter(i);
+	}
+
+	unsigned Seed = 7;
+	for(int Tick = 1; Tick <= NumTicks; Tick++)
+	{
+		Recorder.RecordTick(Tick);
+		for(int i = 0; i < 3; i++)
+		{
+			CNetObj_PlayerInput Input;
+			mem_zero(&Input, sizeof(Input));
+			Seed = Seed*1103515245+12345;
+			Input.m_Direction = (int)((Seed>>16)%3)-1;
+			Input.m_Jump = (Seed>>8)%4 == 0;
+			Input.m_TargetX = (int)((Seed>>12)%400)-200;
+			Input.m_TargetY = -100;
+			pGame->SetInput(i, (const int *)&Input, sizeof(Input)/4);
+			if(Tick == BadTick && i == 1)
+				Input.m_Direction = Input.m_Direction ? -Input.m_Direction : 1;
+			Recorder.RecordInput(CInputRecord::PREDICTED_INPUT, i, (const int *)&Input, sizeof(Input)/4);
+		}
+		pGame->OnReplayGameTick();
+		Recorder.RecordGameTick();
+		Recorder.RecordChecksum(pGame->ReplayChecksum());
+	}
+	Recorder.Stop();
+	delete pGame;
+}
+
+TEST(InputRecord, Replay)
+{
+	CTestInfo Info;
+	IStorage *pStorage = CreateTestStorage();
+
+	// the same inputs give the same game
+	RecordGame(pStorage, Info.m_aFilename, 200, -1);
+	CInputRecordPlayer Player;
+	ASSERT_EQ(Player.Load(pStorage, Info.m_aFilename), 0);
+	CReplayGame *pGame = new CReplayGame();
+	CInputRecordPlayer::CReplayResult Result;
+	EXPECT_TRUE(Player.Replay(pGame, &Result));
+	EXPECT_EQ(Result.m_NumTicks, 200);
+	EXPECT_EQ(Result.m_DivergedTick, -1);
+	EXPECT_EQ(pGame->m_NumGameTicks, 200);
+	delete pGame;
+	Player.Stop();
+
+	// a game that did something else than the recording says is caught in that tick
+	RecordGame(pStorage, Info.m_aFilename, 200, 120);
+	ASSERT_EQ(Player.Load(pStorage, Info.m_aFilename), 0);
+	pGame = new CReplayGame();
+	EXPECT_FALSE(Player.Replay(pGame, &Result));
+	EXPECT_EQ(Result.m_DivergedTick, 120);
+	EXPECT_EQ(Result.m_NumTicks, 119);
+	EXPECT_NE(Result.m_RecordedChecksum, Result.m_ReplayedChecksum);
+	delete pGame;
+	Player.Stop();
+
+	fs_remove(Info.m_aFilename);
+}
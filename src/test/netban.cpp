@@ -0,0 +1,450 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+
+// exposes the ban pools without the console bindings of CNetBan::Init
+class CTestNetBan : public CNetBan
+{
+public:
+	CTestNetBan()
+	{
+		m_BanAddrPool.Reset();
+		m_BanRangePool.Reset();
+		mem_zero(m_aNegativeCache, sizeof(m_aNegativeCache));
+		mem_zero(&m_Info, sizeof(m_Info));
+		m_Info.m_Expires = CBanInfo::EXPIRES_NEVER;
+	}
+
+	bool AddAddr(const char *pAddr)
+	{
+		NETADDR Addr;
+		if(net_addr_from_str(&Addr, pAddr))
+			return false;
+		return m_BanAddrPool.Add(&Addr, &m_Info) != 0;
+	}
+
+	bool AddRange(const char *pLB, const char *pUB)
+	{
+		CNetRange Range;
+		if(net_addr_from_str(&Range.m_LB, pLB) || net_addr_from_str(&Range.m_UB, pUB))
+			return false;
+		return m_BanRangePool.Add(&Range, &m_Info) != 0;
+	}
+
+	bool RemoveRange(const char *pLB, const char *pUB)
+	{
+		CNetRange Range;
+		if(net_addr_from_str(&Range.m_LB, pLB) || net_addr_from_str(&Range.m_UB, pUB))
+			return false;
+		return m_BanRangePool.Remove(m_BanRangePool.Find(&Range)) == 0;
+	}
+
+	bool Banned(const char *pAddr)
+	{
+		NETADDR Addr;
+		if(net_addr_from_str(&Addr, pAddr))
+			return false;
+		return IsBanned(&Addr, 0, 0, 0);
+	}
+
+	// reference lookup by scanning all bans
+	bool BannedLinear(const NETADDR *pAddr)
+	{
+		for(CBanAddr *pBan = m_BanAddrPool.First(); pBan; pBan = pBan->m_pNext)
+			if(NetMatch(&pBan->m_Data, pAddr))
+				return true;
+		for(CBanRange *pBan = m_BanRangePool.First(); pBan; pBan = pBan->m_pNext)
+			if(NetMatch(&pBan->m_Data, pAddr))
+				return true;
+		return false;
+	}
+
+	typedef CBanAddr CAddrBan;
+	typedef CBanRange CRangeBan;
+	CBanAddrPool *AddrPool() { return &m_BanAddrPool; }
+	CBanRangePool *RangePool() { return &m_BanRangePool; }
+
+	CBanInfo m_Info;
+};
+
+TEST(NetBan, Addr)
+{
+	// too large for the stack
+	CTestNetBan *pBan = new CTestNetBan();
+	EXPECT_FALSE(pBan->Banned("1.2.3.4"));
+	EXPECT_TRUE(pBan->AddAddr("1.2.3.4"));
+	EXPECT_TRUE(pBan->Banned("1.2.3.4"));
+	EXPECT_TRUE(pBan->Banned("1.2.3.4:8303"));
+	EXPECT_FALSE(pBan->Banned("1.2.3.5"));
+	EXPECT_TRUE(pBan->AddAddr("[::1:2:3:4]"));
+	EXPECT_TRUE(pBan->Banned("[::1:2:3:4]"));
+	EXPECT_FALSE(pBan->Banned("[::1:2:3:5]"));
+	delete pBan;
+}
+
+TEST(NetBan, Range)
+{
+	// too large for the stack
+	CTestNetBan *pBan = new CTestNetBan();
+	EXPECT_TRUE(pBan->AddRange("10.0.0.0", "10.0.255.255"));
+	EXPECT_TRUE(pBan->AddRange("10.0.3.7", "10.0.9.1"));
+	EXPECT_TRUE(pBan->AddRange("192.168.1.10", "192.168.1.20"));
+
+	EXPECT_TRUE(pBan->Banned("10.0.42.1"));
+	EXPECT_FALSE(pBan->Banned("10.1.0.0"));
+	EXPECT_TRUE(pBan->Banned("192.168.1.10"));
+	EXPECT_TRUE(pBan->Banned("192.168.1.20"));
+	EXPECT_FALSE(pBan->Banned("192.168.1.21"));
+	EXPECT_FALSE(pBan->Banned("192.168.1.9"));
+
+	// the negative cache must not hide new bans
+	EXPECT_TRUE(pBan->AddRange("192.168.1.0", "192.168.1.9"));
+	EXPECT_TRUE(pBan->Banned("192.168.1.9"));
+
+	EXPECT_TRUE(pBan->RemoveRange("10.0.0.0", "10.0.255.255"));
+	EXPECT_FALSE(pBan->Banned("10.0.42.1"));
+	EXPECT_TRUE(pBan->Banned("10.0.5.0"));
+	EXPECT_TRUE(pBan->RemoveRange("10.0.3.7", "10.0.9.1"));
+	EXPECT_FALSE(pBan->Banned("10.0.5.0"));
+	delete pBan;
+}
+
+TEST(NetBan, RandomEquivalence)
+{
+	// too large for the stack
+	CTestNetBan *pBan = new CTestNetBan();
+
+	unsigned Seed = 1337;
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		Seed = Seed*1103515245+12345;
+		NETADDR LB = {0}, UB;
+		bool Ipv6 = (Seed>>16)&1;
+		LB.type = Ipv6 ? NETTYPE_IPV6 : NETTYPE_IPV4;
+		for(int i = 0; i < 16; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			// few distinct leading bytes to get shared prefixes
+			LB.ip[i] = i < 2 ? (Seed>>16)%3 : (Seed>>16)&0xff;
+		}
+		UB = LB;
+		Seed = Seed*1103515245+12345;
+		int Byte = (Ipv6 ? 16 : 4) - 1 - (Seed>>16)%3;
+		UB.ip[Byte] = LB.ip[Byte] + 1 + ((Seed>>20)%(255-LB.ip[Byte] > 0 ? 255-LB.ip[Byte] : 1));
+
+		CNetRange Range;
+		Range.m_LB = LB;
+		Range.m_UB = UB;
+		if(Range.IsValid() && !pBan->RangePool()->Find(&Range))
+			pBan->RangePool()->Add(&Range, &pBan->m_Info);
+
+		// remove some again to exercise node merging
+		if(Round%3 == 0 && pBan->RangePool()->First())
+			pBan->RangePool()->Remove(pBan->RangePool()->First());
+
+		for(int Probe = 0; Probe < 8; Probe++)
+		{
+			NETADDR Addr = LB;
+			Seed = Seed*1103515245+12345;
+			Addr.ip[Byte] = (Seed>>16)&0xff;
+			EXPECT_EQ(pBan->IsBanned(&Addr, 0, 0, 0), pBan->BannedLinear(&Addr));
+		}
+	}
+	delete pBan;
+}
+
+TEST(NetBan, Shared)
+{
+	char aName[64];
+	str_format(aName, sizeof(aName), "test-netban-%d", pid());
+
+	// two servers on the same table
+	CNetBanShared *pFirst = new CNetBanShared();
+	CNetBanShared *pSecond = new CNetBanShared();
+	ASSERT_TRUE(pFirst->Attach(aName));
+	ASSERT_TRUE(pSecond->Attach(aName));
+	shm_remove(aName);
+
+	NETADDR Addr;
+	CNetRange Range;
+	CNetBanShared::CEntry Entry;
+	net_addr_from_str(&Addr, "1.2.3.4");
+	net_addr_from_str(&Range.m_LB, "10.0.0.0");
+	net_addr_from_str(&Range.m_UB, "10.0.255.255");
+
+	unsigned Sequence = pSecond->Sequence();
+	EXPECT_EQ(pFirst->Ban(&Addr, 1000, "first"), 0);
+	EXPECT_EQ(pFirst->Ban(&Range, -1, "range"), 0);
+	EXPECT_NE(pSecond->Sequence(), Sequence);
+	EXPECT_GE(pSecond->Match(&Addr, 0, &Entry), 0);
+	EXPECT_STREQ(Entry.m_aReason, "first");
+	EXPECT_EQ(pSecond->Ban(&Addr, -1, "second"), 1);
+	EXPECT_TRUE(pFirst->Find(&Addr, &Entry));
+	EXPECT_STREQ(Entry.m_aReason, "second");
+
+	net_addr_from_str(&Addr, "10.0.42.1");
+	EXPECT_GE(pSecond->Match(&Addr, 0, &Entry), 0);
+	EXPECT_TRUE(Entry.IsRange());
+	EXPECT_EQ(pFirst->Unban(&Range), 0);
+	EXPECT_LT(pSecond->Match(&Addr, 0, &Entry), 0);
+
+	// removals keep the remaining entries reachable
+	for(int i = 0; i < 1000; i++)
+	{
+		Addr.ip[2] = i/256;
+		Addr.ip[3] = i%256;
+		EXPECT_EQ(pFirst->Ban(&Addr, i%2 ? 100 : -1, "many"), 0);
+	}
+	EXPECT_EQ(pSecond->Num(), 1001);
+	CNetBanShared::CEntry aExpired[1024];
+	EXPECT_EQ(pSecond->Expire(200, aExpired, 1024), 500);
+	for(int i = 0; i < 1000; i++)
+	{
+		Addr.ip[2] = i/256;
+		Addr.ip[3] = i%256;
+		EXPECT_EQ(pFirst->Match(&Addr, 200, &Entry) >= 0, i%2 == 0);
+	}
+	pSecond->Reset();
+	EXPECT_EQ(pFirst->Num(), 0);
+
+	delete pFirst;
+	delete pSecond;
+}
+
+TEST(NetBan, SharedRanges)
+{
+	char aName[64];
+	str_format(aName, sizeof(aName), "test-netban-ranges-%d", pid());
+	CNetBanShared *pShared = new CNetBanShared();
+	ASSERT_TRUE(pShared->Attach(aName));
+	shm_remove(aName);
+
+	// overlapping and nested ranges, checked against a plain scan
+	CNetRange aRanges[CNetBanShared::MAX_RANGE_BANS];
+	int NumRanges = 0;
+	unsigned Seed = 4242;
+	for(int Round = 0; Round < 3000; Round++)
+	{
+		Seed = Seed*1103515245+12345;
+		if(Round%4 == 3 && NumRanges > 0)
+		{
+			int Remove = (Seed>>16)%NumRanges;
+			EXPECT_EQ(pShared->Unban(&aRanges[Remove]), 0);
+			aRanges[Remove] = aRanges[--NumRanges];
+		}
+		else if(NumRanges < CNetBanShared::MAX_RANGE_BANS)
+		{
+			CNetRange Range;
+			mem_zero(&Range, sizeof(Range));
+			Range.m_LB.type = Range.m_UB.type = (Seed>>24)&1 ? NETTYPE_IPV6 : NETTYPE_IPV4;
+			int Last = Range.m_LB.type == NETTYPE_IPV4 ? 3 : 15;
+			Seed = Seed*1103515245+12345;
+			Range.m_LB.ip[Last-1] = (Seed>>16)%8;
+			Range.m_LB.ip[Last] = (Seed>>20)&0xff;
+			Range.m_UB = Range.m_LB;
+			Seed = Seed*1103515245+12345;
+			int Length = 1+(Seed>>16)%600;
+			int UB = Range.m_LB.ip[Last-1]*256+Range.m_LB.ip[Last]+Length;
+			Range.m_UB.ip[Last-1] = UB/256;
+			Range.m_UB.ip[Last] = UB%256;
+			if(pShared->Ban(&Range, -1, "range") == 0)
+				aRanges[NumRanges++] = Range;
+		}
+
+		for(int Probe = 0; Probe < 8; Probe++)
+		{
+			NETADDR Addr;
+			mem_zero(&Addr, sizeof(Addr));
+			Seed = Seed*1103515245+12345;
+			Addr.type = (Seed>>24)&1 ? NETTYPE_IPV6 : NETTYPE_IPV4;
+			int Last = Addr.type == NETTYPE_IPV4 ? 3 : 15;
+			Addr.ip[Last-1] = (Seed>>16)%11;
+			Addr.ip[Last] = (Seed>>8)&0xff;
+
+			bool Banned = false;
+			for(int i = 0; i < NumRanges && !Banned; i++)
+				Banned = aRanges[i].m_LB.type == Addr.type && mem_comp(aRanges[i].m_LB.ip, Addr.ip, 16) <= 0 && mem_comp(aRanges[i].m_UB.ip, Addr.ip, 16) >= 0;
+			CNetBanShared::CEntry Entry;
+			EXPECT_EQ(pShared->Match(&Addr, 0, &Entry) >= 0, Banned);
+		}
+	}
+	EXPECT_EQ(pShared->Num(), NumRanges);
+
+	// a merge that doesn't fit leaves the table alone
+	pShared->Reset();
+	CNetBanShared::CEntry *pEntries = new CNetBanShared::CEntry[CNetBanShared::MAX_RANGE_BANS+1];
+	for(int i = 0; i <= CNetBanShared::MAX_RANGE_BANS; i++)
+	{
+		mem_zero(&pEntries[i], sizeof(pEntries[i]));
+		net_addr_from_str(&pEntries[i].m_LB, "10.0.0.0");
+		pEntries[i].m_LB.ip[2] = i/256;
+		pEntries[i].m_LB.ip[3] = i%256;
+		pEntries[i].m_UB = pEntries[i].m_LB;
+		pEntries[i].m_UB.ip[1] = 1;
+		pEntries[i].m_Expires = -1;
+	}
+	EXPECT_EQ(pShared->Merge(pEntries, CNetBanShared::MAX_RANGE_BANS+1), -1);
+	EXPECT_EQ(pShared->Num(), 0);
+	EXPECT_EQ(pShared->Merge(pEntries, CNetBanShared::MAX_RANGE_BANS), (int)CNetBanShared::MAX_RANGE_BANS);
+	EXPECT_EQ(pShared->Merge(pEntries, 16), 0);
+	EXPECT_EQ(pShared->Num(), (int)CNetBanShared::MAX_RANGE_BANS);
+	delete[] pEntries;
+
+	delete pShared;
+}
+
+// a banlist with its own console like on a server
+static CTestNetBan *CreateBanlist(IConsole **ppConsole, IStorage *pStorage)
+{
+	*ppConsole = CreateConsole(CFGFLAG_SERVER);
+	CTestNetBan *pBan = new CTestNetBan();
+	pBan->Init(*ppConsole, pStorage);
+	return pBan;
+}
+
+static void DestroyBanlist(CTestNetBan *pBan, IConsole *pConsole)
+{
+	delete pBan;
+	delete pConsole;
+}
+
+TEST(NetBan, BinaryRoundTrip)
+{
+	CTestInfo Info;
+	IStorage *pStorage = CreateTestStorage();
+	IConsole *pConsole;
+	CTestNetBan *pBan = CreateBanlist(&pConsole, pStorage);
+
+	char aAddr[64], aReason[32];
+	for(int i = 0; i < 40; i++)
+	{
+		NETADDR Addr;
+		str_format(aAddr, sizeof(aAddr), i%2 ? "[2001:db8::%x]" : "10.1.2.%d", i+1);
+		str_format(aReason, sizeof(aReason), "reason %d", i);
+		ASSERT_EQ(net_addr_from_str(&Addr, aAddr), 0);
+		EXPECT_EQ(pBan->BanAddr(&Addr, i%5 ? i*60 : 0, aReason), 0);
+	}
+	for(int i = 0; i < 10; i++)
+	{
+		CNetRange Range;
+		str_format(aAddr, sizeof(aAddr), "192.168.%d.0", i);
+		net_addr_from_str(&Range.m_LB, aAddr);
+		str_format(aAddr, sizeof(aAddr), "192.168.%d.255", i);
+		net_addr_from_str(&Range.m_UB, aAddr);
+		EXPECT_EQ(pBan->BanRange(&Range, i%2 ? 0 : 3600, "range"), 0);
+	}
+	EXPECT_EQ(pBan->SaveBinary(Info.m_aFilename), 50);
+
+	IConsole *pLoadConsole;
+	CTestNetBan *pLoaded = CreateBanlist(&pLoadConsole, pStorage);
+	EXPECT_EQ(pLoaded->LoadBinary(Info.m_aFilename), 50);
+
+	// same bans with the same expiry and reason
+	EXPECT_EQ(pLoaded->AddrPool()->Num(), pBan->AddrPool()->Num());
+	for(CTestNetBan::CAddrBan *p = pBan->AddrPool()->First(); p; p = p->m_pNext)
+	{
+		CTestNetBan::CAddrBan *pFound = pLoaded->AddrPool()->Find(&p->m_Data);
+		ASSERT_TRUE(pFound);
+		EXPECT_EQ(pFound->m_Info.m_Expires, p->m_Info.m_Expires);
+		EXPECT_STREQ(pFound->m_Info.m_aReason, p->m_Info.m_aReason);
+	}
+	EXPECT_EQ(pLoaded->RangePool()->Num(), pBan->RangePool()->Num());
+	for(CTestNetBan::CRangeBan *p = pBan->RangePool()->First(); p; p = p->m_pNext)
+	{
+		CTestNetBan::CRangeBan *pFound = pLoaded->RangePool()->Find(&p->m_Data);
+		ASSERT_TRUE(pFound);
+		EXPECT_EQ(pFound->m_Info.m_Expires, p->m_Info.m_Expires);
+	}
+	EXPECT_TRUE(pLoaded->Banned("192.168.7.42"));
+
+	// broken files are refused
+	IOHANDLE File = pStorage->OpenFile(Info.m_aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, "TWBL", 4);
+	io_close(File);
+	EXPECT_EQ(pLoaded->LoadBinary(Info.m_aFilename), -1);
+
+	fs_remove(Info.m_aFilename);
+	DestroyBanlist(pBan, pConsole);
+	DestroyBanlist(pLoaded, pLoadConsole);
+}
+
+TEST(NetBan, Journal)
+{
+	CTestInfo Info;
+	char aJournal[128], aCommand[256];
+	str_format(aJournal, sizeof(aJournal), "%s.journal", Info.m_aFilename);
+	IStorage *pStorage = CreateTestStorage();
+	IConsole *pConsole;
+	CTestNetBan *pBan = CreateBanlist(&pConsole, pStorage);
+	str_format(aCommand, sizeof(aCommand), "ban_journal %s", aJournal);
+	pConsole->ExecuteLine(aCommand);
+
+	NETADDR aAddr[4];
+	for(int i = 0; i < 4; i++)
+	{
+		char aBuf[32];
+		str_format(aBuf, sizeof(aBuf), "1.2.3.%d", i+1);
+		net_addr_from_str(&aAddr[i], aBuf);
+	}
+	CNetRange Range;
+	net_addr_from_str(&Range.m_LB, "10.0.0.0");
+	net_addr_from_str(&Range.m_UB, "10.0.255.255");
+	pBan->BanAddr(&aAddr[0], 600, "first");
+	pBan->BanAddr(&aAddr[1], 0, "second");
+	pBan->BanRange(&Range, 0, "range");
+	pBan->UnbanByAddr(&aAddr[1]);
+	pBan->BanAddr(&aAddr[2], 0, "third");
+
+	// crashed without saving, the journal is read while it is still open
+	IConsole *pReplayConsole;
+	CTestNetBan *pReplay = CreateBanlist(&pReplayConsole, pStorage);
+	EXPECT_EQ(pReplay->LoadBinary(aJournal), 4);
+	EXPECT_TRUE(pReplay->Banned("1.2.3.1"));
+	EXPECT_FALSE(pReplay->Banned("1.2.3.2"));
+	EXPECT_TRUE(pReplay->Banned("1.2.3.3"));
+	EXPECT_TRUE(pReplay->Banned("10.0.42.1"));
+	EXPECT_STREQ(pReplay->AddrPool()->Find(&aAddr[0])->m_Info.m_aReason, "first");
+	DestroyBanlist(pReplay, pReplayConsole);
+
+	// saving to another file leaves the journal alone
+	EXPECT_EQ(pBan->SaveBinary(Info.m_aFilename), 3);
+	pBan->UnbanByAddr(&aAddr[0]);
+	pBan->BanAddr(&aAddr[3], 0, "fourth");
+
+	// the saved banlist has the bans from before
+	pReplay = CreateBanlist(&pReplayConsole, pStorage);
+	EXPECT_EQ(pReplay->LoadBinary(Info.m_aFilename), 3);
+	EXPECT_TRUE(pReplay->Banned("1.2.3.1"));
+	EXPECT_FALSE(pReplay->Banned("1.2.3.4"));
+	DestroyBanlist(pReplay, pReplayConsole);
+
+	// the journal alone still replays every ban
+	pReplay = CreateBanlist(&pReplayConsole, pStorage);
+	EXPECT_EQ(pReplay->LoadBinary(aJournal), 5);
+	EXPECT_FALSE(pReplay->Banned("1.2.3.1"));
+	EXPECT_FALSE(pReplay->Banned("1.2.3.2"));
+	EXPECT_TRUE(pReplay->Banned("1.2.3.3"));
+	EXPECT_TRUE(pReplay->Banned("1.2.3.4"));
+	EXPECT_TRUE(pReplay->Banned("10.0.42.1"));
+	DestroyBanlist(pReplay, pReplayConsole);
+
+	// compacting the journal into itself keeps it usable
+	EXPECT_EQ(pBan->SaveBinary(aJournal), 3);
+	pBan->UnbanAll();
+	pReplay = CreateBanlist(&pReplayConsole, pStorage);
+	EXPECT_EQ(pReplay->LoadBinary(aJournal), 3);
+	EXPECT_EQ(pReplay->AddrPool()->Num()+pReplay->RangePool()->Num(), 0);
+	DestroyBanlist(pReplay, pReplayConsole);
+
+	pConsole->ExecuteLine("ban_journal \"\"");
+	DestroyBanlist(pBan, pConsole);
+	fs_remove(aJournal);
+	fs_remove(Info.m_aFilename);
+}
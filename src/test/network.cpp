@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/network.h>
+
+TEST(Network, ConnlessLimiter)
+{
+	CNetConnlessLimiter *pLimiter = new CNetConnlessLimiter();
+	pLimiter->Init();
+	pLimiter->SetRates(10, 50);
+
+	NETADDR Addr;
+	net_addr_from_str(&Addr, "1.2.3.4");
+	int64 Now = time_freq()*100;
+
+	// one network gets its burst, then is limited to its rate
+	int Admitted = 0;
+	for(int i = 0; i < 100; i++)
+		Admitted += pLimiter->Admit(&Addr, Now);
+	EXPECT_EQ(Admitted, 20);
+	Addr.ip[3] = 5;
+	EXPECT_FALSE(pLimiter->Admit(&Addr, Now));
+	EXPECT_TRUE(pLimiter->Admit(&Addr, Now+time_freq()/10));
+
+	// other networks are not affected, until the global limit is hit
+	Admitted = 0;
+	for(int i = 0; i < 100; i++)
+	{
+		Addr.ip[2] = i;
+		Admitted += pLimiter->Admit(&Addr, Now+time_freq()/10);
+	}
+	// 1.2.3.x is still empty, 84 global tokens are left for the rest
+	EXPECT_EQ(Admitted, 84);
+	EXPECT_EQ(pLimiter->NumDroppedPrefix(), 82);
+	EXPECT_EQ(pLimiter->NumDroppedGlobal(), 15);
+
+	pLimiter->SetRates(0, 0);
+	EXPECT_TRUE(pLimiter->Admit(&Addr, Now+time_freq()/10));
+	delete pLimiter;
+}
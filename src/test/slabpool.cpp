@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/slabpool.h>
+
+TEST(SlabPool, Reuse)
+{
+	CSlabPool Pool("test", 40, 4);
+	void *apSlots[10];
+	for(int i = 0; i < 10; i++)
+	{
+		apSlots[i] = Pool.Allocate();
+		ASSERT_TRUE(apSlots[i] != 0);
+		// slots are aligned and don't overlap
+		EXPECT_EQ((size_t)apSlots[i]%16, 0u);
+		mem_zero(apSlots[i], 40);
+	}
+	EXPECT_EQ(Pool.SlotSize(), 48u);
+	EXPECT_EQ(Pool.NumSlabs(), 3);
+	EXPECT_EQ(Pool.NumUsed(), 10);
+	// one slab is contiguous
+	EXPECT_EQ((char *)apSlots[1]-(char *)apSlots[0], 48);
+
+	// released slots get handed out first
+	Pool.Free(apSlots[3]);
+	Pool.Free(apSlots[7]);
+	EXPECT_EQ(Pool.NumUsed(), 8);
+	EXPECT_EQ(Pool.Allocate(), apSlots[7]);
+	EXPECT_EQ(Pool.Allocate(), apSlots[3]);
+	EXPECT_EQ(Pool.NumSlabs(), 3);
+	EXPECT_EQ(Pool.PeakUsed(), 10);
+	EXPECT_EQ(Pool.NumAllocs(), 12);
+
+	for(int i = 0; i < 10; i++)
+		Pool.Free(apSlots[i]);
+	EXPECT_EQ(Pool.NumUsed(), 0);
+}
+
+TEST(SlabPool, Registry)
+{
+	CSlabPool First("first", 8, 1);
+	bool Found = false;
+	{
+		CSlabPool Second("second", 8, 1);
+		for(const CSlabPool *pPool = CSlabPool::First(); pPool; pPool = pPool->Next())
+			Found |= pPool == &Second;
+		EXPECT_TRUE(Found);
+	}
+	Found = false;
+	for(const CSlabPool *pPool = CSlabPool::First(); pPool; pPool = pPool->Next())
+		Found |= str_comp(pPool->Name(), "second") == 0;
+	EXPECT_FALSE(Found);
+}
+
+TEST(SlabPool, Poison)
+{
+	CSlabPool Pool("poison", 32, 2);
+	Pool.SetPoison(true);
+	unsigned char *pSlot = (unsigned char *)Pool.Allocate();
+	mem_zero(pSlot, 32);
+	Pool.Free(pSlot);
+	// everything behind the free list link gets overwritten
+	for(unsigned i = sizeof(void *); i < 32; i++)
+		EXPECT_EQ(pSlot[i], 0xdd);
+	EXPECT_EQ(Pool.Allocate(), pSlot);
+	Pool.Free(pSlot);
+}
@@ -0,0 +1,312 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+#include <game/spatialgrid.h>
+
+struct CGridItem
+{
+	vec2 m_Pos;
+	float m_ProximityRadius;
+	CSpatialGrid<CGridItem>::CNode m_Node;
+	CGridItem *m_pPrev;
+	CGridItem *m_pNext;
+	bool m_InList;
+
+	const vec2 &GetPos() const { return m_Pos; }
+	float GetProximityRadius() const { return m_ProximityRadius; }
+};
+
+// items kept in a grid and in a list that gets new items put in front, like the game world does
+class CGridWorld
+{
+public:
+	CSpatialGrid<CGridItem> m_Grid;
+	CGridItem *m_paItems;
+	int m_NumItems;
+	CGridItem *m_pFirst;
+	float m_MaxProximityRadius;
+	float m_Raster;
+	unsigned m_Seed;
+
+	float Random(float Max)
+	{
+		m_Seed = m_Seed*1103515245+12345;
+		return ((m_Seed>>8)&0xffff)/65536.0f*Max;
+	}
+
+	// on a coarse raster so items at the same distance are common
+	vec2 RandomPos() { return vec2((int)Random(100)*m_Raster, (int)Random(50)*m_Raster); }
+
+	void Insert(CGridItem *pItem)
+	{
+		pItem->m_pPrev = 0;
+		pItem->m_pNext = m_pFirst;
+		if(m_pFirst)
+			m_pFirst->m_pPrev = pItem;
+		m_pFirst = pItem;
+		pItem->m_InList = true;
+		m_Grid.Insert(&pItem->m_Node, pItem, pItem->m_Pos);
+	}
+
+	void Remove(CGridItem *pItem)
+	{
+		if(pItem->m_pPrev)
+			pItem->m_pPrev->m_pNext = pItem->m_pNext;
+		else
+			m_pFirst = pItem->m_pNext;
+		if(pItem->m_pNext)
+			pItem->m_pNext->m_pPrev = pItem->m_pPrev;
+		pItem->m_InList = false;
+		m_Grid.Remove(&pItem->m_Node);
+	}
+
+	CGridWorld(int NumItems, float Raster, float ProximityRadius, unsigned Seed)
+	{
+		m_paItems = new CGridItem[NumItems];
+		m_NumItems = NumItems;
+		m_Seed = Seed;
+		m_pFirst = 0;
+		m_MaxProximityRadius = ProximityRadius;
+		m_Raster = Raster;
+		for(int i = 0; i < NumItems; i++)
+		{
+			m_paItems[i].m_Pos = RandomPos();
+			m_paItems[i].m_ProximityRadius = ProximityRadius;
+			Insert(&m_paItems[i]);
+		}
+	}
+
+	~CGridWorld() { delete[] m_paItems; }
+
+	void Update()
+	{
+		for(int i = 0; i < m_NumItems; i++)
+		{
+			CGridItem *pItem = &m_paItems[i];
+			int Action = (int)Random(10);
+			if(Action == 0)
+			{
+				// destroyed and spawned again
+				if(pItem->m_InList)
+					Remove(pItem);
+				else
+					Insert(pItem);
+			}
+			else if(Action < 4 && pItem->m_InList)
+			{
+				pItem->m_Pos = RandomPos();
+				m_Grid.Move(&pItem->m_Node, pItem->m_Pos);
+			}
+		}
+	}
+
+	// the list walks CGameWorld did before the grid
+	int FindList(vec2 Pos, float Radius, CGridItem **ppItems, int Max)
+	{
+		int Num = 0;
+		for(CGridItem *pItem = m_pFirst; pItem; pItem = pItem->m_pNext)
+		{
+			if(distance(pItem->m_Pos, Pos) < Radius+pItem->m_ProximityRadius)
+			{
+				if(ppItems)
+					ppItems[Num] = pItem;
+				Num++;
+				if(Num == Max)
+					break;
+			}
+		}
+		return Num;
+	}
+
+	CGridItem *ClosestList(vec2 Pos, float Radius, CGridItem *pNotThis)
+	{
+		float ClosestRange = Radius*2;
+		CGridItem *pClosest = 0;
+		for(CGridItem *p = m_pFirst; p; p = p->m_pNext)
+		{
+			if(p == pNotThis)
+				continue;
+			float Len = distance(Pos, p->m_Pos);
+			if(Len < p->m_ProximityRadius+Radius && Len < ClosestRange)
+			{
+				ClosestRange = Len;
+				pClosest = p;
+			}
+		}
+		return pClosest;
+	}
+
+	CGridItem *IntersectList(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, CGridItem *pNotThis)
+	{
+		float ClosestLen = distance(Pos0, Pos1) * 100.0f;
+		CGridItem *pClosest = 0;
+		for(CGridItem *p = m_pFirst; p; p = p->m_pNext)
+		{
+			if(p == pNotThis)
+				continue;
+			vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
+			float Len = distance(p->m_Pos, IntersectPos);
+			if(Len < p->m_ProximityRadius+Radius)
+			{
+				Len = distance(Pos0, IntersectPos);
+				if(Len < ClosestLen)
+				{
+					NewPos = IntersectPos;
+					ClosestLen = Len;
+					pClosest = p;
+				}
+			}
+		}
+		return pClosest;
+	}
+};
+
+TEST(SpatialGrid, SameAsList)
+{
+	CGridWorld *pWorld = new CGridWorld(600, 16.0f, 28.0f, 1);
+	for(int i = 0; i < pWorld->m_NumItems; i += 3)
+		pWorld->m_paItems[i].m_ProximityRadius = 0.0f;
+	CGridItem *apGrid[64];
+	CGridItem *apList[64];
+	int NumTruncated = 0;
+	int NumTies = 0;
+	for(int Tick = 0; Tick < 30; Tick++)
+	{
+		pWorld->Update();
+		for(int i = 0; i < 200; i++)
+		{
+			vec2 Pos = pWorld->RandomPos();
+			float Radius = pWorld->Random(400.0f);
+			int Max = 1+(int)pWorld->Random(63);
+
+			// same entities in the same order, also when cut off at Max
+			int Num = pWorld->m_Grid.Find(Pos, Radius, pWorld->m_MaxProximityRadius, apGrid, Max);
+			ASSERT_EQ(Num, pWorld->FindList(Pos, Radius, apList, Max));
+			for(int k = 0; k < Num; k++)
+				ASSERT_EQ(apGrid[k], apList[k]);
+			EXPECT_EQ(pWorld->m_Grid.Find(Pos, Radius, pWorld->m_MaxProximityRadius, 0, Max), Num);
+			NumTruncated += Num == Max;
+
+			CGridItem *pNotThis = Num ? apList[0] : 0;
+			CGridItem *pClosest = pWorld->ClosestList(Pos, Radius, pNotThis);
+			EXPECT_EQ(pWorld->m_Grid.Closest(Pos, Radius, pWorld->m_MaxProximityRadius, pNotThis), pClosest);
+
+			vec2 Pos1 = Pos+vec2(pWorld->Random(800.0f)-400.0f, pWorld->Random(800.0f)-400.0f);
+			vec2 GridPos = vec2(-1, -1);
+			vec2 ListPos = vec2(-1, -1);
+			CGridItem *pHit = pWorld->IntersectList(Pos, Pos1, 6.0f, ListPos, pNotThis);
+			EXPECT_EQ(pWorld->m_Grid.Intersect(Pos, Pos1, 6.0f, pWorld->m_MaxProximityRadius, &GridPos, pNotThis), pHit);
+			EXPECT_TRUE(GridPos == ListPos);
+
+			// another candidate at the same distance, the list order decides
+			if(pClosest)
+			{
+				for(int k = 0; k < pWorld->m_NumItems; k++)
+				{
+					CGridItem *p = &pWorld->m_paItems[k];
+					if(p != pClosest && p != pNotThis && p->m_InList && p->m_Pos == pClosest->m_Pos)
+					{
+						NumTies++;
+						break;
+					}
+				}
+			}
+		}
+	}
+	// the raster makes both cases common
+	EXPECT_GT(NumTruncated, 100);
+	EXPECT_GT(NumTies, 100);
+
+	// removed items are not found anymore
+	int NumLeft = 0;
+	for(int i = 0; i < pWorld->m_NumItems; i++)
+	{
+		if(pWorld->m_paItems[i].m_InList && i%2)
+			pWorld->Remove(&pWorld->m_paItems[i]);
+		NumLeft += pWorld->m_paItems[i].m_InList;
+	}
+	EXPECT_EQ(pWorld->m_Grid.Find(vec2(0, 0), 100000.0f, pWorld->m_MaxProximityRadius, 0, CSpatialGrid<CGridItem>::MAX_FOUND), min(NumLeft, (int)CSpatialGrid<CGridItem>::MAX_FOUND));
+	delete pWorld;
+}
+
+// not part of the unit run, start it with
+// testrunner --gtest_also_run_disabled_tests --gtest_filter=SpatialGrid.DISABLED_Benchmark
+TEST(SpatialGrid, DISABLED_Benchmark)
+{
+	// a busy fng scene on a 200x100 tile map: full server, projectiles everywhere
+	// and laser text made of many laser entities
+	CGridWorld *pCharacters = new CGridWorld(MAX_CLIENTS, 64.0f, 28.0f, 1);
+	CGridWorld *pProjectiles = new CGridWorld(1500, 64.0f, 0.0f, 2);
+	CGridWorld *pLasers = new CGridWorld(3000, 64.0f, 0.0f, 3);
+	CGridItem *apFound[CSpatialGrid<CGridItem>::MAX_FOUND];
+	vec2 *paSweepEnd = new vec2[pProjectiles->m_NumItems];
+	const int NumTicks = 100;
+	int aHits[2] = {0, 0};
+	int64 aTime[2] = {0, 0};
+
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+	{
+		pCharacters->Update();
+		pProjectiles->Update();
+		pLasers->Update();
+		for(int i = 0; i < pProjectiles->m_NumItems; i++)
+			paSweepEnd[i] = pProjectiles->m_paItems[i].m_Pos+vec2(pProjectiles->Random(80.0f)-40.0f, pProjectiles->Random(80.0f)-40.0f);
+
+		// the list walks and the grid on the same scene
+		for(int Pass = 0; Pass < 2; Pass++)
+		{
+			int64 Start = time_get();
+			// every projectile sweeps its path for a character, like IntersectCharacter
+			for(int i = 0; i < pProjectiles->m_NumItems; i++)
+			{
+				if(!pProjectiles->m_paItems[i].m_InList)
+					continue;
+				vec2 Pos0 = pProjectiles->m_paItems[i].m_Pos;
+				vec2 Pos1 = paSweepEnd[i];
+				vec2 NewPos;
+				if(Pass)
+					aHits[Pass] += pCharacters->m_Grid.Intersect(Pos0, Pos1, 6.0f, pCharacters->m_MaxProximityRadius, &NewPos, 0) != 0;
+				else
+					aHits[Pass] += pCharacters->IntersectList(Pos0, Pos1, 6.0f, NewPos, 0) != 0;
+			}
+
+			// hammer hits, pickups, explosions and the entities around every character
+			for(int i = 0; i < pCharacters->m_NumItems; i++)
+			{
+				CGridItem *pChr = &pCharacters->m_paItems[i];
+				if(!pChr->m_InList)
+					continue;
+				vec2 Pos = pChr->m_Pos;
+				if(Pass)
+				{
+					aHits[Pass] += pCharacters->m_Grid.Find(Pos, 14.0f, pCharacters->m_MaxProximityRadius, apFound, MAX_CLIENTS);
+					aHits[Pass] += pCharacters->m_Grid.Closest(Pos, 20.0f, pCharacters->m_MaxProximityRadius, pChr) != 0;
+					aHits[Pass] += pCharacters->m_Grid.Find(Pos, 135.0f, pCharacters->m_MaxProximityRadius, apFound, MAX_CLIENTS);
+					aHits[Pass] += pProjectiles->m_Grid.Find(Pos, 135.0f, pProjectiles->m_MaxProximityRadius, apFound, CSpatialGrid<CGridItem>::MAX_FOUND);
+					aHits[Pass] += pLasers->m_Grid.Find(Pos, 135.0f, pLasers->m_MaxProximityRadius, apFound, CSpatialGrid<CGridItem>::MAX_FOUND);
+				}
+				else
+				{
+					aHits[Pass] += pCharacters->FindList(Pos, 14.0f, apFound, MAX_CLIENTS);
+					aHits[Pass] += pCharacters->ClosestList(Pos, 20.0f, pChr) != 0;
+					aHits[Pass] += pCharacters->FindList(Pos, 135.0f, apFound, MAX_CLIENTS);
+					aHits[Pass] += pProjectiles->FindList(Pos, 135.0f, apFound, CSpatialGrid<CGridItem>::MAX_FOUND);
+					aHits[Pass] += pLasers->FindList(Pos, 135.0f, apFound, CSpatialGrid<CGridItem>::MAX_FOUND);
+				}
+			}
+			aTime[Pass] += time_get()-Start;
+		}
+	}
+
+	EXPECT_EQ(aHits[0], aHits[1]);
+	// the testrunner doesn't log by default
+	dbg_logger_stdout();
+	dbg_msg("spatialgrid", "%d ticks, %d hits: list %.2fms grid %.2fms", NumTicks, aHits[1],
+		aTime[0]*1000.0/time_freq(), aTime[1]*1000.0/time_freq());
+
+	delete[] paSweepEnd;
+	delete pCharacters;
+	delete pProjectiles;
+	delete pLasers;
+}
@@ -0,0 +1,76 @@
+#ifndef TEST_TESTMAP_H
+#define TEST_TESTMAP_H
+
+#include <base/system.h>
+#include <engine/map.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+// a map with nothing but a game layer, to run collision and physics without map files
+class CTestMap : public IMap
+{
+	CMapItemGroup m_Group;
+	CMapItemLayerTilemap m_Layer;
+	CTile *m_pTiles;
+
+public:
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	CTestMap(int Width, int Height)
+	{
+		mem_zero(&m_Group, sizeof(m_Group));
+		m_Group.m_Version = CMapItemGroup::CURRENT_VERSION;
+		m_Group.m_StartLayer = 0;
+		m_Group.m_NumLayers = 1;
+
+		mem_zero(&m_Layer, sizeof(m_Layer));
+		m_Layer.m_Layer.m_Type = LAYERTYPE_TILES;
+		m_Layer.m_Version = CMapItemLayerTilemap::CURRENT_VERSION;
+		m_Layer.m_Width = Width;
+		m_Layer.m_Height = Height;
+		m_Layer.m_Flags = TILESLAYERFLAG_GAME;
+		m_Layer.m_Data = 0;
+
+		m_pTiles = (CTile *)mem_alloc(sizeof(CTile)*Width*Height, 1);
+		mem_zero(m_pTiles, sizeof(CTile)*Width*Height);
+	}
+
+	~CTestMap()
+	{
+		mem_free(m_pTiles);
+	}
+
+	int Width() const { return m_Layer.m_Width; }
+	int Height() const { return m_Layer.m_Height; }
+	void SetTile(int x, int y, int Index) { m_pTiles[y*Width()+x].m_Index = Index; }
+
+	// call after all tiles are set, the collision converts them in place
+	void InitCollision()
+	{
+		m_Layers.Init(0, this);
+		m_Collision.Init(&m_Layers);
+	}
+
+	virtual void *GetData(int Index) { return m_pTiles; }
+	virtual void *GetDataSwapped(int Index) { return m_pTiles; }
+	virtual void UnloadData(int Index) {}
+	virtual void *GetItem(int Index, int *pType, int *pID)
+	{
+		if(pType)
+			*pType = Index == 0 ? MAPITEMTYPE_GROUP : MAPITEMTYPE_LAYER;
+		if(pID)
+			*pID = 0;
+		return Index == 0 ? (void *)&m_Group : (void *)&m_Layer;
+	}
+	virtual void GetType(int Type, int *pStart, int *pNum)
+	{
+		*pStart = Type == MAPITEMTYPE_GROUP ? 0 : 1;
+		*pNum = Type == MAPITEMTYPE_GROUP || Type == MAPITEMTYPE_LAYER ? 1 : 0;
+	}
+	virtual void *FindItem(int Type, int ID) { return 0; }
+	virtual int NumItems() { return 2; }
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/server/votetally.h>
+
+// the clients as the game context sees them
+struct CTestVoter
+{
+	bool m_Present;
+	bool m_Spectator;
+	int m_Vote;
+	int m_VotePos;
+	// empty while connecting
+	char m_aAddr[NETADDR_MAXSTRSIZE];
+};
+
+// the count the server did on every update before the tally
+static void FullRecount(const CTestVoter *pVoters, int *pTotal, int *pYes, int *pNo)
+{
+	*pTotal = *pYes = *pNo = 0;
+	bool aVoteChecked[MAX_CLIENTS] = {0};
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!pVoters[i].m_Present || pVoters[i].m_Spectator || aVoteChecked[i])
+			continue;
+
+		int ActVote = pVoters[i].m_Vote;
+		int ActVotePos = pVoters[i].m_VotePos;
+
+		// check for more players with the same ip (only use the vote of the one who voted first)
+		for(int j = i+1; j < MAX_CLIENTS; ++j)
+		{
+			if(!pVoters[j].m_Present || aVoteChecked[j] || str_comp(pVoters[j].m_aAddr, pVoters[i].m_aAddr))
+				continue;
+
+			aVoteChecked[j] = true;
+			if(pVoters[j].m_Vote && (!ActVote || ActVotePos > pVoters[j].m_VotePos))
+			{
+				ActVote = pVoters[j].m_Vote;
+				ActVotePos = pVoters[j].m_VotePos;
+			}
+		}
+
+		(*pTotal)++;
+		if(ActVote > 0)
+			(*pYes)++;
+		else if(ActVote < 0)
+			(*pNo)++;
+	}
+}
+
+TEST(VoteTally, SameAsFullRecount)
+{
+	static const char *s_apAddrs[] = {"1.2.3.4", "1.2.3.5", "10.0.0.1", "[2001:db8::1]", "[2001:db8::2]"};
+	const int NumAddrs = sizeof(s_apAddrs)/sizeof(s_apAddrs[0]);
+
+	CTestVoter aVoters[MAX_CLIENTS];
+	mem_zero(aVoters, sizeof(aVoters));
+	CVoteTally *pTally = new CVoteTally();
+	int VotePos = 0;
+	int NumShared = 0;
+
+	unsigned Seed = 7;
+	for(int Step = 0; Step < 20000; Step++)
+	{
+		Seed = Seed*1103515245+12345;
+		// a few slots only, so addresses are shared a lot
+		int ClientID = (Seed>>8)%12*5;
+		CTestVoter *pVoter = &aVoters[ClientID];
+		int Action = (Seed>>16)%8;
+
+		if(Action == 0 && !pVoter->m_Present)
+		{
+			// connects, not ingame yet
+			pVoter->m_Present = true;
+			pVoter->m_Spectator = (Seed>>24)%4 == 0;
+			pVoter->m_aAddr[0] = 0;
+			NETADDR Addr;
+			mem_zero(&Addr, sizeof(Addr));
+			pTally->SetSpectator(ClientID, pVoter->m_Spectator);
+			pTally->SetAddr(ClientID, &Addr);
+		}
+		else if(Action == 1 && pVoter->m_Present && !pVoter->m_aAddr[0])
+		{
+			// enters the game
+			NETADDR Addr;
+			str_copy(pVoter->m_aAddr, s_apAddrs[(Seed>>24)%NumAddrs], sizeof(pVoter->m_aAddr));
+			net_addr_from_str(&Addr, pVoter->m_aAddr);
+			pTally->SetAddr(ClientID, &Addr);
+		}
+		else if(Action == 2 && pVoter->m_Present)
+		{
+			mem_zero(pVoter, sizeof(*pVoter));
+			pTally->Remove(ClientID);
+		}
+		else if(Action == 3 && pVoter->m_Present)
+		{
+			pVoter->m_Spectator = !pVoter->m_Spectator;
+			pTally->SetSpectator(ClientID, pVoter->m_Spectator);
+		}
+		else if((Action == 4 || Action == 5) && pVoter->m_Present && !pVoter->m_Vote)
+		{
+			pVoter->m_Vote = (Seed>>24)%2 ? 1 : -1;
+			pVoter->m_VotePos = ++VotePos;
+			pTally->SetVote(ClientID, pVoter->m_Vote, pVoter->m_VotePos);
+		}
+		else if(Action == 6 && (Seed>>24)%16 == 0)
+		{
+			// a new vote, the caller votes yes first
+			for(int i = 0; i < MAX_CLIENTS; i++)
+				aVoters[i].m_Vote = aVoters[i].m_VotePos = 0;
+			pTally->ClearVotes();
+			if(pVoter->m_Present)
+			{
+				pVoter->m_Vote = 1;
+				pVoter->m_VotePos = VotePos = 1;
+				pTally->SetVote(ClientID, pVoter->m_Vote, pVoter->m_VotePos);
+			}
+		}
+
+		int Total, Yes, No;
+		FullRecount(aVoters, &Total, &Yes, &No);
+		ASSERT_EQ(pTally->Total(), Total) << "step " << Step;
+		ASSERT_EQ(pTally->Yes(), Yes) << "step " << Step;
+		ASSERT_EQ(pTally->No(), No) << "step " << Step;
+
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(i != ClientID && aVoters[i].m_Present && aVoters[ClientID].m_Present && !str_comp(aVoters[i].m_aAddr, aVoters[ClientID].m_aAddr))
+			{
+				NumShared++;
+				break;
+			}
+		}
+	}
+	// many steps touch a client that shares its address
+	EXPECT_GT(NumShared, 5000);
+
+	pTally->Reset();
+	EXPECT_EQ(pTally->Total(), 0);
+	delete pTally;
+}